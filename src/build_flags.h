@@ -0,0 +1,22 @@
+#pragma once
+
+// build configuration macros; no raylib, so the analysis core can include it
+#if defined(TARGET_REL)
+  #define NO_DEBUG
+  #define PRAGMA(X) _Pragma(#X)
+  #define OPENMP_USE_SIMD PRAGMA(omp simd)
+#else
+  #define PRAGMA(X) ;
+  #define OPENMP_USE_SIMD ;
+#endif
+
+// runtime dispatch between an AVX2 clone and the baseline build of a function
+#if defined(TARGET_REL) && !defined(TARGET_WIN) && defined(__x86_64__)
+  #define TARGET_CLONES_AVX2 __attribute__((target_clones("avx2", "default")))
+#else
+  #define TARGET_CLONES_AVX2
+#endif
+
+// kernels of vectorized loops, which only vectorize once inlined whatever
+// their size
+#define FORCE_INLINE inline __attribute__((always_inline))
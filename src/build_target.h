@@ -1,11 +1,4 @@
-#if defined(TARGET_REL)
-  #define NO_DEBUG
-  #define PRAGMA(X) _Pragma(#X)
-  #define OPENMP_USE_SIMD PRAGMA(omp simd)
-#else
-  #define PRAGMA(X) ;
-  #define OPENMP_USE_SIMD ;
-#endif
+#include "build_flags.h"
 
 #if defined(TARGET_WIN)
   #include "../dpd/raylib/src/raylib.h"
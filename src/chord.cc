@@ -6,25 +6,38 @@
 
 using std::sort;
 
-void chordData::sort_asc(vector<note>* n_vec) {
-  if (member.size() == 1) {
+void chordMap::build(const vector<unsigned int>& note_idx, const vector<note>& n_vec) {
+  clear();
+  if (note_idx.size() == 0) {
     return;
   }
 
-  // logE();
-  // logQ("START");
-  // for (auto i : member) {
-  // logQ( n_vec->at(i).y);
-  //}
-  // logE();
+  member = note_idx;
+  offset.reserve(note_idx.size() + 1);
 
-  auto y_comp = [=](const auto l, const auto r) { return n_vec->at(l).y < n_vec->at(r).y; };
+  for (unsigned int n = 0; n < note_idx.size(); ++n) {
+    if (n != 0 && noteAt(n_vec, note_idx[n]).x < noteAt(n_vec, note_idx[n] - 1).x) {
+      logQ("MISALIGNED @ idx:", note_idx[n], "but", n);
+    }
 
-  sort(member.begin(), member.end(), y_comp);
+    if (n == 0 || noteAt(n_vec, note_idx[n]).x != noteAt(n_vec, note_idx[n - 1]).x) {
+      offset.push_back(n);
+    }
+  }
+  offset.push_back(member.size());
+
+  // not guaranteed to be in increasing order of y
+  auto y_comp = [&](const auto l, const auto r) { return noteAt(n_vec, l).y < noteAt(n_vec, r).y; };
+  for (unsigned int c = 0; c + 1 < offset.size(); ++c) {
+    if (offset[c + 1] - offset[c] > 1) {
+      sort(member.begin() + offset[c], member.begin() + offset[c + 1], y_comp);
+    }
+  }
 }
 
-int chordData::latest_end(vector<note>* n_vec) const {
-  auto end_comp = [=](const auto l, const auto r) { return n_vec->at(l).duration < n_vec->at(r).duration; };
+unsigned int chordMap::latest_end(unsigned int c, const vector<note>& n_vec) const {
+  auto end_comp = [&](const auto l, const auto r) { return noteAt(n_vec, l).duration < noteAt(n_vec, r).duration; };
 
-  return *std::max_element(std::begin(member), std::end(member), end_comp);
+  auto chord = (*this)[c];
+  return *std::max_element(chord.begin(), chord.end(), end_comp);
 }
@@ -1,22 +1,45 @@
 #pragma once
 
+#include <span>
 #include <vector>
 
+#include "mem_usage.h"
 #include "note.h"
 
+using std::span;
 using std::vector;
 
-class chordData {
+// bounds-checked only in debug builds
+inline const note& noteAt(const vector<note>& n_vec, unsigned int idx) {
+#ifdef TARGET_REL
+  return n_vec[idx];
+#else
+  return n_vec.at(idx);
+#endif
+}
+
+// chords of a track in compressed form: the members of chord c are
+// member[offset[c]] up to member[offset[c + 1]], sorted by ascending y
+class chordMap {
  public:
-  chordData(unsigned int initial_idx) { member = {initial_idx}; }
+  void clear() {
+    offset.clear();
+    member.clear();
+  }
+
+  // groups the (time-ordered) note indices by start time
+  void build(const vector<unsigned int>& note_idx, const vector<note>& n_vec);
+
+  unsigned int size() const { return offset.empty() ? 0 : offset.size() - 1; }
+  span<const unsigned int> operator[](unsigned int c) const {
+    return {member.data() + offset[c], member.data() + offset[c + 1]};
+  }
 
-  void sort_asc(vector<note>* n_vec);
-  void add_member(unsigned int idx) { member.push_back(idx); }
+  unsigned int latest_end(unsigned int c, const vector<note>& n_vec) const;
 
-  int latest_end(vector<note>* n_vec) const;
-  unsigned int size() const { return member.size(); }
-  const vector<unsigned int>& data() { return member; }
+  size_t getMemory() const { return heapSize(offset) + heapSize(member); }
 
  private:
+  vector<unsigned int> offset;
   vector<unsigned int> member;
 };
@@ -0,0 +1,152 @@
+// nodumi-cli: headless batch analysis, linked against the core library only
+//
+// usage: nodumi-cli [--no-split] [--hand-range N] [--trace FILE] file...
+//
+// prints one JSON object per input file; exits non-zero if any file fails.
+// --trace writes a Chrome trace of the load phases, in builds made with
+// `make trace=y`
+
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "../context.h"
+#include "../midi.h"
+#include "../timekey.h"
+#include "../trace.h"
+#include "../track.h"
+
+using std::cout;
+using std::string;
+using std::stringstream;
+using std::vector;
+
+namespace {
+
+string quote(const string& s) {
+  string out = "\"";
+  for (unsigned char c : s) {
+    switch (c) {
+      case '"':
+        out += "\\\"";
+        break;
+      case '\\':
+        out += "\\\\";
+        break;
+      case '\n':
+        out += "\\n";
+        break;
+      case '\t':
+        out += "\\t";
+        break;
+      default:
+        if (c < 0x20) {
+          char esc[8];
+          snprintf(esc, sizeof(esc), "\\u%04x", c);
+          out += esc;
+        }
+        else {
+          out += c;
+        }
+    }
+  }
+  return out + "\"";
+}
+
+void usage() { std::cerr << "usage: nodumi-cli [--no-split] [--hand-range N] [--trace FILE] file..." << std::endl; }
+
+bool analyze(const string& path, const analysisContext& context) {
+  midi file;
+  stringstream buf;
+  loadProgress status;
+
+  if (!file.load(path, buf, context, &status)) {
+    cout << "{\"path\": " << quote(path) << ", \"error\": \"unable to load\"}" << std::endl;
+    return false;
+  }
+
+  ostringstream json;
+  json << fixed << setprecision(6);
+  json << "{\"path\": " << quote(path);
+  json << ", \"notes\": " << file.getNoteCount();
+
+  json << ", \"tracks\": [";
+  for (int i = 0; const auto& t : file.getTracks()) {
+    json << (i++ ? ", " : "") << t.getNoteCount();
+  }
+  json << "]";
+
+  json << ", \"trackSplit\": " << (file.isTrackSplit() ? "true" : "false");
+  json << ", \"measures\": " << file.measureMap.size();
+  json << ", \"tpq\": " << file.getTPQ();
+  json << ", \"duration\": " << file.getLastTime() / double(UNK_CST);
+
+  // the key stored in the file (or the one guessed at load time if none was)
+  string key = file.measureMap.empty() ? "" : file.measureMap[0].currentKey.getLabel();
+  json << ", \"key\": " << quote(key);
+  json << ", \"detectedKey\": " << quote(keySig(file.findKeySig(), false, 0).getLabel());
+
+  json << ", \"phases\": {";
+  for (int i = 0; const auto& [phase, seconds] : status.phases) {
+    json << (i++ ? ", " : "") << quote(phase) << ": " << seconds;
+  }
+  json << "}}";
+
+  cout << json.str() << std::endl;
+  return true;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  TRACE_THREAD("main");
+
+  analysisContext context;
+  vector<string> paths;
+  string tracePath;
+
+  for (int i = 1; i < argc; ++i) {
+    string arg = argv[i];
+    if (arg == "--no-split") {
+      context.trackDivision = false;
+    }
+    else if (arg == "--hand-range" && i + 1 < argc) {
+      context.handRange = atoi(argv[++i]);
+    }
+    else if (arg == "--trace" && i + 1 < argc) {
+      tracePath = argv[++i];
+    }
+    else if (arg == "-h" || arg == "--help") {
+      usage();
+      return 0;
+    }
+    else if (arg.starts_with("--")) {
+      usage();
+      return 2;
+    }
+    else {
+      paths.push_back(arg);
+    }
+  }
+
+  if (paths.empty()) {
+    usage();
+    return 2;
+  }
+
+  // MKI files carry compressed image data decoded through raylib, they are
+  // only handled by the main program
+  bool ok = true;
+  for (const auto& path : paths) {
+    ok &= analyze(path, context);
+  }
+
+  if (!tracePath.empty()) {
+    ok &= traceDump(tracePath);
+  }
+
+  return ok ? 0 : 1;
+}
@@ -3,8 +3,6 @@
 #include <cmath>
 #include <iostream>
 
-#include "build_target.h"
-
 using std::ostream;
 
 class colorLAB;
@@ -35,7 +33,6 @@ class colorRGB {
  public:
   colorRGB();
   colorRGB(double red, double green, double blue);
-  colorRGB(const Color& col);
   colorRGB(const colorLAB& col);
 
   colorHSV getHSV() const;
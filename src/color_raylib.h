@@ -0,0 +1,8 @@
+#pragma once
+
+#include "build_target.h"
+#include "color.h"
+
+// raylib color conversions, kept out of color.h so the analysis core builds
+// without raylib
+inline colorRGB toColorRGB(const Color& col) { return colorRGB(col.r, col.g, col.b); }
@@ -5,24 +5,29 @@
 #include <functional>
 #include <map>
 #include <random>
-#include <thread>
 #include <tuple>
 #include <unordered_map>
 #include <vector>
 
 #include "color.h"
+#include "trace.h"
 #include "data.h"
 #include "define.h"
+#include "deltae.h"
 #include "lerp.h"
 #include "log.h"
+#include "task.h"
 
 using namespace std::chrono;
 using std::bind;
+using std::fill;
+using std::max;
 using std::min;
 using std::mt19937;
 using std::pair;
 using std::swap;
 using std::uniform_int_distribution;
+using std::uniform_real_distribution;
 using std::vector;
 
 void invertColorScheme(colorRGB& bg, colorRGB& line, vector<colorRGB>& on, vector<colorRGB>& off) {
@@ -241,101 +246,182 @@ void getColorSchemeImage(int n, int k, vector<colorRGB>& colorVecA, vector<color
 }
 
 vector<colorRGB> findKMeans(vector<kMeansPoint>& colorData, int k) {
+  TRACE_ZONE("k-means");
   // auto start = std::chrono::high_resolution_clock::now();
   //  result container
   vector<colorRGB> colors(k);
 
-  if (!k) {
-    logW(LL_WARN, "call to findKMeans with k =", k);
+  if (!k || colorData.empty()) {
+    logW(LL_WARN, "call to findKMeans with k =", k, "and", colorData.size(), "points");
     return colors;
   }
 
-  // logE();
-
   // init rng
-  mt19937::result_type gen = high_resolution_clock::now().time_since_epoch().count();
+  mt19937 rng(high_resolution_clock::now().time_since_epoch().count());
   uniform_int_distribution<int> range(0, colorData.size() - 1);
-  auto getCentroid = bind(range, mt19937(gen));
-
-  // choose points
-  vector<pair<int, kMeansPoint>> centroids;
-  int centroidIdx = getCentroid();
-  colorLAB cenCol = colorData[centroidIdx].data;
-  centroids.push_back(make_pair(centroidIdx, colorData[centroidIdx]));
-
-  const auto existsInMap = [&](const colorLAB col) {
-    for (const auto& i : centroids) {
-      if (colorData[i.first].data == col) {
-        return true;
-      }
-    }
-    return false;
-  };
 
-  for (int i = 0; i < k - 1; ++i) {
-    centroidIdx = getCentroid();
-    cenCol = colorData[centroidIdx].data;
-    existsInMap(cenCol);
+  // k-means++ seeding: each further centroid is drawn with probability
+  // proportional to its squared distance from the nearest chosen centroid
+  vector<kMeansPoint> centroids;
+  centroids.reserve(k);
+  centroids.push_back(colorData[range(rng)]);
+
+  vector<double> seedDist(colorData.size(), __DBL_MAX__);
+  while (static_cast<int>(centroids.size()) < k) {
+    double total = parallelReduce(
+        0, colorData.size(), 1024, 0.0,
+        [&](int lo, int hi, double& acc) {
+          for (int pixel = lo; pixel < hi; ++pixel) {
+            seedDist[pixel] = min(seedDist[pixel], colorData[pixel].euclidean(centroids.back()));
+            acc += seedDist[pixel];
+          }
+        },
+        [](double a, double b) { return a + b; });
+
+    if (total <= 0) {
+      // fewer distinct colors than requested clusters
+      break;
+    }
 
-    while (existsInMap(cenCol)) {
-      centroidIdx = getCentroid();
-      cenCol = colorData[centroidIdx].data;
+    double target = uniform_real_distribution<double>(0, total)(rng);
+    unsigned int pick = 0;
+    for (; pick + 1 < colorData.size(); ++pick) {
+      target -= seedDist[pick];
+      if (target <= 0 && seedDist[pick] > 0) {
+        break;
+      }
     }
+    centroids.push_back(colorData[pick]);
+  }
 
-    centroids.push_back(make_pair(centroidIdx, colorData[centroidIdx]));
-    // logQ("centroid:",centroidIdx, colorData[centroidIdx].data);
+  const unsigned int nCen = centroids.size();
+  // the points are cut into one slice per thread, each with its own
+  // accumulators that are merged after every pass
+  const int nSlices = taskPool().getThreadCount();
+  vector<colorLAB> centroidSum(nSlices * nCen);
+  vector<int> nPoints(nSlices * nCen);
+
+  // CIE76 is not a strict bound on CIE94/00, so candidates are any centroid
+  // within a slack factor of the euclidean nearest one
+  constexpr double slackSq = KMEANS_PRUNE_SLACK * KMEANS_PRUNE_SLACK;
+
+  // points are assigned in blocks so that each centroid is compared against
+  // its candidate points with one batch deltaE call
+  constexpr unsigned int blockSize = 256;
+  const unsigned int nBlocks = (colorData.size() + blockSize - 1) / blockSize;
+
+  labSet pointLAB;
+  pointLAB.resize(colorData.size());
+  for (unsigned int pixel = 0; pixel < colorData.size(); ++pixel) {
+    pointLAB.set(pixel, colorData[pixel].data);
   }
 
-  // logQ("there are",centroids.size(), "centroids");
-  vector<int> nPoints(centroids.size(), 0);
-
-  // iterate over points
-  for (unsigned int it = 0; it < KMEANS_ITERATIONS; ++it) {
-    nPoints.clear();
-
-#pragma omp parallel for
-    for (unsigned int pixel = 0; pixel < colorData.size(); ++pixel) {
-      colorData[pixel].cluster = -1;
-      colorData[pixel].cDist = __DBL_MAX__;
-      for (unsigned int centroid = 0; centroid < centroids.size(); ++centroid) {
-        kMeansPoint& kmPoint = colorData[pixel];
-        // find distance and nearest cluster
-        float pixDist = kmPoint.distance(centroids[centroid].second);
-
-        if (pixDist < kmPoint.cDist) {
-          kmPoint.cDist = pixDist;
-          // add INDEX of centroid among other centroids
-          kmPoint.cluster = centroid;
+  unsigned int it = 0;
+  for (; it < KMEANS_MAX_ITERATIONS; ++it) {
+    fill(centroidSum.begin(), centroidSum.end(), colorLAB());
+    fill(nPoints.begin(), nPoints.end(), 0);
+
+    parallelFor(0, nSlices, 1, [&](int lo, int hi) {
+      for (int slice = lo; slice < hi; ++slice) {
+        const unsigned int base = slice * nCen;
+        vector<double> eucDist(nCen * blockSize);
+        vector<double> eucMin(blockSize);
+        vector<unsigned int> candIdx(blockSize);
+        labSet cand;
+        cand.resize(blockSize);
+        float candDist[blockSize];
+
+        const unsigned int firstBlock = nBlocks * slice / nSlices;
+        const unsigned int lastBlock = nBlocks * (slice + 1) / nSlices;
+        for (unsigned int block = firstBlock; block < lastBlock; ++block) {
+          const unsigned int first = block * blockSize;
+          const unsigned int count = min<unsigned int>(blockSize, colorData.size() - first);
+
+          fill(eucMin.begin(), eucMin.end(), __DBL_MAX__);
+          for (unsigned int centroid = 0; centroid < nCen; ++centroid) {
+            for (unsigned int p = 0; p < count; ++p) {
+              double d = colorData[first + p].euclidean(centroids[centroid]);
+              eucDist[centroid * blockSize + p] = d;
+              eucMin[p] = min(eucMin[p], d);
+            }
+          }
+
+          for (unsigned int p = 0; p < count; ++p) {
+            colorData[first + p].cluster = -1;
+            colorData[first + p].cDist = __DBL_MAX__;
+          }
+
+          for (unsigned int centroid = 0; centroid < nCen; ++centroid) {
+            // gather candidate points of this centroid
+            unsigned int nCand = 0;
+            for (unsigned int p = 0; p < count; ++p) {
+              if (eucDist[centroid * blockSize + p] <= eucMin[p] * slackSq) {
+                candIdx[nCand] = p;
+                cand.l[nCand] = pointLAB.l[first + p];
+                cand.a[nCand] = pointLAB.a[first + p];
+                cand.b[nCand] = pointLAB.b[first + p];
+                nCand++;
+              }
+            }
+
+            // find distance and nearest cluster; the point is the reference,
+            // as in kMeansPoint::distance()
+            deltaEBatch(cand.l.data(), cand.a.data(), cand.b.data(), centroids[centroid].data, nCand, candDist);
+            for (unsigned int c = 0; c < nCand; ++c) {
+              kMeansPoint& kmPoint = colorData[first + candIdx[c]];
+              if (candDist[c] < kmPoint.cDist) {
+                kmPoint.cDist = candDist[c];
+                // add INDEX of centroid among other centroids
+                kmPoint.cluster = centroid;
+              }
+            }
+          }
+
+          for (unsigned int p = 0; p < count; ++p) {
+            const kMeansPoint& kmPoint = colorData[first + p];
+            if (kmPoint.cluster < 0) {
+              continue;
+            }
+            colorLAB& sum = centroidSum[base + kmPoint.cluster];
+            sum.l += kmPoint.data.l;
+            sum.a += kmPoint.data.a;
+            sum.b += kmPoint.data.b;
+            nPoints[base + kmPoint.cluster]++;
+          }
         }
       }
-    }
-
-    vector<colorLAB> centroidSum(centroids.size(), {0.0, 0.0, 0.0});
+    });
+
+    double maxShift = 0;
+    for (unsigned int centroid = 0; centroid < nCen; ++centroid) {
+      colorLAB sum;
+      int count = 0;
+      for (int t = 0; t < nSlices; ++t) {
+        sum.l += centroidSum[t * nCen + centroid].l;
+        sum.a += centroidSum[t * nCen + centroid].a;
+        sum.b += centroidSum[t * nCen + centroid].b;
+        count += nPoints[t * nCen + centroid];
+      }
 
-#pragma omp parallel for
-    for (unsigned int centroid = 0; centroid < centroids.size(); ++centroid) {
-      for (unsigned int pixel = 0; pixel < colorData.size(); ++pixel) {
-        if (static_cast<int>(centroid) == colorData[pixel].cluster) {
-          centroidSum[centroid].l += colorData[pixel].data.l;
-          centroidSum[centroid].a += colorData[pixel].data.a;
-          centroidSum[centroid].b += colorData[pixel].data.b;
-          nPoints[centroid]++;
-        }
+      // empty clusters keep their previous centroid
+      if (!count) {
+        continue;
       }
+
+      kMeansPoint next(sum.l / count, sum.a / count, sum.b / count);
+      maxShift = max(maxShift, next.euclidean(centroids[centroid]));
+      centroids[centroid].data = next.data;
     }
 
-    for (unsigned int centroid = 0; centroid < centroids.size(); ++centroid) {
-      float newL = centroidSum[centroid].l / nPoints[centroid];
-      float newA = centroidSum[centroid].a / nPoints[centroid];
-      float newB = centroidSum[centroid].b / nPoints[centroid];
-      centroids[centroid].second.data = colorLAB(newL, newA, newB);
+    if (maxShift < KMEANS_EPSILON * KMEANS_EPSILON) {
+      break;
     }
   }
 
-  for (unsigned int centroid = 0; centroid < centroids.size(); ++centroid) {
-    // logQ("centroid", centroids[centroid].first, "has", nPoints[centroid],
-    //"linked points with LAB:", colorData[centroids[centroid].first].data);
-    colors[centroid] = (colorRGB(centroids[centroid].second.data));
+  // logQ("k-means converged after", it, "iterations");
+
+  for (unsigned int centroid = 0; centroid < colors.size(); ++centroid) {
+    colors[centroid] = colorRGB(centroids[centroid % nCen].data);
   }
 
   // debug_time(start);
@@ -0,0 +1,14 @@
+#pragma once
+
+#include "data.h"
+
+// settings the song analysis reads, passed explicitly so that loading does
+// not depend on the global controller; the app fills one from its options,
+// headless tools start from the defaults below
+struct analysisContext {
+  // split single-track files into two hands
+  bool trackDivision = true;
+
+  // one hand range in semitones (approx. a 10th)
+  int handRange = MAX_HAND_RANGE;
+};
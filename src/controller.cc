@@ -11,8 +11,12 @@
 
 #include "build_target.h"
 #include "define.h"
+#include "file_util.h"
+#include "frame_alloc.h"
 #include "log.h"
+#include "mem_usage_raylib.h"
 #include "menuctr.h"
+#include "trace.h"
 #include "voronoi.h"
 #include "wrap.h"
 
@@ -38,18 +42,27 @@ controller::controller() : midiData() {
 }
 
 void controller::init(vector<asset>& assetSet) {
+  auto phase = std::chrono::high_resolution_clock::now();
+  auto endPhase = [&](const string& msg) {
+    debug_time(phase, "startup: " + msg);
+    phase = std::chrono::high_resolution_clock::now();
+  };
+
   srand(time(0));
 
   std::mt19937 gen(rd());
 
   initData(assetSet);
+  endPhase("assets");
 
   text.init();
 
   dialog.init();
+  endPhase("text");
 
   fileOutput.init(&output);
 
+  // shaders compile on first use, these values are applied then
   Vector3 startCol = {1.0f, 0.0f, 0.0f};
   setShaderValue("SH_SQUARE", "blend_color", startCol);
 
@@ -57,11 +70,10 @@ void controller::init(vector<asset>& assetSet) {
 
   setShaderValue("SH_FXAA", "u_resolution", (Vector2){static_cast<float>(getWidth()), static_cast<float>(getHeight())});
 
-  shadow.init();
-  voronoi.init();
-  fft.updateFFTBins();
+  // shadow/voronoi render targets and FFT bins are created on first use
 
   warning.init();
+  endPhase("controller");
 }
 
 void controller::initData(const vector<asset>& assetSet) {
@@ -74,21 +86,15 @@ void controller::initData(const vector<asset>& assetSet) {
       case IMAGE: {
         auto it = imageMap.find(item.assetName);
         if (it == imageMap.end()) {
-          // asset not already loaded, so we should load it
-          // Texture2D tmpTex = LoadTexture(item.path.c_str());
-          Image tmpImg = LoadImageFromMemory(".png", item.data, item.dataLen);
-
           if (item.assetName == "ICON") {
+            // needed before the first frame
+            Image tmpImg = LoadImageFromMemory(".png", item.data, item.dataLen);
             SetWindowIcon(tmpImg);
+            uploadImage(item.assetName, tmpImg);
+          }
+          else {
+            pendingImages.push_back(make_pair(item, Image{}));
           }
-
-          Texture2D tmpTex = LoadTextureFromImage(tmpImg);
-          SetTextureFilter(tmpTex, TEXTURE_FILTER_BILINEAR);
-
-          UnloadImage(tmpImg);
-
-          // add to image map for future reference
-          imageMap.insert(make_pair(item.assetName, tmpTex));
         }
       } break;
 
@@ -96,8 +102,7 @@ void controller::initData(const vector<asset>& assetSet) {
         auto it = shaderMap.find(item.assetName);
 
         if (it == shaderMap.end()) {
-          // asset not already loaded, so we should load it
-
+          // compiled on first use (or while idle after startup)
           shaderData tmpShaderData(item);
 
           // add to shader map for future reference
@@ -109,6 +114,55 @@ void controller::initData(const vector<asset>& assetSet) {
         break;
     }
   }
+
+  // the remaining images are decoded off the render thread and uploaded
+  // the first time one of them is requested
+  if (!pendingImages.empty()) {
+    imageDecoder = thread([this] {
+      for (auto& img : pendingImages) {
+        img.second = LoadImageFromMemory(".png", img.first.data, img.first.dataLen);
+      }
+    });
+  }
+}
+
+void controller::uploadImage(const string& id, Image& img) {
+  Texture2D tmpTex = LoadTextureFromImage(img);
+  SetTextureFilter(tmpTex, TEXTURE_FILTER_BILINEAR);
+
+  UnloadImage(img);
+  img = Image{};
+
+  // add to image map for future reference
+  imageMap.insert(make_pair(id, tmpTex));
+}
+
+void controller::finishImages() {
+  if (!imageDecoder.joinable()) {
+    return;
+  }
+  imageDecoder.join();
+
+  for (auto& img : pendingImages) {
+    if (img.second.data) {
+      uploadImage(img.first.assetName, img.second);
+    }
+  }
+  pendingImages.clear();
+}
+
+void controller::warmUp() {
+  // spread remaining startup work over idle frames, one item per frame
+  if (imageDecoder.joinable()) {
+    finishImages();
+    return;
+  }
+  for (auto& sd : shaderMap) {
+    if (!sd.second.loaded()) {
+      sd.second.load();
+      return;
+    }
+  }
 }
 
 const Font& controller::getFont(const string& id, int size) {
@@ -157,6 +211,10 @@ const Font& controller::getFont(const string& id, int size) {
 
 Texture2D& controller::getImage(const string& imageIdentifier) {
   auto it = imageMap.find(imageIdentifier);
+  if (it == imageMap.end()) {
+    finishImages();
+    it = imageMap.find(imageIdentifier);
+  }
   if (it == imageMap.end()) {
     logW(LL_CRIT, "attempt to load unloaded image w/ identifier: " + imageIdentifier);
     // exit(1);
@@ -176,6 +234,8 @@ shaderData& controller::getShaderData(const string& shaderIdentifier) {
 Shader& controller::getShader(const string& shaderIdentifier) { return getShaderData(shaderIdentifier).getShader(); }
 
 void controller::unloadData() {
+  finishImages();
+
   for (const auto& item : fontMap) {
     for (const auto& font : item.second.second) {
       UnloadFont(font.second);
@@ -190,9 +250,16 @@ void controller::unloadData() {
   menu.unloadData();
   image.unloadData();
 
+  shadow.unload();
+  tiles.unload();
   voronoi.unloadData();
+  gpuTime.unload();
   fft.generator_join();
 
+  // loader jobs cancelled during the session must be joined before exit
+  retireLoad();
+  reaper().drain();
+
   CloseWindow();
 }
 
@@ -267,6 +334,19 @@ controller::process(ACTION action) {
     if (isKeyPressed(KEY_F)) {
       return ACTION::FILE_INFO;
     }
+#if !defined(TARGET_REL)
+    if (isKeyPressed(KEY_M)) {
+      return ACTION::DUMP_MEMORY;
+    }
+#endif
+    if (isKeyPressed(KEY_G)) {
+      return ACTION::TOGGLE_GPU_TIMER;
+    }
+#if defined(TRACE_ENABLED)
+    if (isKeyPressed(KEY_T)) {
+      return ACTION::DUMP_TRACE;
+    }
+#endif
 
     if (isKeyPressed(KEY_ONE, KEY_TWO, KEY_THREE, KEY_FOUR, KEY_FIVE, KEY_SIX, KEY_SEVEN, KEY_EIGHT, KEY_NINE)) {
       return ACTION::CHANGE_MODE;
@@ -335,7 +415,24 @@ void controller::update(int offset, double zoom, double& nowLineX) {
     return;
   }
 
+  // temporaries of the frame just drawn are dead by now
+  frameMemory().reset();
+  gpuTime.frame();
+
   frameCounter++;
+  if (frameCounter > 1) {
+    warmUp();
+  }
+
+#if !defined(NO_DEBUG)
+  // a steady frame does not touch the heap; report the frames that do, so the
+  // change behind it can be found
+  if (frameCounter > FRAME_ALLOC_WARMUP && frameCounter >= allocReportFrame && frameMemory().getFrameHeapAllocs()) {
+    logW(LL_WARN, "frame", frameCounter - 1, "made", frameMemory().getFrameHeapAllocs(), "heap allocations");
+    allocReportFrame = frameCounter + FRAME_ALLOC_REPORT_INTERVAL;
+  }
+#endif
+
   if (!livePlayState && run && output.isPortOpen()) {
     fileOutput.allow();
   }
@@ -396,8 +493,11 @@ void controller::updateDimension(double& nowLineX) {
                    (Vector2){static_cast<float>(getWidth()), static_cast<float>(getHeight())});
 
     shadow.update();
+    tiles.unload();
     voronoi.update();
-    fft.updateFFTBins();
+    if (!fft.bins.empty()) {
+      fft.updateFFTBins();
+    }
 
     nowLineX = getWidth() * nowLineX / lastWidth;
 
@@ -405,7 +505,7 @@ void controller::updateDimension(double& nowLineX) {
       // TODO: measure system for live input
     }
     else {
-      file.sheetData.findSheetPages();
+      sheetData.findSheetPages();
     }
   }
 }
@@ -545,11 +645,12 @@ fileType controller::getFileType() const {
   }
   return fType;
 }
-string controller::getFilePath() const {
+const string& controller::getFilePath() const {
+  static const string none;
   if (getLiveState()) {
-    return "";
+    return none;
   }
-  return fPath.substr(fPath.find_last_of("/\\") + 1);
+  return fName;
 }
 string controller::getFileFullPath() const {
   if (getLiveState()) {
@@ -661,9 +762,11 @@ string controller::getTempoLabel(int offset) const {
 
 string controller::getKeySigLabel(int offset) const {
   if (livePlayState) {
-    // TODO: detect key signature from already-played notes
-    // return "NULL";
-    return "";
+    // key of the most recently played notes
+    if (input.getKeys().empty()) {
+      return "";
+    }
+    return keySig(input.getKeys().getKey(), 0, 0).getLabel(text.getString("GET_LABEL_MAJOR"));
   }
 
   if (file.measureMap.size() == 0) {
@@ -678,513 +781,481 @@ string controller::getKeySigLabel(int offset) const {
   // file.measureMap[findCurrentMeasure(offset)-1].currentKey.getIndex();
   // logQ("the current measure", findCurrentMeasure(offset), "has key signature
   // offset", KSOffset);
-  return file.measureMap[findCurrentMeasure(offset) - 1].currentKey.getLabel();
+  return file.measureMap[findCurrentMeasure(offset) - 1].localKey.getLabel(text.getString("GET_LABEL_MAJOR"));
+}
+
+memoryReport controller::getMemoryUsage() const {
+  memoryReport report;
+  file.reportMemory(report);
+
+  // live history is held in the same structures
+  memoryReport live;
+  input.noteStream.reportMemory(live);
+  for (unsigned int i = 0; i < report.size(); ++i) {
+    report[i].second += live[i].second;
+  }
+
+  report.push_back({"MEM_SHEET", sheetData.getMemory()});
+  report.push_back({"MEM_PARTICLES", particle.getMemory()});
+  report.push_back({"MEM_IMAGE", image.getMemory()});
+
+  size_t fontBytes = 0;
+  for (const auto& f : fontMap) {
+    for (const auto& [size, font] : f.second.second) {
+      fontBytes += textureSize(font.texture) + font.glyphCount * (sizeof(Rectangle) + sizeof(GlyphInfo));
+      for (int g = 0; g < font.glyphCount; ++g) {
+        fontBytes += imageSize(font.glyphs[g].image);
+      }
+    }
+  }
+  report.push_back({"MEM_FONTS", fontBytes});
+
+  size_t textureBytes = shadow.getMemory() + tiles.getMemory() + voronoi.getMemory() + menu.getMemory();
+  for (const auto& i : imageMap) {
+    textureBytes += textureSize(i.second);
+  }
+  report.push_back({"MEM_TEXTURES", textureBytes});
+  report.push_back({"MEM_FRAME", frameMemory().getCapacity() + scene.getMemory()});
+
+  return report;
+}
+
+void controller::logMemoryUsage() const {
+  size_t total = 0;
+  for (const auto& [label, bytes] : getMemoryUsage()) {
+    logW(LL_INFO, "memory:", text.getString(label), "-", formatBytes(bytes), "(" + to_string(bytes) + ")");
+    total += bytes;
+  }
+  logW(LL_INFO, "memory:", text.getString("MEM_TOTAL"), "-", formatBytes(total));
+  logW(LL_INFO, "memory: frame scratch peak", formatBytes(frameMemory().getPeak()), "- heap allocations last frame",
+       frameMemory().getFrameHeapAllocs());
+}
+
+analysisContext controller::getAnalysisContext() {
+  analysisContext context;
+  context.trackDivision = option.get(OPTION::TRACK_DIVISION_MIDI);
+  context.handRange = option.get(OPTION::HAND_RANGE);
+  return context;
 }
 
 void controller::clear() {
+  // a pending load would otherwise replace the cleared file
+  retireLoad();
+
   midiData.clear();
   file.clear();
+  sheetData.reset();
   runTime = 0;
   pauseTime = 0;
   bgColor = colorRGB(0, 0, 0);
   fType = FILE_NONE;
-  fPath = "";
+  setFilePath("");
   fileOutput.disallow(true);
 }
 
-void controller::load(string path, bool& nowLine, bool& showFPS, bool& showImage, bool& sheetMusicDisplay,
-                      bool& measureLine, bool& measureNumber,
-
-                      int& colorMode, int& displayMode,
-
-                      int& songTimeType, int& tonicOffset,
-
-                      double& zoomLevel) {
+void controller::load(string path) {
   if (!isValidPath(path, PATH_DATA)) {
     logW(LL_WARN, "invalid path:", path);
     return;
   }
 
-  auto start = std::chrono::high_resolution_clock::now();
-
-  if (isValidPath(path, PATH_MKI)) {
-    logW(LL_INFO, "load MKI:", path);
-    // open input file
-    ifstream input(path, std::ifstream::in | std::ios::binary);
-    input.imbue(std::locale::classic());
-
-    if (!input) {
-      logW(LL_WARN, "unable to load MKI: ", path);
-      return;
-    }
-
-    char byteBuf = 0;
-
-    auto readByte = [&]() {
-      if (!input.eof()) {
-        input.read(&byteBuf, 1);
-        return true;
-      }
-      logW(LL_WARN, "invalid MKI file");
-      return false;
-    };
-
-    // auto debugByte = [&]() {
-    // #ifndef NODEBUG
-
-    // std::bitset<8> binRep(byteBuf);
-    // logQ(binRep);
-
-    // #endif
-    //};
-
-    // #define readByte(); if(!readByte()) { return; }
-
-    // 0x00
-
-    readByte();
-
-    nowLine = byteBuf & (1 << 7);
-    showFPS = byteBuf & (1 << 6);
-    showImage = byteBuf & (1 << 5);
-    sheetMusicDisplay = byteBuf & (1 << 4);
-    measureLine = byteBuf & (1 << 3);
-    measureNumber = byteBuf & (1 << 2);
-
-    bool imageExists = byteBuf & (1 << 1);
-
-    // logQ(nowLine);
-    // logQ(showFPS);
-    // logQ(showImage);
-    // logQ(sheetMusicDisplay);
-    // logQ(measureLine);
-    // logQ(measureNumber);
-    // logQ(imageExists);
-
-    // debugByte();
-
-    // 0x01-0x02 (reserved)
-    readByte();
-    readByte();
-
-    // 0x03
-    readByte();
-
-    colorMode = (byteBuf >> 4) & 0xF;
-    displayMode = byteBuf & 0xF;
+  // parse into a fresh instance off the render thread, the current file stays
+  // up until updateLoad() swaps in the result; the pending job is cancelled
+  // when a newer file is requested
+  retireLoad();
+  job = std::make_unique<loadJob>();
+  job->path = path;
+  job->type = isValidPath(path, PATH_MKI) ? FILE_MKI : FILE_MIDI;
+  job->context = getAnalysisContext();
 
-    // 0x04
-    readByte();
-    // debugByte();
+  logW(LL_INFO, job->type == FILE_MKI ? "load MKI:" : "load MIDI:", path);
 
-    songTimeType = (byteBuf >> 4) & 0xF;
-    tonicOffset = byteBuf & 0x0F;
-
-    // 0x05-0x07 (reserved)
-    readByte();
-    readByte();
-    readByte();
-
-    // 0x08-0x0B - zoom level
-    char zoomBuf[4] = {0};
-    for (int i = 0; i < 4; ++i) {
-      readByte();
-      // debugByte();
-      zoomBuf[i] = byteBuf;
-    }
-
-    zoomLevel = *(reinterpret_cast<float*>(zoomBuf));
-    // logQ("READ ZOOMLEVEL", zoomLevel);
-
-    // logQ(zoomLevel);
-
-    // position need not exceed 16 bits
-    // 0x0C-0x0D - image position (x)
-    // 0x0E-0x0F - image position (y)
-    // 0x10-0x13 - scale
-    // 0x14-0x17 - default scale
-    // 0x18-0x1B - mean value
-    // 0x1C-0x1F - color count
-
-    // if no image exists, all values are left zero
-
-    int16_t i_posx = 0;
-    int16_t i_posy = 0;
-    float i_scale = 0;
-    float i_def_scale = 0;
-    float i_mean_v = 0;
-    int i_num_col = 0;
-
-    if (imageExists) {
-      // 0x0C-0x0D - image position (x)
-      char imageBuf[2] = {0};
-      for (int i = 0; i < 2; ++i) {
-        readByte();
-        // debugByte();
-        imageBuf[i] = byteBuf;
-      }
-      i_posx = *(reinterpret_cast<uint16_t*>(imageBuf));
-
-      // 0x0E-0x0F - image position (y)
-      // char imageBuf[4] = {0};
-      for (int i = 0; i < 2; ++i) {
-        readByte();
-        // debugByte();
-        imageBuf[i] = byteBuf;
-      }
-      i_posy = *(reinterpret_cast<uint16_t*>(imageBuf));
-
-      // 0x10-0x13 - scale
-      char imageBuf2[4] = {0};
-      for (int i = 0; i < 4; ++i) {
-        readByte();
-        // debugByte();
-        imageBuf2[i] = byteBuf;
-      }
-      i_scale = *(reinterpret_cast<float*>(imageBuf2));
-
-      // 0x14-0x17 - default scale
-      // char imageBuf2[4] = {0};
-      for (int i = 0; i < 4; ++i) {
-        readByte();
-        // debugByte();
-        imageBuf2[i] = byteBuf;
-      }
-      i_def_scale = *(reinterpret_cast<float*>(imageBuf2));
-
-      // 0x18-0x1B - mean value
-      // char imageBuf2[4] = {0};
-      for (int i = 0; i < 4; ++i) {
-        readByte();
-        // debugByte();
-        imageBuf2[i] = byteBuf;
-      }
-      i_mean_v = *(reinterpret_cast<float*>(imageBuf2));
-
-      // 0x1C-0x1F - color count
-      // char imageBuf2[4] = {0};
-      for (int i = 0; i < 4; ++i) {
-        readByte();
-        // debugByte();
-        imageBuf2[i] = byteBuf;
-      }
-      i_num_col = *(reinterpret_cast<uint32_t*>(imageBuf2));
-    }
-    else {
-      // ignore image metadata block otherwise
-      for (auto i = 0; i < imageBlockSize; ++i) {
-        readByte();
-      }
-    }
-
-    auto readRGB = [&]() {
-      readByte();
-      uint8_t r = *reinterpret_cast<uint8_t*>(&byteBuf);
-      readByte();
-      uint8_t g = *reinterpret_cast<uint8_t*>(&byteBuf);
-      readByte();
-      uint8_t b = *reinterpret_cast<uint8_t*>(&byteBuf);
-
-      colorRGB col(r, g, b);
-
-      return col;
-    };
-
-    // 0x20-0x43 - tonic (on) colors
-    // 0x44-0x67 - tonic (off) colors
-    for (auto& col : setTonicOn) {
-      col = readRGB();
-    }
-    for (auto& col : setTonicOff) {
-      col = readRGB();
-    }
-
-    // 0x68-0x1E7  velocity (on) colors
-    // 0x1E8-0x367 velocity (off) colors
-    for (auto& col : setVelocityOn) {
-      col = readRGB();
-    }
-    for (auto& col : setVelocityOff) {
-      col = readRGB();
-    }
-
-    // 0x368-0x36A - background color
-    bgColor = readRGB();
-    // logQ("READ COLOR", bgColor);
+  loadJob* j = job.get();
+  j->worker = thread([j] {
+    parseFile(*j);
+    j->ready = true;
+  });
+}
 
-    // 0x36B-0x36E - track size marker (n)
-    char trackSizeBuf[4] = {0};
-    for (int i = 0; i < 4; ++i) {
-      readByte();
-      // debugByte();
-      trackSizeBuf[i] = byteBuf;
-    }
+void controller::retireLoad() {
+  // the worker may still be mid-parse, it is joined on the reaper thread
+  if (job) {
+    job->status.cancel = true;
+    reaper().retire(std::move(job));
+  }
+}
 
-    int trackSetSize = *(reinterpret_cast<int*>(&trackSizeBuf));
+void controller::parseFile(loadJob& j) {
+  // runs on the loader thread, only touches the job
+  TRACE_THREAD("loader");
+  TRACE_ZONE("parse file");
+  auto start = std::chrono::high_resolution_clock::now();
 
-    if (trackSetSize > (1 << 15)) {
-      logW(LL_WARN, "file parameters exceed limits");
-      logW(LL_WARN, trackSetSize);
+  if (j.type == FILE_MKI) {
+    vector<char> data;
+    if (!readFileData(j.path, data)) {
+      logW(LL_WARN, "unable to load MKI: ", j.path);
       return;
     }
 
-    setTrackOn.resize(trackSetSize);
-    setTrackOff.resize(trackSetSize);
-
-    // 0x36F-0x36F+(n*3)       track (on) colors
-    // 0x36F+(n*3)-0x36F+(n*6) track (off) colors
-    for (auto i = 0; i < trackSetSize; ++i) {
-      setTrackOn[i] = readRGB();
-    }
-    for (auto i = 0; i < trackSetSize; ++i) {
-      setTrackOff[i] = readRGB();
-    }
-
-    // HERE IS MIDI STREAM DATA
-
-    // next 4 bytes is midi size
-    char midiSizeBuf[4] = {0};
-    for (int i = 0; i < 4; ++i) {
-      readByte();
-      // debugByte();
-      midiSizeBuf[i] = byteBuf;
-    }
-
-    int midiSize = *reinterpret_cast<int*>(midiSizeBuf);
-    // logQ("MIDI size is:", midiSize);
-
-    for (auto i = 0; i < midiSize; ++i) {
-      readByte();
-      midiData.write(&byteBuf, sizeof(byteBuf));
+    j.valid = isMKIv2(data) ? loadMKI2(data, j) : loadMKI(data, j);
+    if (!j.valid && !j.status.cancel) {
+      logW(LL_WARN, "invalid MKI file");
     }
+  }
+  else {
+    j.valid = j.file.load(j.path, j.data, j.context, &j.status);
+  }
 
-    file.load(midiData);
+  debug_time(start, "load");
+}
 
-    // HERE IS IMAGE STREAM DATA (if exists)
+bool controller::updateLoad(bool& nowLine, bool& showFPS, bool& showImage, bool& sheetMusicDisplay,
+                            bool& measureLine, bool& measureNumber,
 
-    if (imageExists) {
-      // next 4 bytes is image format
-      char imageFormatBuf[4] = {0};
-      for (int i = 0; i < 4; ++i) {
-        readByte();
-        // debugByte();
-        imageFormatBuf[i] = byteBuf;
-      }
+                            int& colorMode, int& displayMode,
 
-      // error handling of image format handled in loader function
-      int imageFormat = *reinterpret_cast<int*>(&imageFormatBuf);
-      // logQ("READ IMGFORMAT", imageFormat);
+                            int& songTimeType, int& tonicOffset,
 
-      // next 4 bytes is image size
-      char imageSizeBuf[4] = {0};
-      for (int i = 0; i < 4; ++i) {
-        readByte();
-        // debugByte();
-        imageSizeBuf[i] = byteBuf;
-      }
+                            double& zoomLevel) {
+  if (!job || !job->ready) {
+    return false;
+  }
 
-      int imageSize = *reinterpret_cast<int*>(&imageSizeBuf);
+  unique_ptr<loadJob> j = std::move(job);
+  j->worker.join();
 
-      stringstream imageData;
+  if (!j->valid) {
+    logW(LL_WARN, "unable to load", j->path);
+    return false;
+  }
 
-      for (auto i = 0; i < imageSize; ++i) {
-        readByte();
-        imageData.write(&byteBuf, sizeof(byteBuf));
-      }
+  // the fft generator may still be reading the notes swapped out below, and
+  // its bins index them
+  fft.generator_join();
 
-      // logQ(imageData.str());
-      //  finally load the image
-      image.load(imageData, imageSize, imageFormat);
-
-      // set the image parameters after loading
-      image.position.x = i_posx;
-      image.position.y = i_posy;
-      image.scale = i_scale;
-      image.defaultScale = i_def_scale;
-      image.meanV = i_mean_v;
-      image.numColors = i_num_col;
+  // the previous file is released along with the job, which is retired once
+  // the swap is done
+  file.swap(j->file);
+  midiData.swap(j->data);
+  tiles.clear();
+  fft.clearBins();
+
+  // sheet layout measures glyphs from the font cache, so it stays on the
+  // render thread and runs once the song is swapped in
+  sheetData.reset();
+  {
+    TRACE_ZONE("sheet: layout");
+    for (auto& measure : file.measureMap) {
+      sheetData.disectMeasure(measure);
+    }
+  }
+  sheetData.findSheetPages();
+
+  if (j->type == FILE_MKI) {
+    setTonicOn = std::move(j->colors.tonicOn);
+    setTonicOff = std::move(j->colors.tonicOff);
+    setVelocityOn = std::move(j->colors.velocityOn);
+    setVelocityOff = std::move(j->colors.velocityOff);
+    setTrackOn = std::move(j->colors.trackOn);
+    setTrackOff = std::move(j->colors.trackOff);
+    bgColor = j->colors.background;
+
+    const mkiSettings& view = j->view;
+    nowLine = view.nowLine;
+    showFPS = view.showFPS;
+    showImage = view.showImage;
+    sheetMusicDisplay = view.sheetMusicDisplay;
+    measureLine = view.measureLine;
+    measureNumber = view.measureNumber;
+    colorMode = view.colorMode;
+    displayMode = view.displayMode;
+    songTimeType = view.songTimeType;
+    tonicOffset = view.tonicOffset;
+    zoomLevel = view.zoomLevel;
+
+    if (!j->imageBytes.empty()) {
+      loadImage(j->imageBytes.data(), j->imageBytes.size(), j->imageInfo);
     }
 
     // update background-dependent values
     setShaderValue("SH_VORONOI", "bg_color", bgColor);
     optimizeBGColor();
-
-    // last, set MKI loaded flag
-    fType = FILE_MKI;
   }
   else {
-    logW(LL_INFO, "load MIDI:", path);
-
-    file.load(path, midiData);
-
     getColorScheme(KEY_COUNT, setVelocityOn, setVelocityOff);
     getColorScheme(TONIC_COUNT, setTonicOn, setTonicOff);
     getColorScheme(getTrackCount(), setTrackOn, setTrackOff, file.trackHeightMap);
-
-    // last, set non-MKI loaded flag
-    fType = FILE_MIDI;
   }
 
-  fPath = path;
+  // last, set loaded flag
+  fType = j->type;
+  setFilePath(j->path);
   fileOutput.load(file.message);
   particle.end_emission();
 
-  debug_time(start, "load");
+  reaper().retire(std::move(j));
+  return true;
 }
 
-void controller::save(string path, bool nowLine, bool showFPS, bool showImage, bool sheetMusicDisplay, bool measureLine,
-                      bool measureNumber,
+bool controller::loadMKI(const vector<char>& data, loadJob& j) {
+  // v1 layout, fixed offsets up to the track colors
+  mkiReader input(data.data(), data.size());
 
-                      int colorMode, int displayMode,
-
-                      int songTimeType, int tonicOffset,
-
-                      double zoomLevel) {
-  // open output file
-  ofstream output(path, std::ofstream::out | std::ofstream::trunc | std::ios::binary);
-  output.imbue(std::locale::classic());
-
-  if (!output) {
-    logW(LL_WARN, "unable to save file to", path);
-    return;
-  }
-
-  // output << midiData.str();
+  // 0x00:[7:2] - display flags
+  // 0x00:[1:1] - image existence
+  uint8_t byte0 = 0;
+  input.read(byte0);
 
-  const uint8_t emptyByte = 0;
+  j.view.nowLine = byte0 & (1 << 7);
+  j.view.showFPS = byte0 & (1 << 6);
+  j.view.showImage = byte0 & (1 << 5);
+  j.view.sheetMusicDisplay = byte0 & (1 << 4);
+  j.view.measureLine = byte0 & (1 << 3);
+  j.view.measureNumber = byte0 & (1 << 2);
 
-  // 0x00:[7:7] - now line
-  // 0x00:[6:6] - fps display
-  // 0x00:[5:5] - image display
-  // 0x00:[4:4] - sheet music display
-  // 0x00:[3:3] - measure line display
-  // 0x00:[2:2] - measure number display
-  // 0x00:[1:1] - image existence
-  // 0x00:[0:0] - reserved
+  bool imageExists = byte0 & (1 << 1);
 
-  uint8_t byte0 = 0;
-  byte0 |= (nowLine << 7);
-  byte0 |= (showFPS << 6);
-  byte0 |= (showImage << 5);
-  byte0 |= (sheetMusicDisplay << 4);
-  byte0 |= (measureLine << 3);
-  byte0 |= (measureNumber << 2);
-  byte0 |= (image.exists() << 1);
+  // 0x01-0x02 (reserved)
+  input.skip(2);
 
-  // logQ(byte0);
+  // 0x03 - scheme color type, display type
+  uint8_t byte3 = 0;
+  input.read(byte3);
 
-  output.write(reinterpret_cast<const char*>(&byte0), sizeof(byte0));
+  j.view.colorMode = (byte3 >> 4) & 0xF;
+  j.view.displayMode = byte3 & 0xF;
 
-  // 0x01:[7:0] - reserved
-  // 0x02:[7:0] - reserved
+  // 0x04 - song time display type, tonic offset
+  uint8_t byte4 = 0;
+  input.read(byte4);
 
-  output.write(reinterpret_cast<const char*>(&emptyByte), sizeof(emptyByte));
-  output.write(reinterpret_cast<const char*>(&emptyByte), sizeof(emptyByte));
+  j.view.songTimeType = (byte4 >> 4) & 0xF;
+  j.view.tonicOffset = byte4 & 0x0F;
 
-  // 0x03:[7:4] - scheme color type
-  // 0x03:[3:0] - display type
+  // 0x05-0x07 (reserved)
+  input.skip(3);
 
-  uint8_t byte3 = 0;
+  // 0x08-0x0B - zoom level
+  float zoom = 0;
+  input.read(zoom);
+  j.view.zoomLevel = zoom;
 
-  byte3 |= (static_cast<uint8_t>(colorMode) << 4);
-  byte3 |= (static_cast<uint8_t>(displayMode) & 0xF);
+  // 0x0C-0x1F - image metadata, left zero if no image exists
+  mkiImageInfo& info = j.imageInfo;
+  if (imageExists) {
+    input.read(info.x);
+    input.read(info.y);
+    input.read(info.scale);
+    input.read(info.defaultScale);
+    input.read(info.meanV);
+    input.read(info.numColors);
+  }
+  else {
+    input.skip(imageBlockSize);
+  }
 
-  // logQ((unsigned int)byte3);
+  // 0x20- - colors
+  if (!readColors(input, j.colors)) {
+    return false;
+  }
 
-  output.write(reinterpret_cast<const char*>(&byte3), sizeof(byte3));
+  // midi size (4 bytes) and data
+  uint32_t midiSize = 0;
+  input.read(midiSize);
+  const char* midiBytes = input.view(midiSize);
 
-  // 0x04:[7:4] - song time display type
-  // 0x04:[3:0] - tonic offset
+  if (!input.good()) {
+    return false;
+  }
 
-  uint8_t byte4 = 0;
+  j.data.str(string(midiBytes, midiSize));
+  if (!j.file.load(j.data, j.context, {}, &j.status)) {
+    return false;
+  }
 
-  byte4 |= (static_cast<uint8_t>(songTimeType) << 4);
-  // logQ(bitset<8>(songTimeType));
-  // logQ(bitset<8>(byte4));
-  byte4 |= (static_cast<uint8_t>(tonicOffset) & 0xF);
+  // image format (4 bytes), size (4 bytes) and data
+  if (imageExists) {
+    uint32_t imageSize = 0;
+    input.read(info.format);
+    input.read(imageSize);
+    const char* imageBytes = input.view(imageSize);
 
-  output.write(reinterpret_cast<const char*>(&byte4), sizeof(byte4));
+    if (!input.good()) {
+      return false;
+    }
 
-  // 0x05:[7:0] - reserved
-  // 0x06:[7:0] - reserved
-  // 0x07:[7:0] - reserved
+    j.imageBytes.assign(imageBytes, imageSize);
+  }
 
-  output.write(reinterpret_cast<const char*>(&emptyByte), sizeof(emptyByte));
-  output.write(reinterpret_cast<const char*>(&emptyByte), sizeof(emptyByte));
-  output.write(reinterpret_cast<const char*>(&emptyByte), sizeof(emptyByte));
+  return true;
+}
 
-  // 0x08-0x0B - zoom level (4bit float (cast from double))
+bool controller::loadMKI2(const vector<char>& data, loadJob& j) {
+  mkiReader input(data.data(), data.size());
+  if (!readMKIHeader(input)) {
+    return false;
+  }
 
-  float zlf = static_cast<float>(zoomLevel);
+  // chunks may come in any order, collect them before applying
+  unordered_map<string, mkiChunk> chunks;
+  mkiChunk chunk;
+  while (readMKIChunk(input, chunk)) {
+    chunks[chunk.tag] = chunk;
+  }
 
-  // logQ("WRITE ZOOMLEVEL", zoomLevel);
+  for (const char* tag : {"VIEW", "COLR", "MIDI"}) {
+    if (chunks.find(tag) == chunks.end()) {
+      logW(LL_WARN, "missing MKI chunk", tag);
+      return false;
+    }
+  }
 
-  // logQ("zl", zlf);
+  vector<char> storage;
+  const char* payload = nullptr;
+  size_t payloadSize = 0;
 
-  output.write(reinterpret_cast<const char*>(&zlf), sizeof(zlf));
-  // logQ(static_cast<float>(zoomLevel));
+  // VIEW
+  if (!getChunkPayload(chunks["VIEW"], storage, payload, payloadSize)) {
+    return false;
+  }
+  mkiReader viewData(payload, payloadSize);
 
-  // position need not exceed 16 bits
-  // 0x0C-0x0D - image position (x)
-  // 0x0E-0x0F - image position (y)
-  // 0x10-0x13 - scale
-  // 0x14-0x17 - default scale
-  // 0x18-0x1B - mean value
-  // 0x1C-0x1F - color count
+  uint8_t flags = 0;
+  uint8_t modes[4] = {0};
+  float zoom = 0;
+  viewData.read(flags);
+  viewData.read(modes);
+  viewData.read(zoom);
 
-  // if no image exists, all values are left zero
+  j.view.nowLine = flags & (1 << 7);
+  j.view.showFPS = flags & (1 << 6);
+  j.view.showImage = flags & (1 << 5);
+  j.view.sheetMusicDisplay = flags & (1 << 4);
+  j.view.measureLine = flags & (1 << 3);
+  j.view.measureNumber = flags & (1 << 2);
+  j.view.colorMode = modes[0];
+  j.view.displayMode = modes[1];
+  j.view.songTimeType = modes[2];
+  j.view.tonicOffset = modes[3];
+  j.view.zoomLevel = zoom;
 
-  if (image.exists()) {
-    int16_t x = static_cast<int16_t>(image.position.x);
-    int16_t y = static_cast<int16_t>(image.position.y);
-    output.write(reinterpret_cast<const char*>(&x), sizeof(y));
-    output.write(reinterpret_cast<const char*>(&y), sizeof(y));
+  // COLR
+  if (!getChunkPayload(chunks["COLR"], storage, payload, payloadSize)) {
+    return false;
+  }
+  mkiReader colorData(payload, payloadSize);
+  if (!viewData.good() || !readColors(colorData, j.colors)) {
+    return false;
+  }
 
-    float i_scale = image.scale;
-    float i_defaultScale = image.defaultScale;
-    float i_meanV = image.meanV;
+  // TRCK (optional)
+  vector<int> trackHint;
+  if (chunks.count("TRCK") && getChunkPayload(chunks["TRCK"], storage, payload, payloadSize)) {
+    trackHint.resize(payloadSize / sizeof(int32_t));
+    memcpy(trackHint.data(), payload, trackHint.size() * sizeof(int32_t));
+  }
 
-    output.write(reinterpret_cast<const char*>(&i_scale), sizeof(i_scale));
-    output.write(reinterpret_cast<const char*>(&i_defaultScale), sizeof(i_defaultScale));
-    output.write(reinterpret_cast<const char*>(&i_meanV), sizeof(i_meanV));
-    output.write(reinterpret_cast<const char*>(&image.numColors), sizeof(image.numColors));
+  // MIDI
+  if (!getChunkPayload(chunks["MIDI"], storage, payload, payloadSize)) {
+    return false;
+  }
+  j.data.str(string(payload, payloadSize));
+  if (!j.file.load(j.data, j.context, trackHint, &j.status)) {
+    return false;
   }
-  else {
-    // needed to maintain file block formatting
 
-    for (auto i = 0; i < imageBlockSize; ++i) {
-      output.write(reinterpret_cast<const char*>(&emptyByte), sizeof(emptyByte));
+  // IMGM/IMAG (optional)
+  if (chunks.count("IMGM") && chunks.count("IMAG")) {
+    mkiImageInfo& info = j.imageInfo;
+    if (!getChunkPayload(chunks["IMGM"], storage, payload, payloadSize)) {
+      return false;
+    }
+    mkiReader imageInfo(payload, payloadSize);
+    imageInfo.read(info.x);
+    imageInfo.read(info.y);
+    imageInfo.read(info.scale);
+    imageInfo.read(info.defaultScale);
+    imageInfo.read(info.meanV);
+    imageInfo.read(info.numColors);
+    imageInfo.read(info.format);
+
+    if (imageInfo.good() && getChunkPayload(chunks["IMAG"], storage, payload, payloadSize)) {
+      j.imageBytes.assign(payload, payloadSize);
     }
   }
 
+  return true;
+}
+
+bool controller::readColors(mkiReader& input, mkiColors& colors) {
   // colorRGB has 3 bytes per object
   // track order (on, off):
   // tonic(12)            -> 72    bytes of tonic color data
   // velocity(128)        -> 768   bytes of velocity color data
-  // track(variable)      -> n*3*2 bytes of track color data
+  // background           -> 3     bytes
+  // track(variable)      -> 4 + n*3*2 bytes of track color data
+  auto readRGB = [&]() {
+    uint8_t rgb[3] = {0};
+    input.read(rgb);
+    return colorRGB(rgb[0], rgb[1], rgb[2]);
+  };
+
+  colors.tonicOn.resize(TONIC_COUNT);
+  colors.tonicOff.resize(TONIC_COUNT);
+  colors.velocityOn.resize(KEY_COUNT);
+  colors.velocityOff.resize(KEY_COUNT);
+
+  for (auto& col : colors.tonicOn) {
+    col = readRGB();
+  }
+  for (auto& col : colors.tonicOff) {
+    col = readRGB();
+  }
+  for (auto& col : colors.velocityOn) {
+    col = readRGB();
+  }
+  for (auto& col : colors.velocityOff) {
+    col = readRGB();
+  }
+
+  colors.background = readRGB();
+
+  uint32_t trackSetSize = 0;
+  input.read(trackSetSize);
+
+  if (!input.good() || trackSetSize > (1 << 15)) {
+    logW(LL_WARN, "file parameters exceed limits");
+    logW(LL_WARN, trackSetSize);
+    return false;
+  }
 
+  colors.trackOn.resize(trackSetSize);
+  colors.trackOff.resize(trackSetSize);
+
+  for (auto& col : colors.trackOn) {
+    col = readRGB();
+  }
+  for (auto& col : colors.trackOff) {
+    col = readRGB();
+  }
+
+  return input.good();
+}
+
+void controller::writeColors(mkiWriter& output) {
   auto writeRGB = [&](colorRGB col) {
-    uint8_t r = round(col.r);
-    uint8_t g = round(col.g);
-    uint8_t b = round(col.b);
-
-    // all items are uint8_t
-    output.write(reinterpret_cast<const char*>(&r), sizeof(r));
-    output.write(reinterpret_cast<const char*>(&g), sizeof(g));
-    output.write(reinterpret_cast<const char*>(&b), sizeof(b));
+    uint8_t rgb[3] = {static_cast<uint8_t>(round(col.r)), static_cast<uint8_t>(round(col.g)),
+                      static_cast<uint8_t>(round(col.b))};
+    output.write(rgb);
   };
 
-  // 0x20-0x43 - tonic (on) colors
-  // 0x44-0x67 - tonic (off) colors
   for (auto col : setTonicOn) {
     writeRGB(col);
   }
   for (auto col : setTonicOff) {
     writeRGB(col);
   }
-
-  // 0x68-0x1E7  velocity (on) colors
-  // 0x1E8-0x367 velocity (off) colors
   for (auto col : setVelocityOn) {
     writeRGB(col);
   }
@@ -1192,61 +1263,111 @@ void controller::save(string path, bool nowLine, bool showFPS, bool showImage, b
     writeRGB(col);
   }
 
-  // 0x368-0x36A - background color
   writeRGB(bgColor);
-  // logQ("WRITE COLOR", bgColor);
-
-  // 0x36B-0x36E - track size marker (n)
-  // 0x36F-0x36F+(n*3)       track (on) colors
-  // 0x36F+(n*3)-0x36F+(n*6) track (off) colors
-  uint32_t trackSetSize = setTrackOn.size();
-  // logQ("OUTN", trackSetSize);
-  output.write(reinterpret_cast<const char*>(&trackSetSize), sizeof(trackSetSize));
 
+  output.write(static_cast<uint32_t>(setTrackOn.size()));
   for (auto col : setTrackOn) {
     writeRGB(col);
   }
   for (auto col : setTrackOff) {
     writeRGB(col);
   }
+}
 
-  // logQ(midiData.str());
+void controller::loadImage(const char* data, int size, const mkiImageInfo& info) {
+  // error handling of image format handled in loader function
+  image.load(data, size, info.format);
+
+  // set the image parameters after loading
+  image.position.x = info.x;
+  image.position.y = info.y;
+  image.scale = info.scale;
+  image.defaultScale = info.defaultScale;
+  image.meanV = info.meanV;
+  image.numColors = info.numColors;
+}
 
-  // get size of midi data
-  // midiData.seekg(0, std::ios::end);
-  // uint32_t midiSize = midiData.tellg();
-  // midiData.seekg(0, std::ios::beg);
-  uint32_t midiSize = midiData.str().size();
+void controller::save(string path, bool nowLine, bool showFPS, bool showImage, bool sheetMusicDisplay, bool measureLine,
+                      bool measureNumber,
 
-  // logQ("midisize marker is", sizeof(midiSize), "bytes");
-  output.write(reinterpret_cast<const char*>(&midiSize), sizeof(midiSize));
-  // logQ("saved MIDI length is", midiSize, "bytes");
-  output.write(midiData.str().c_str(), midiData.str().size());
+                      int colorMode, int displayMode,
 
-  // in variable length regime, only write if the marker is set at 0x00[1:1]
-  // here, no need to check marker, just check for existence of a loaded image
-  if (image.exists()) {
-    // first write image type (4bytes)
-    output.write(reinterpret_cast<const char*>(&image.format), sizeof(image.format));
+                      int songTimeType, int tonicOffset,
 
-    // logQ("WRITE IMGFORMAT", image.format);
+                      double zoomLevel) {
+  // open output file
+  ofstream output(path, std::ofstream::out | std::ofstream::trunc | std::ios::binary);
+  output.imbue(std::locale::classic());
+
+  if (!output) {
+    logW(LL_WARN, "unable to save file to", path);
+    return;
+  }
 
-    // get size of image data
-    // image.buf.seekg(0, std::ios::end);
-    // uint32_t imageSize = image.buf.tellg();
-    // image.buf.seekg(0, std::ios::beg);
-    uint32_t imageSize = image.buf.str().size();
+  // files are written in the chunked v2 layout, see mki.h
+  writeMKIHeader(output);
+
+  mkiWriter chunk;
+
+  // VIEW - display settings, same bit layout as v1 bytes 0x00-0x0B
+  uint8_t flags = 0;
+  flags |= (nowLine << 7);
+  flags |= (showFPS << 6);
+  flags |= (showImage << 5);
+  flags |= (sheetMusicDisplay << 4);
+  flags |= (measureLine << 3);
+  flags |= (measureNumber << 2);
+  flags |= (image.exists() << 1);
+
+  chunk.write(flags);
+  chunk.write(static_cast<uint8_t>(colorMode));
+  chunk.write(static_cast<uint8_t>(displayMode));
+  chunk.write(static_cast<uint8_t>(songTimeType));
+  chunk.write(static_cast<uint8_t>(tonicOffset));
+  chunk.write(static_cast<float>(zoomLevel));
+  writeMKIChunk(output, "VIEW", chunk.data().data(), chunk.data().size());
+
+  // COLR - tonic, velocity, background and track colors
+  chunk.clear();
+  writeColors(chunk);
+  writeMKIChunk(output, "COLR", chunk.data().data(), chunk.data().size());
+
+  // MIDI - original file, compressed
+  const string& midiBytes = midiData.str();
+  writeMKIChunk(output, "MIDI", midiBytes.data(), midiBytes.size(), true);
+
+  // TRCK - precomputed track division, lets the loader skip the splitter
+  if (file.isTrackSplit()) {
+    chunk.clear();
+    for (const auto& n : file.notes) {
+      chunk.write(static_cast<int32_t>(n.track));
+    }
+    writeMKIChunk(output, "TRCK", chunk.data().data(), chunk.data().size(), true);
+  }
 
-    output.write(reinterpret_cast<const char*>(&imageSize), sizeof(imageSize));
-    // logQ(imageSize);
-    // output.write(image.buf.str().c_str(), image.buf.str().size());
-    output << image.buf.rdbuf();
+  // IMGM/IMAG - image placement and the original encoded image
+  if (image.exists()) {
+    chunk.clear();
+    chunk.write(static_cast<int16_t>(image.position.x));
+    chunk.write(static_cast<int16_t>(image.position.y));
+    chunk.write(static_cast<float>(image.scale));
+    chunk.write(static_cast<float>(image.defaultScale));
+    chunk.write(static_cast<float>(image.meanV));
+    chunk.write(static_cast<int32_t>(image.numColors));
+    chunk.write(static_cast<int32_t>(image.format));
+    writeMKIChunk(output, "IMGM", chunk.data().data(), chunk.data().size());
 
-    // logQ(image.buf.str());
+    const string& imageBytes = image.buf.str();
+    writeMKIChunk(output, "IMAG", imageBytes.data(), imageBytes.size());
   }
 
   fType = FILE_MKI;
+  setFilePath(path);
+}
+
+void controller::setFilePath(const string& path) {
   fPath = path;
+  fName = fPath.substr(fPath.find_last_of("/\\") + 1);
 }
 
 void controller::setCloseFlag() {
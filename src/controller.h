@@ -1,8 +1,11 @@
 #pragma once
 
+#include <atomic>
 #include <functional>
+#include <memory>
 #include <random>
 #include <sstream>
+#include <thread>
 #include <unordered_map>
 #include <vector>
 
@@ -13,31 +16,73 @@
 #include "colorgen.h"
 #include "data.h"
 #include "dialog.h"
+#include "draw_list.h"
+#include "enum.h"
 #include "fft.h"
+#include "gpu_timer.h"
 #include "image.h"
 #include "input.h"
 #include "io.h"
 #include "kmeans.h"
+#include "mem_usage.h"
 #include "menuctr.h"
 #include "midi.h"
+#include "mki.h"
 #include "misc.h"
 #include "option.h"
 #include "output.h"
 #include "output_sync.h"
 #include "particle.h"
+#include "reaper.h"
 #include "shader.h"
 #include "shadow.h"
+#include "sheetctr.h"
 #include "text.h"
+#include "tile.h"
 #include "voronoi.h"
 #include "warning.h"
 
+using std::atomic;
 using std::stringstream;
+using std::thread;
+using std::unique_ptr;
 using std::unordered_map;
 using std::vector;
 
 class menuController;
 class voronoiController;
 
+// song parsed into a fresh instance off the render thread, swapped in by
+// controller::updateLoad(); replaced jobs are destroyed on the reaper thread
+struct loadJob {
+  ~loadJob() {
+    status.cancel = true;
+    if (worker.joinable()) {
+      worker.join();
+    }
+  }
+
+  thread worker;
+  atomic<bool> ready = false;
+  loadProgress status;
+
+  string path;
+  fileType type = FILE_NONE;
+  bool valid = false;
+
+  // option snapshot taken on the render thread
+  analysisContext context;
+
+  midi file;
+  stringstream data;
+
+  // MKI only
+  mkiSettings view;
+  mkiColors colors;
+  mkiImageInfo imageInfo;
+  string imageBytes;
+};
+
 class controller {
  public:
   controller();
@@ -77,14 +122,15 @@ class controller {
   vector<string> generateMenuLabels(const menuContentType& contentType);
 
   void clear();
-  void load(string path, bool& nowLine, bool& showFPS, bool& showImage, bool& sheetMusicDisplay, bool& measureLine,
-            bool& measureNumber,
+  void load(string path);
+  bool updateLoad(bool& nowLine, bool& showFPS, bool& showImage, bool& sheetMusicDisplay, bool& measureLine,
+                  bool& measureNumber,
 
-            int& colorMode, int& displayMode,
+                  int& colorMode, int& displayMode,
 
-            int& songTimeType, int& tonicOffset,
+                  int& songTimeType, int& tonicOffset,
 
-            double& zoomLevel);
+                  double& zoomLevel);
   void save(string path, bool nowLine, bool showFPS, bool showImage, bool sheetMusicDisplay, bool measureLine,
             bool measureNumber,
 
@@ -97,8 +143,10 @@ class controller {
   bool getProgramState() const { return programState; }
   bool getPlayState() const { return playState; }
   bool getLiveState() const { return livePlayState; }
+  bool loading() const { return job != nullptr; }
+  float getLoadProgress() const { return job ? job->status.value.load() : 0; }
   fileType getFileType() const;
-  string getFilePath() const;
+  const string& getFilePath() const;
   string getFileFullPath() const;
   double getRunTime() const { return runTime; }
   double getPauseTime() const { return pauseTime; }
@@ -117,6 +165,12 @@ class controller {
   int getCurrentMeasure() const;
   int getMeasureCount() const;
   string getKeySigLabel(int offset) const;
+
+  analysisContext getAnalysisContext();
+
+  // bytes held per subsystem; logMemoryUsage() dumps the same to the log
+  memoryReport getMemoryUsage() const;
+  void logMemoryUsage() const;
   string getTempoLabel(int offset) const;
   string getNoteLabel(int index);
 
@@ -131,6 +185,7 @@ class controller {
   int findCurrentMeasure(int pos) const;
 
   midi file;
+  sheetController sheetData;
   midiInput input;
   midiOutput output;
   stringstream midiData;
@@ -148,8 +203,11 @@ class controller {
 
   particleController particle;
   shadowController shadow;
+  tileController tiles;
+  drawList scene;
   voronoiController voronoi;
   fftController fft;
+  gpuTimer gpuTime;
 
   bool run = false;
 
@@ -192,7 +250,7 @@ class controller {
   static constexpr int prefHeight = 254;
 
   static constexpr int fileWidth = 500;
-  static constexpr int fileHeight = 254;
+  static constexpr int fileHeight = 300;
 
   static constexpr int infoWidth = 500;
   static constexpr int infoHeight = 254;
@@ -208,12 +266,24 @@ class controller {
 
  private:
   void initData(const vector<asset>& assetSet);
+  void uploadImage(const string& id, Image& img);
+  void finishImages();
+  void warmUp();
+  void setFilePath(const string& path);
 
   void updateKeyState();
   void updateDimension(double& nowLineX);
   void updateFPS();
   void updateDroppedFiles();
 
+  void retireLoad();
+  static void parseFile(loadJob& j);
+  static bool loadMKI(const vector<char>& data, loadJob& j);
+  static bool loadMKI2(const vector<char>& data, loadJob& j);
+  static bool readColors(mkiReader& input, mkiColors& colors);
+  void writeColors(mkiWriter& output);
+  void loadImage(const char* data, int size, const mkiImageInfo& info);
+
   shaderData& getShaderData(const string& shaderIdentifier);
 
   int lastWidth = 0;
@@ -224,7 +294,11 @@ class controller {
   fileType fType;
   string fPath;
 
+  // file name of fPath, drawn every frame
+  string fName;
+
   unsigned int frameCounter = 0;
+  unsigned int allocReportFrame = 0;
   int curMon;
   double runTime;
   double pauseTime;
@@ -237,7 +311,12 @@ class controller {
 
   outputInstance fileOutput;
 
+  // pending file load, replaced when a newer file is requested
+  unique_ptr<loadJob> job;
+
   unordered_map<string, pair<asset, map<int, Font>>> fontMap;
   unordered_map<string, Texture2D> imageMap;
+  vector<pair<asset, Image>> pendingImages;
+  thread imageDecoder;
   unordered_map<string, shaderData> shaderMap;
 };
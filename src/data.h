@@ -39,9 +39,14 @@
 #define KEY_COUNT 128
 
 #define COLDIST_CIE00
-#define KMEANS_ITERATIONS 2
+#define KMEANS_MAX_ITERATIONS 24
+#define KMEANS_EPSILON 0.25
+#define KMEANS_PRUNE_SLACK 2.0
 #define MAX_UNIQUE_COLORS 10000
 
+// larger background images are downscaled before texture upload
+#define IMAGE_MAX_DIM 4096
+
 #define FFT_MIN_FREQ 20
 #define FFT_MAX_FREQ 44100
 #define FFT_BIN_WIDTH 10
@@ -49,6 +54,68 @@
 
 #define VORONOI_MAX_POINTS 496
 
+#define MIDI_THRU_QUEUE 1024
+#define MIDI_THRU_MSG_SIZE 3
+
+// live history is evicted in chunks of at least this many notes
+#define LIVE_CHUNK_SIZE 4096
+#define LIVE_RETENTION_SEC 300
+
+// key labels use the measures on either side, or the last N live notes
+#define KEY_WINDOW_MEASURES 2
+#define KEY_WINDOW_NOTES 64
+#define KEY_PARALLEL_MIN 65536
+
+// hand splitting runs silence-separated chunks in parallel past this size
+#define SPLIT_PARALLEL_MIN 16384
+
+// line lists are merged in parallel segments past this size
+#define LINE_PARALLEL_MIN 65536
+
+// first block of the per-song measure and sheet arenas, later blocks grow from it
+#define SONG_ARENA_BLOCK (256 * 1024)
+
+// starting size of the per-frame scratch arena, doubled when a frame overflows
+#define FRAME_ARENA_SIZE (256 * 1024)
+
+// frames before debug builds start reporting heap allocations on the render
+// thread, and the least number of frames between two reports
+#define FRAME_ALLOC_WARMUP 300
+#define FRAME_ALLOC_REPORT_INTERVAL 600
+
+// log records queued for the writer thread, and argument bytes kept inline
+// per record
+#define LOG_QUEUE_SIZE 1024
+#define LOG_PAYLOAD_SIZE 224
+
+// zones kept per thread in trace builds, and where the trace key writes them
+#define TRACE_BUFFER_EVENTS 65536
+#define TRACE_FILE "nodumi_trace.json"
+
+// frames between issuing a GPU pass timer and reading it back, and the weight
+// of the newest sample in the per-pass average
+#define GPU_TIMER_FRAMES 4
+#define GPU_TIMER_SMOOTHING 0.1
+
+// zoomed-out summary of the note field: base bucket width in song units, level
+// cap, and the zoom below which bar mode draws from it
+#define LOD_BUCKET_UNITS 32
+#define LOD_MAX_LEVELS 24
+#define LOD_MAX_ZOOM (1.0 / LOD_BUCKET_UNITS)
+
+// cached note field slices in pixels, how many are kept, and how far a note
+// drawing may reach past its bar so neighbouring tiles and the now line are
+// redrawn around it
+#define TILE_WIDTH 512
+#define TILE_CACHE_SIZE 24
+#define TILE_PAD 64
+
+// how far in pixels a hover shape (ring, line box) may reach past its note
+#define HOVER_REACH 64
+
+// compiled shader programs, relative to the executable
+#define SHADER_CACHE_DIR "cache/shader/"
+
 // already defined in <raylib.h>
 // #define RAD2DEG M_PI/180.0f
 // #define DEG2RAD 180.0f/M_PI
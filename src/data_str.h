@@ -86,11 +86,35 @@
                         {"PREF_PARTICLE",                       "Enable Particle Effects"}, \
                         {"PREF_SCALE_VELOCITY",                 "Use Scaled Velocities"}, \
                         {"PREF_SHADOW",                         "Enable Drop Shadow"}, \
+                        {"PREF_LIVE_RETENTION",                 "Live History Window"}, \
                         {"FILE_INFO_LABEL",                     "Information"}, \
                         {"FILE_TYPE",                           "Format"}, \
                         {"FILE_NOTE_COUNT",                     "Note Count"}, \
                         {"FILE_MEASURE_COUNT",                  "Measure Count"}, \
                         {"FILE_TRACK_COUNT",                    "Track Count"}, \
+                        {"MEM_LABEL",                           "Memory"}, \
+                        {"MEM_NOTES",                           "Notes"}, \
+                        {"MEM_LINES",                           "Lines"}, \
+                        {"MEM_CHORDS",                          "Chords"}, \
+                        {"MEM_MESSAGES",                        "Messages"}, \
+                        {"MEM_MEASURES",                        "Measures"}, \
+                        {"MEM_LOD",                             "Zoom Summary"}, \
+                        {"MEM_SHEET",                           "Sheet Music"}, \
+                        {"MEM_PARTICLES",                       "Particles"}, \
+                        {"MEM_IMAGE",                           "Image"}, \
+                        {"MEM_FONTS",                           "Font Atlases"}, \
+                        {"MEM_TEXTURES",                        "Textures/Targets"}, \
+                        {"MEM_FRAME",                           "Frame Scratch"}, \
+                        {"MEM_TOTAL",                           "Total"}, \
+                        {"GPU_VORONOI",                         "Voronoi"}, \
+                        {"GPU_FXAA",                            "FXAA"}, \
+                        {"GPU_MEASURE_BLEND",                   "Measure Blend"}, \
+                        {"GPU_SHADOW_FILL",                     "Shadow Fill"}, \
+                        {"GPU_SHADOW_COMPOSITE",                "Shadow Composite"}, \
+                        {"GPU_SHEET",                           "Sheet Music"}, \
+                        {"GPU_MENU",                            "Menu"}, \
+                        {"GPU_NOTE_TILES",                      "Note Tiles"}, \
+                        {"GPU_TOTAL",                           "GPU Total"}, \
                         {"",                                    ""}, \
                       }
 // clang-format on
@@ -0,0 +1,216 @@
+#include "deltae.h"
+
+#include <bit>
+#include <cmath>
+#include <cstdint>
+
+#include "build_target.h"
+#include "define.h"
+
+namespace cie2k {
+
+// branch-free single precision versions of cie2k::deltaE(), written so the
+// batch loops below vectorize. libm calls would keep them scalar, so the
+// transcendentals are polynomial approximations; the CIE00 kernel stays within
+// 1e-3 of the double precision template
+namespace {
+
+constexpr float pi = M_PI;
+constexpr float to_rad = M_PI / 180.0;
+constexpr float eq25p7 = 6103515625.0f;
+
+FORCE_INLINE float pow7(float x) {
+  float x2 = x * x;
+  return x2 * x2 * x2 * x;
+}
+
+// truncation through int converts in vector registers on any x86-64 target,
+// unlike rintf() and floorf()
+FORCE_INLINE float roundNear(float x) { return static_cast<float>(static_cast<int>(x + (x < 0 ? -0.5f : 0.5f))); }
+
+// sin on [-pi/2, pi/2], taylor series to x^11
+FORCE_INLINE float sinCore(float x) {
+  const float x2 = x * x;
+  return x * (1.0f +
+              x2 * (-1.6666667e-1f +
+                    x2 * (8.3333333e-3f + x2 * (-1.9841270e-4f + x2 * (2.7557319e-6f + x2 * -2.5052108e-8f)))));
+}
+
+// any argument, folded to [-pi, pi]
+FORCE_INLINE float sinFast(float x) {
+  x -= 2.0f * pi * roundNear(x * (0.5f / pi));
+  const float folded = x > 0.5f * pi ? pi - x : (x < -0.5f * pi ? -pi - x : x);
+  return sinCore(folded);
+}
+
+FORCE_INLINE float cosFast(float x) {
+  x -= 2.0f * pi * roundNear(x * (0.5f / pi));
+  const float s = sinCore(x * 0.5f);
+  return 1.0f - 2.0f * s * s;
+}
+
+// e^x for x <= 0 as 2^n * e^r, |r| <= ln2 / 2
+FORCE_INLINE float expFast(float x) {
+  x = x < -87.0f ? -87.0f : x;
+  const float n = roundNear(x * 1.44269504f);
+  const float r = x - n * 0.693147181f;
+  const float p = 1.0f + r * (1.0f + r * (0.5f + r * (1.6666667e-1f +
+                                                      r * (4.1666667e-2f + r * (8.3333333e-3f + r * 1.3888889e-3f)))));
+  return p * std::bit_cast<float>((static_cast<int32_t>(n) + 127) << 23);
+}
+
+// minimax polynomial for atan on [0, 1], folded out to the full circle;
+// atan2(0, 0) is 0
+FORCE_INLINE float atan2Fast(float y, float x) {
+  const float ax = fabsf(x);
+  const float ay = fabsf(y);
+  const float mx = ax > ay ? ax : ay;
+  const float mn = ax > ay ? ay : ax;
+  const float t = mx == 0 ? 0.0f : mn / mx;
+  const float t2 = t * t;
+  float r = t * (0.99997726f + t2 * (-0.33262347f + t2 * (0.19354346f + t2 * (-0.11643287f +
+                                                                          t2 * (0.05265332f + t2 * -0.01172120f)))));
+  r = ay > ax ? 0.5f * pi - r : r;
+  r = x < 0 ? pi - r : r;
+  return y < 0 ? -r : r;
+}
+
+FORCE_INLINE float kernel00(float l1, float a1, float b1, float l2, float a2, float b2) {
+  const float C1 = sqrtf(a1 * a1 + b1 * b1);
+  const float C2 = sqrtf(a2 * a2 + b2 * b2);
+
+  const float C_bar_7 = pow7((C1 + C2) * 0.5f);
+  const float G = 0.5f * (1.0f - sqrtf(C_bar_7 / (C_bar_7 + eq25p7)));
+
+  const float a1_prime = (1.0f + G) * a1;
+  const float a2_prime = (1.0f + G) * a2;
+
+  const float C1_prime = sqrtf(a1_prime * a1_prime + b1 * b1);
+  const float C2_prime = sqrtf(a2_prime * a2_prime + b2 * b2);
+  const float C_prod = C1_prime * C2_prime;
+
+  // atan2(0, 0) is defined as 0, matching the scalar special case
+  float h1_prime = atan2Fast(b1, a1_prime);
+  float h2_prime = atan2Fast(b2, a2_prime);
+  h1_prime += h1_prime < 0 ? 2.0f * pi : 0.0f;
+  h2_prime += h2_prime < 0 ? 2.0f * pi : 0.0f;
+
+  const float delta_L_prime = l2 - l1;
+  const float delta_C_prime = C2_prime - C1_prime;
+
+  float delta_h_prime = h2_prime - h1_prime;
+  delta_h_prime += delta_h_prime < -pi ? 2.0f * pi : 0.0f;
+  delta_h_prime -= delta_h_prime > pi ? 2.0f * pi : 0.0f;
+  delta_h_prime = C_prod == 0 ? 0.0f : delta_h_prime;
+
+  const float delta_H_prime = 2.0f * sqrtf(C_prod) * sinFast(delta_h_prime * 0.5f);
+
+  const float L_bar_prime = (l1 + l2) * 0.5f;
+  const float C_bar_prime = (C1_prime + C2_prime) * 0.5f;
+
+  const float h_sum = h1_prime + h2_prime;
+  float h_bar_prime = fabsf(h1_prime - h2_prime) <= pi ? h_sum : (h_sum < 2.0f * pi ? h_sum + 2.0f * pi : h_sum - 2.0f * pi);
+  h_bar_prime = C_prod == 0 ? h_sum : h_bar_prime * 0.5f;
+
+  const float t = 1.0f - 0.17f * cosFast(h_bar_prime - 30.0f * to_rad) + 0.24f * cosFast(h_bar_prime * 2.0f) +
+                  0.32f * cosFast(h_bar_prime * 3.0f + 6.0f * to_rad) -
+                  0.20f * cosFast(h_bar_prime * 4.0f - 63.0f * to_rad);
+
+  const float theta = (h_bar_prime - 275.0f * to_rad) / (25.0f * to_rad);
+  const float delta_theta = 30.0f * to_rad * expFast(-theta * theta);
+
+  const float C_bar_prime_7 = pow7(C_bar_prime);
+  const float R_C = 2.0f * sqrtf(C_bar_prime_7 / (C_bar_prime_7 + eq25p7));
+
+  const float L_bar_prime_2 = (L_bar_prime - 50.0f) * (L_bar_prime - 50.0f);
+  const float S_L = 1.0f + (0.015f * L_bar_prime_2) / sqrtf(20.0f + L_bar_prime_2);
+  const float S_C = 1.0f + 0.045f * C_bar_prime;
+  const float S_H = 1.0f + 0.015f * C_bar_prime * t;
+
+  const float R_T = -sinFast(2.0f * delta_theta) * R_C;
+
+  const float L_term = delta_L_prime / S_L;
+  const float C_term = delta_C_prime / S_C;
+  const float H_term = delta_H_prime / S_H;
+
+  return sqrtf(L_term * L_term + C_term * C_term + H_term * H_term + R_T * C_term * H_term);
+}
+
+FORCE_INLINE float kernel94(float l1, float a1, float b1, float l2, float a2, float b2) {
+  const float C1 = sqrtf(a1 * a1 + b1 * b1);
+  const float C2 = sqrtf(a2 * a2 + b2 * b2);
+
+  const float delta_L = l1 - l2;
+  const float delta_C = C1 - C2;
+  const float delta_H = (a1 - a2) * (a1 - a2) + (b1 - b2) * (b1 - b2) - delta_C * delta_C;
+
+  const float S_C = 1.0f + 0.045f * C1;
+  const float S_H = 1.0f + 0.015f * C1;
+
+  return sqrtf(delta_L * delta_L + (delta_C / S_C) * (delta_C / S_C) + delta_H / (S_H * S_H));
+}
+
+FORCE_INLINE float kernel76(float l1, float a1, float b1, float l2, float a2, float b2) {
+  return sqrtf((l2 - l1) * (l2 - l1) + (a2 - a1) * (a2 - a1) + (b2 - b1) * (b2 - b1));
+}
+
+#define DELTAE_BATCH(name, kernel)                                                                                   \
+  TARGET_CLONES_AVX2 void name(float l1, float a1, float b1, const float* __restrict l, const float* __restrict a, \
+                               const float* __restrict b, unsigned int n, float* __restrict out) {                   \
+    OPENMP_USE_SIMD                                                                                                  \
+    for (unsigned int i = 0; i < n; ++i) {                                                                           \
+      out[i] = kernel(l1, a1, b1, l[i], a[i], b[i]);                                                                 \
+    }                                                                                                                \
+  }
+
+// CIE94 weighs chroma by the reference, so it also needs the set-as-reference
+// order; CIE00 and CIE76 are symmetric
+FORCE_INLINE float kernel94Rev(float l1, float a1, float b1, float l2, float a2, float b2) {
+  return kernel94(l2, a2, b2, l1, a1, b1);
+}
+
+DELTAE_BATCH(batch00, kernel00)
+DELTAE_BATCH(batch94, kernel94)
+DELTAE_BATCH(batch94Rev, kernel94Rev)
+DELTAE_BATCH(batch76, kernel76)
+
+#undef DELTAE_BATCH
+
+}  // namespace
+
+void deltaE(TYPE f, const colorLAB& ref, const float* l, const float* a, const float* b, unsigned int n, float* out) {
+  switch (f) {
+    case TYPE::CIE_00:
+      batch00(ref.l, ref.a, ref.b, l, a, b, n, out);
+      break;
+    case TYPE::CIE_94:
+      batch94(ref.l, ref.a, ref.b, l, a, b, n, out);
+      break;
+    case TYPE::CIE_76:
+      batch76(ref.l, ref.a, ref.b, l, a, b, n, out);
+      break;
+  }
+}
+
+void deltaE(TYPE f, const float* l, const float* a, const float* b, const colorLAB& sample, unsigned int n,
+            float* out) {
+  if (f == TYPE::CIE_94) {
+    batch94Rev(sample.l, sample.a, sample.b, l, a, b, n, out);
+    return;
+  }
+  deltaE(f, sample, l, a, b, n, out);
+}
+
+}  // namespace cie2k
+
+void deltaEBatch(const colorLAB& ref, const float* l, const float* a, const float* b, unsigned int n, float* out) {
+  cie2k::deltaE(static_cast<cie2k::TYPE>(ctr.option.get(OPTION::CIE_FUNCTION)), ref, l, a, b, n, out);
+}
+
+void deltaEBatch(const float* l, const float* a, const float* b, const colorLAB& sample, unsigned int n, float* out) {
+  cie2k::deltaE(static_cast<cie2k::TYPE>(ctr.option.get(OPTION::CIE_FUNCTION)), l, a, b, sample, n, out);
+}
+
+void deltaEBatch(const colorLAB& ref, const labSet& set, float* out) {
+  deltaEBatch(ref, set.l.data(), set.a.data(), set.b.data(), set.size(), out);
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <vector>
+
+#include "cie2k.h"
+#include "color.h"
+
+using std::vector;
+
+// structure-of-arrays Lab storage for the batch deltaE kernels
+class labSet {
+ public:
+  void resize(unsigned int n) {
+    l.resize(n);
+    a.resize(n);
+    b.resize(n);
+  }
+  void set(unsigned int idx, const colorLAB& col) {
+    l[idx] = col.l;
+    a[idx] = col.a;
+    b[idx] = col.b;
+  }
+  unsigned int size() const { return l.size(); }
+
+  vector<float> l;
+  vector<float> a;
+  vector<float> b;
+};
+
+namespace cie2k {
+// out[i] = deltaE(ref, {l[i], a[i], b[i]}) for i < n
+void deltaE(TYPE f, const colorLAB& ref, const float* l, const float* a, const float* b, unsigned int n, float* out);
+// out[i] = deltaE({l[i], a[i], b[i]}, sample) for i < n; differs from the
+// above for CIE94, which is not symmetric
+void deltaE(TYPE f, const float* l, const float* a, const float* b, const colorLAB& sample, unsigned int n, float* out);
+}  // namespace cie2k
+
+// batch variants of deltaE(), dispatched on OPTION::CIE_FUNCTION; the
+// argument order follows deltaE(reference, sample)
+void deltaEBatch(const colorLAB& ref, const float* l, const float* a, const float* b, unsigned int n, float* out);
+void deltaEBatch(const float* l, const float* a, const float* b, const colorLAB& sample, unsigned int n, float* out);
+void deltaEBatch(const colorLAB& ref, const labSet& set, float* out);
@@ -28,6 +28,10 @@ void dialogController::init() {
   dia_opts.find(PREF::P1)->second.push_back(dialogOption(DIA_OPT::SUBBOX, OPTION::SET_HAND_RANGE, OPTION::HAND_RANGE,
                                                          ctr.text.getStringSet("PREF_HAND_RANGE"),
                                                          {"8", "9", "10", "11"}, {12, 14, 16, 17}));
+  dia_opts.find(PREF::P1)->second.push_back(dialogOption(DIA_OPT::SUBBOX, OPTION::SET_LIVE_RETENTION,
+                                                         OPTION::LIVE_RETENTION,
+                                                         ctr.text.getStringSet("PREF_LIVE_RETENTION"),
+                                                         {"1m", "5m", "15m", "60m"}, {60, 300, 900, 3600}));
   dia_opts.find(PREF::P2)->second.push_back(
       dialogOption(DIA_OPT::CHECK_ONLY, OPTION::PARTICLE, ctr.text.getStringSet("PREF_PARTICLE")));
   dia_opts.find(PREF::P2)->second.push_back(
@@ -199,6 +203,34 @@ void dialogController::renderFile() {
 
     begin_y += max(if_size.y, is_size.y) + 4;
   }
+
+  // memory use per subsystem, in the right half of the dialog
+  if (memRefresh-- <= 0) {
+    memUsage = ctr.getMemoryUsage();
+    memRefresh = memRefreshRate;
+  }
+
+  int mem_x = ctr.getWidth() / 2.0f + 12;
+  int mem_y = fileTopMargin / 2.0f + 12;
+  int mem_end_x = fileSideMargin / 2.0f + ctr.fileWidth - 12;
+  string mem_label_str = ctr.text.getString("MEM_LABEL");
+  drawTextEx(mem_label_str, mem_x, mem_y, ctr.bgDark, 255, file_label_fsize);
+  mem_y += measureTextEx(mem_label_str, file_label_fsize).y + 4;
+
+  size_t mem_total = 0;
+  auto drawMemRow = [&](const string& label, size_t bytes) {
+    string value = formatBytes(bytes);
+    Vector2 value_size = measureTextEx(value, memFontSize);
+    drawTextEx(ctr.text.getString(label), mem_x, mem_y, ctr.bgDark, 255, memFontSize);
+    drawTextEx(value, mem_end_x - value_size.x, mem_y, ctr.bgDark, 255, memFontSize);
+    mem_y += value_size.y + 2;
+  };
+
+  for (const auto& [label, bytes] : memUsage) {
+    drawMemRow(label, bytes);
+    mem_total += bytes;
+  }
+  drawMemRow("MEM_TOTAL", mem_total);
 }
 
 void dialogController::renderInfo() {
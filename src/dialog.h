@@ -7,6 +7,7 @@
 #include "dia_opt.h"
 #include "enum.h"
 #include "log.h"
+#include "mem_usage.h"
 
 using std::string;
 using std::unordered_map;
@@ -39,6 +40,10 @@ class dialogController {
 
   vector<bool> dialog_status = {false, false, false};
 
+  // walking the song structures is not free, refreshed every memRefreshRate frames
+  memoryReport memUsage;
+  int memRefresh = 0;
+
   void renderPreference();
   void renderFile();
   void renderInfo();
@@ -60,6 +65,8 @@ class dialogController {
   static constexpr int itemRectSize = 24;
   static constexpr int itemRectInnerSize = 12;
   static constexpr int itemFontSize = 18;
+  static constexpr int memFontSize = 14;
+  static constexpr int memRefreshRate = 30;
 
   static constexpr int optBottomMargin = 10;
 };
@@ -0,0 +1,65 @@
+#include "draw_list.h"
+
+#include "wrap.h"
+
+void drawList::clear() {
+  commands.clear();
+  emitters.clear();
+  vertex.clear();
+  color.clear();
+  fftNotes.clear();
+  selection.clear();
+  clickIndex = -1;
+  clickOn = false;
+}
+
+void drawList::drawRectangle(float x, float y, float w, float h, const colorRGB& col, unsigned char alpha) {
+  commands.push_back({DRAW_RECTANGLE, {x, y, w, h}, col, float(alpha), 0});
+}
+
+void drawList::drawLineEx(float xi, float yi, float xf, float yf, float thick, const colorRGB& col,
+                          unsigned char alpha) {
+  commands.push_back({DRAW_LINE, {xi, yi, xf, yf, thick}, col, float(alpha), 0});
+}
+
+void drawList::drawLineBezier(float xi, float yi, float xf, float yf, float thick, const colorRGB& col) {
+  commands.push_back({DRAW_BEZIER, {xi, yi, xf, yf, thick}, col, 255, 0});
+}
+
+void drawList::drawRing(const Vector2& center, float iRad, float oRad, const colorRGB& col, float alpha,
+                        float startAngle, float endAngle) {
+  commands.push_back({DRAW_RING, {center.x, center.y, iRad, oRad, startAngle, endAngle}, col, alpha, 0});
+}
+
+void drawList::drawGradientLineH(const Vector2& a, const Vector2& b, float thick, const colorRGB& col, float alphaA,
+                                 float alphaB) {
+  commands.push_back({DRAW_GRADIENT_H, {a.x, a.y, b.x, b.y, thick}, col, alphaA, alphaB});
+}
+
+void drawList::execute() const {
+  for (const auto& c : commands) {
+    const float* v = c.v;
+    switch (c.type) {
+      case DRAW_RECTANGLE:
+        ::drawRectangle(v[0], v[1], v[2], v[3], c.col, c.alpha);
+        break;
+      case DRAW_LINE:
+        ::drawLineEx(v[0], v[1], v[2], v[3], v[4], c.col, c.alpha);
+        break;
+      case DRAW_BEZIER:
+        ::drawLineBezier(v[0], v[1], v[2], v[3], v[4], c.col);
+        break;
+      case DRAW_RING:
+        ::drawRing({v[0], v[1]}, v[2], v[3], c.col, c.alpha, v[4], v[5]);
+        break;
+      case DRAW_GRADIENT_H:
+        ::drawGradientLineH({v[0], v[1]}, {v[2], v[3]}, v[4], c.col, c.alpha, c.alphaB);
+        break;
+    }
+  }
+}
+
+size_t drawList::getMemory() const {
+  return heapSize(commands) + heapSize(emitters) + heapSize(vertex) + heapSize(color) + heapSize(fftNotes) +
+         heapSize(selection);
+}
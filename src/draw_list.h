@@ -0,0 +1,62 @@
+#pragma once
+
+#include <utility>
+#include <vector>
+
+#include "build_target.h"
+#include "color.h"
+#include "mem_usage.h"
+#include "particle_info.h"
+
+using std::pair;
+using std::vector;
+
+enum drawCommandType { DRAW_RECTANGLE, DRAW_LINE, DRAW_BEZIER, DRAW_RING, DRAW_GRADIENT_H };
+
+// arguments of one wrap.h draw call; v holds the coordinates in call order
+struct drawCommand {
+  drawCommandType type;
+  float v[6];
+  colorRGB col;
+  float alpha;
+  float alphaB;
+};
+
+// the note field of one frame, recorded off the render thread and replayed on
+// it. besides draw calls it carries what drawing notes used to hand to other
+// subsystems, applied on the render thread once the list is executed
+class drawList {
+ public:
+  void clear();
+
+  // same arguments as the wrap.h functions of the same name
+  void drawRectangle(float x, float y, float w, float h, const colorRGB& col, unsigned char alpha = 255);
+  void drawLineEx(float xi, float yi, float xf, float yf, float thick, const colorRGB& col, unsigned char alpha = 255);
+  void drawLineBezier(float xi, float yi, float xf, float yf, float thick, const colorRGB& col);
+  void drawRing(const Vector2& center, float iRad, float oRad, const colorRGB& col, float alpha = 255,
+                float startAngle = 0, float endAngle = 360);
+  void drawGradientLineH(const Vector2& a, const Vector2& b, float thick, const colorRGB& col, float alphaA,
+                         float alphaB);
+
+  void addEmitter(int index, const particleInfo& info) { emitters.push_back({index, info}); }
+
+  void execute() const;
+
+  size_t getMemory() const;
+
+  // particle emitters, voronoi sites and fft notes in draw order
+  vector<pair<int, particleInfo>> emitters;
+  vector<Vector2> vertex;
+  vector<colorRGB> color;
+  vector<int> fftNotes;
+
+  // notes drawn on top of a cached field, kept here so the capacity survives
+  vector<int> selection;
+
+  // hovered note as the click handling expects it, -1 if none
+  int clickIndex = -1;
+  bool clickOn = false;
+
+ private:
+  vector<drawCommand> commands;
+};
@@ -173,6 +173,22 @@ enum flagType { FLAGTYPE_STEM, FLAGTYPE_8, FLAGTYPE_16, FLAGTYPE_32, FLAGTYPE_64
 
 enum flagDirType { FLAG_UP, FLAG_DOWN, FLAG_NONE };
 
+// render passes timed on the GPU, GPU_NONE doubles as the pass count
+enum gpuPassType {
+  GPU_VORONOI,
+  GPU_FXAA,
+  GPU_MEASURE_BLEND,
+  GPU_SHADOW_FILL,
+  GPU_SHADOW_COMPOSITE,
+  GPU_SHEET,
+  GPU_MENU,
+  GPU_NOTE_TILES,
+  GPU_NONE
+};
+
+// note field tile sets, ball mode draws passed notes apart from upcoming ones
+enum tileLayer { TILE_UPCOMING, TILE_PAST, TILE_LAYER_COUNT };
+
 enum class ACTION {
   OPEN,
   OPEN_IMAGE,
@@ -201,6 +217,9 @@ enum class ACTION {
   NAV_ZOOM_IN,
   NAV_ZOOM_OUT,
   NAV_ZOOM_IMAGE,
+  DUMP_MEMORY,
+  DUMP_TRACE,
+  TOGGLE_GPU_TIMER,
   NONE
 };
 
@@ -218,6 +237,8 @@ enum class OPTION {
   SCALE_VELOCITY,
   SHADOW,
   SHADOW_DISTANCE,
+  SET_LIVE_RETENTION,
+  LIVE_RETENTION,
   NONE
 };
 
@@ -1,6 +1,7 @@
 #include "fft.h"
 
 #include "define.h"
+#include "trace.h"
 
 using std::swap;
 
@@ -44,66 +45,75 @@ void fftController::updateFFTBins() {
   crit.unlock();
 }
 
-void fftController::generateFFTBins(const vector<int> c_note, double offset) {
-  generator = thread(&fftController::generate, this, c_note, offset);
+void fftController::generateFFTBins(span<const int> c_note, double offset) {
+  // bins are built on first use and rebuilt on resize once they exist
+  if (bins.empty()) {
+    updateFFTBins();
+  }
+  // normally joined by getFFTBins() already, the generator is the only reader
+  generator_join();
+  c_note_next.assign(c_note.begin(), c_note.end());
+  offset_next = offset;
+  generator.run([](void* self, int, int) { static_cast<fftController*>(self)->generate(); }, this);
 }
 
-void fftController::generate(const vector<int> c_note, double offset) {
+void fftController::generate() {
+  TRACE_ZONE("fft: generate");
+  const vector<int>& c_note = c_note_next;
+  const double offset = offset_next;
   crit.lock();
   auto& notes = ctr.getNotes();
 
-  for (unsigned int bin = 0; bin < bins.size(); ++bin) {
-    bin_map[bin].clear();
-  }
-
-#pragma omp parallel for num_threads(4)
-  for (unsigned int bin = 0; bin < bins.size(); ++bin) {
-    vector<pair<int, int>> result;
-    for (const auto& idx : c_note) {
-      double freq = getFundamental(notes[idx].y);
-      double nowRatio = (offset - notes[idx].x) / (notes[idx].duration);
-      double pitchRatio = 0;
-      if (nowRatio > -0.25 && nowRatio < 0) {
-        pitchRatio = 16 * pow(nowRatio + 0.25, 2);
-      }
-      else if (nowRatio < 1) {
-        pitchRatio = 1 - 1.8 * pow(nowRatio, 2) / 4.5;
-      }
-      else if (nowRatio < 1.78) {  // TODO: smoothen interpolation functions
-        pitchRatio = 1.0 * pow(nowRatio - 1.78,
-                               2);  // TODO: make function duration-invariant
-      }
-      int binScale = 2 + 5 * (1 + log(1 + notes[idx].duration)) + (15.0 / 128) * ((notes[idx].velocity) + 1);
-
-      // logQ(notes[idx].y, freq, bins.size());
-      //  simulate harmonics
-      double fftBinLenAll = 0;
-      for (unsigned int harmonicScale = 0; harmonicScale < harmonicsSize; ++harmonicScale) {
-        double fftBinLen = 0;
-        if (freq * harmonics[harmonicScale] < FFT_MIN_FREQ || freq * harmonics[harmonicScale] > FFT_MAX_FREQ) {
-          continue;
+  // each bin is written by one range only, straight into the vector kept
+  // from two frames ago so its capacity is reused
+  parallelFor(0, bins.size(), 8, [&](int lo, int hi) {
+    for (int bin = lo; bin < hi; ++bin) {
+      vector<pair<int, int>>& result = bin_map[bin];
+      result.clear();
+      for (const auto& idx : c_note) {
+        double freq = getFundamental(notes[idx].y);
+        double nowRatio = (offset - notes[idx].x) / (notes[idx].duration);
+        double pitchRatio = 0;
+        if (nowRatio > -0.25 && nowRatio < 0) {
+          pitchRatio = 16 * pow(nowRatio + 0.25, 2);
+        }
+        else if (nowRatio < 1) {
+          pitchRatio = 1 - 1.8 * pow(nowRatio, 2) / 4.5;
+        }
+        else if (nowRatio < 1.78) {  // TODO: smoothen interpolation functions
+          pitchRatio = 1.0 * pow(nowRatio - 1.78,
+                                 2);  // TODO: make function duration-invariant
+        }
+        int binScale = 2 + 5 * (1 + log(1 + notes[idx].duration)) + (15.0 / 128) * ((notes[idx].velocity) + 1);
+
+        // logQ(notes[idx].y, freq, bins.size());
+        //  simulate harmonics
+        double fftBinLenAll = 0;
+        for (unsigned int harmonicScale = 0; harmonicScale < harmonicsSize; ++harmonicScale) {
+          double fftBinLen = 0;
+          if (freq * harmonics[harmonicScale] < FFT_MIN_FREQ || freq * harmonics[harmonicScale] > FFT_MAX_FREQ) {
+            continue;
+          }
+
+          fftBinLen += harmonicsCoefficient[harmonicScale] * binScale * pitchRatio *
+                       fftAC(freq * harmonics[harmonicScale], bins[bin].first);
+
+          // pseudo-random numerically stable offset
+          // TODO: implement spectral rolloff in decay (based on BIN FREQ v.
+          // spectral rolloff curve)
+          fftBinLen *=
+              1 + 0.7 * pow(((ctr.getPSR() ^ static_cast<int>(bins[bin].first)) % static_cast<int>(bins[bin].first)) /
+                                    bins[bin].first -
+                                0.5,
+                            2);
+
+          fftBinLenAll += fftBinLen;
         }
 
-        fftBinLen += harmonicsCoefficient[harmonicScale] * binScale * pitchRatio *
-                     fftAC(freq * harmonics[harmonicScale], bins[bin].first);
-
-        // pseudo-random numerically stable offset
-        // TODO: implement spectral rolloff in decay (based on BIN FREQ v.
-        // spectral rolloff curve)
-        fftBinLen *=
-            1 + 0.7 * pow(((ctr.getPSR() ^ static_cast<int>(bins[bin].first)) % static_cast<int>(bins[bin].first)) /
-                                  bins[bin].first -
-                              0.5,
-                          2);
-
-        fftBinLenAll += fftBinLen;
+        result.push_back(make_pair(idx, fftBinLenAll));
       }
-
-      result.push_back(make_pair(idx, fftBinLenAll));
     }
-#pragma omp critical
-    bin_map[bin] = result;
-  }
+  });
 
   // normalization
   int bin_max = 0;
@@ -144,8 +154,12 @@ vector<vector<pair<int, int>>>& fftController::getFFTBins() {
   return bin_map_last;
 }
 
-void fftController::generator_join() {
-  if (generator.joinable()) {
-    generator.join();
+void fftController::generator_join() { generator.wait(); }
+
+void fftController::clearBins() {
+  generator_join();
+  for (unsigned int bin = 0; bin < bin_map.size(); ++bin) {
+    bin_map[bin].clear();
+    bin_map_last[bin].clear();
   }
 }
@@ -1,25 +1,30 @@
 #pragma once
 
 #include <mutex>
-#include <thread>
+#include <span>
 #include <vector>
 
 #include "build_target.h"
 #include "log.h"
+#include "task.h"
 
 using std::mutex;
-using std::thread;
+using std::span;
 using std::vector;
 
 class fftController {
  public:
   double getFundamental(int y);
   double fftAC(double f_1, double f_2);
-  void generateFFTBins(const vector<int> c_note, double offset);
+  void generateFFTBins(span<const int> c_note, double offset);
   vector<vector<pair<int, int>>>& getFFTBins();
 
   void generator_join();
 
+  // drops generated bins, whose note indices are stale once live history is
+  // evicted
+  void clearBins();
+
   vector<pair<double, int>> bins;
 
   static constexpr double harmonics[5] = {0.25, 0.5, 1, 2, 4};
@@ -32,12 +37,16 @@ class fftController {
   // map fftbin index to (note index, length)
   vector<vector<pair<int, int>>> bin_map;
 
-  const vector<int> c_note_last;
+  // notes and offset handed to the generator; reused so a frame does not allocate
+  vector<int> c_note_next;
+  double offset_next = 0;
   vector<vector<pair<int, int>>> bin_map_last;
 
   mutex crit;
-  thread generator;
+
+  // one frame's bins, computed on the shared pool while the frame is drawn
+  taskGroup generator;
 
   void updateFFTBins();
-  void generate(const vector<int> c_note, double offset);
+  void generate();
 };
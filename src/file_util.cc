@@ -0,0 +1,24 @@
+#include "file_util.h"
+
+#include <fstream>
+
+using std::ifstream;
+
+bool readFileData(const string& path, vector<char>& data) {
+  // single bulk read instead of streaming the file byte by byte
+  ifstream input(path, std::ios::in | std::ios::binary | std::ios::ate);
+  if (!input) {
+    return false;
+  }
+
+  std::streamsize fileSize = input.tellg();
+  if (fileSize < 0) {
+    return false;
+  }
+
+  data.resize(fileSize);
+  input.seekg(0, std::ios::beg);
+  input.read(data.data(), fileSize);
+
+  return input.gcount() == fileSize;
+}
@@ -0,0 +1,10 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+using std::string;
+using std::vector;
+
+// whole file in one read; false if it cannot be opened or read completely
+bool readFileData(const string& path, vector<char>& data);
@@ -0,0 +1,116 @@
+#include "frame_alloc.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+
+#include "data.h"
+#include "log.h"
+
+using std::max;
+using std::uintptr_t;
+
+namespace {
+
+std::pmr::memory_resource* upstream() { return std::pmr::new_delete_resource(); }
+
+}  // namespace
+
+frameAllocator::frameAllocator(size_t size) : capacity(size) {
+  buffer = static_cast<std::byte*>(upstream()->allocate(capacity, alignof(std::max_align_t)));
+}
+
+frameAllocator::~frameAllocator() {
+  for (const auto& b : spill) {
+    upstream()->deallocate(b.ptr, b.bytes, b.align);
+  }
+  upstream()->deallocate(buffer, capacity, alignof(std::max_align_t));
+}
+
+void* frameAllocator::do_allocate(size_t bytes, size_t align) {
+  uintptr_t base = reinterpret_cast<uintptr_t>(buffer);
+  uintptr_t start = (base + used + align - 1) & ~(static_cast<uintptr_t>(align) - 1);
+
+  if (start + bytes <= base + capacity) {
+    used = start + bytes - base;
+    peak = max(peak, used + spillBytes);
+    return reinterpret_cast<void*>(start);
+  }
+
+  // out of room for this frame, take it from the heap and grow on reset()
+  void* p = upstream()->allocate(bytes, align);
+  spill.push_back({p, bytes, align});
+  spillBytes += bytes;
+  peak = max(peak, used + spillBytes);
+  return p;
+}
+
+void frameAllocator::do_deallocate(void* p, size_t bytes, size_t) {
+  // only the newest block can be handed back, which covers a vector regrowing
+  // while nothing else has allocated since
+  std::byte* b = static_cast<std::byte*>(p);
+  if (b >= buffer && b < buffer + capacity && b + bytes == buffer + used) {
+    used = b - buffer;
+  }
+}
+
+void frameAllocator::reset() {
+  for (const auto& b : spill) {
+    upstream()->deallocate(b.ptr, b.bytes, b.align);
+  }
+
+  if (spillBytes) {
+    size_t newCapacity = capacity;
+    while (newCapacity < peak) {
+      newCapacity *= 2;
+    }
+    upstream()->deallocate(buffer, capacity, alignof(std::max_align_t));
+    capacity = newCapacity;
+    buffer = static_cast<std::byte*>(upstream()->allocate(capacity, alignof(std::max_align_t)));
+    logW(LL_INFO, "frame arena grown to", capacity, "bytes");
+  }
+
+  spill.clear();
+  spillBytes = 0;
+  used = 0;
+
+  size_t heapCount = heapAllocationCount();
+  frameHeapAllocs = heapCount - lastHeapCount;
+  lastHeapCount = heapCount;
+}
+
+frameAllocator& frameMemory() {
+  static frameAllocator arena(FRAME_ARENA_SIZE);
+  return arena;
+}
+
+#if !defined(NO_DEBUG)
+
+// count every global allocation per thread, so a steady frame on the render
+// thread can be shown to make none whatever the pool is doing
+namespace {
+
+thread_local size_t heapAllocs = 0;
+
+}  // namespace
+
+void* operator new(size_t size) {
+  heapAllocs++;
+  if (void* p = std::malloc(size ? size : 1)) {
+    return p;
+  }
+  // built without exceptions, bad_alloc cannot be thrown
+  std::abort();
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, size_t) noexcept { std::free(p); }
+
+size_t heapAllocationCount() { return heapAllocs; }
+
+#else
+
+size_t heapAllocationCount() { return 0; }
+
+#endif
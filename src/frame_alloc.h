@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstddef>
+#include <memory_resource>
+#include <vector>
+
+#include "build_target.h"
+
+using std::size_t;
+using std::vector;
+
+// bump allocator for temporaries that die within the frame they were made in;
+// render thread only. deallocation is a no-op except for the most recent block,
+// reset() rewinds the buffer and grows it if the last frame spilled to the heap
+class frameAllocator : public std::pmr::memory_resource {
+ public:
+  explicit frameAllocator(size_t size);
+  ~frameAllocator();
+
+  frameAllocator(const frameAllocator&) = delete;
+  frameAllocator& operator=(const frameAllocator&) = delete;
+
+  void reset();
+
+  size_t getCapacity() const { return capacity; }
+  size_t getPeak() const { return peak; }
+
+  // operator new calls the render thread made during the previous frame, debug
+  // builds only
+  size_t getFrameHeapAllocs() const { return frameHeapAllocs; }
+
+ private:
+  void* do_allocate(size_t bytes, size_t align) override;
+  void do_deallocate(void* p, size_t bytes, size_t align) override;
+  bool do_is_equal(const memory_resource& other) const noexcept override { return this == &other; }
+
+  struct spillBlock {
+    void* ptr;
+    size_t bytes;
+    size_t align;
+  };
+
+  std::byte* buffer = nullptr;
+  size_t capacity = 0;
+  size_t used = 0;
+  size_t peak = 0;
+
+  // blocks that did not fit, freed and folded into the buffer on reset()
+  vector<spillBlock> spill;
+  size_t spillBytes = 0;
+
+  size_t lastHeapCount = 0;
+  size_t frameHeapAllocs = 0;
+};
+
+frameAllocator& frameMemory();
+
+// running count of global operator new calls made on the calling thread;
+// always 0 in release builds
+size_t heapAllocationCount();
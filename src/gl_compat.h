@@ -1,5 +1,11 @@
 #pragma once
 
+#if defined(_WIN32) && !defined(_WIN64)
+  #define CGL_APIENTRY __stdcall
+#else
+  #define CGL_APIENTRY
+#endif
+
 // compatability type since raylib doesn't provide GL blend attributes
 enum gl_compat {
   /* Accumulation buffer */
@@ -34,4 +40,44 @@ enum gl_compat {
   CGL_DST_COLOR = 0x0306,
   CGL_ONE_MINUS_DST_COLOR = 0x0307,
   CGL_SRC_ALPHA_SATURATE = 0x0308,
+
+  /* Queries */
+  CGL_VENDOR = 0x1F00,
+  CGL_RENDERER = 0x1F01,
+  CGL_VERSION = 0x1F02,
+
+  /* Program binaries */
+  CGL_LINK_STATUS = 0x8B82,
+  CGL_PROGRAM_BINARY_RETRIEVABLE_HINT = 0x8257,
+  CGL_PROGRAM_BINARY_LENGTH = 0x8741,
+  CGL_NUM_PROGRAM_BINARY_FORMATS = 0x87FE,
+
+  /* Timer queries */
+  CGL_TIMESTAMP = 0x8E28,
+  CGL_QUERY_RESULT = 0x8866,
+  CGL_QUERY_RESULT_AVAILABLE = 0x8867,
 };
+
+// entry points raylib does not expose, resolved at runtime through GLFW
+extern "C" void* glfwGetProcAddress(const char* procname);
+
+typedef const unsigned char*(CGL_APIENTRY* cglGetString)(unsigned int name);
+typedef void(CGL_APIENTRY* cglGetIntegerv)(unsigned int pname, int* data);
+typedef unsigned int(CGL_APIENTRY* cglCreateProgram)(void);
+typedef void(CGL_APIENTRY* cglDeleteProgram)(unsigned int program);
+typedef void(CGL_APIENTRY* cglGetProgramiv)(unsigned int program, unsigned int pname, int* params);
+typedef void(CGL_APIENTRY* cglGetProgramBinary)(unsigned int program, int bufSize, int* length,
+                                                unsigned int* binaryFormat, void* binary);
+typedef void(CGL_APIENTRY* cglProgramBinary)(unsigned int program, unsigned int binaryFormat, const void* binary,
+                                             int length);
+typedef void(CGL_APIENTRY* cglProgramParameteri)(unsigned int program, unsigned int pname, int value);
+typedef void(CGL_APIENTRY* cglAttachShader)(unsigned int program, unsigned int shader);
+typedef void(CGL_APIENTRY* cglDetachShader)(unsigned int program, unsigned int shader);
+typedef void(CGL_APIENTRY* cglDeleteShader)(unsigned int shader);
+typedef void(CGL_APIENTRY* cglBindAttribLocation)(unsigned int program, unsigned int index, const char* name);
+typedef void(CGL_APIENTRY* cglLinkProgram)(unsigned int program);
+typedef void(CGL_APIENTRY* cglGenQueries)(int n, unsigned int* ids);
+typedef void(CGL_APIENTRY* cglDeleteQueries)(int n, const unsigned int* ids);
+typedef void(CGL_APIENTRY* cglQueryCounter)(unsigned int id, unsigned int target);
+typedef void(CGL_APIENTRY* cglGetQueryObjectiv)(unsigned int id, unsigned int pname, int* params);
+typedef void(CGL_APIENTRY* cglGetQueryObjectui64v)(unsigned int id, unsigned int pname, unsigned long long* params);
@@ -0,0 +1,168 @@
+#include "gpu_timer.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+
+#include "build_target.h"
+#include "define.h"
+#include "log.h"
+#include "wrap.h"
+
+using std::max;
+using std::ostringstream;
+
+namespace {
+
+const char* passLabel[GPU_NONE] = {
+    "GPU_VORONOI", "GPU_FXAA", "GPU_MEASURE_BLEND", "GPU_SHADOW_FILL", "GPU_SHADOW_COMPOSITE", "GPU_SHEET",
+    "GPU_MENU",    "GPU_NOTE_TILES",
+};
+
+string formatTime(double ms) {
+  ostringstream ss;
+  ss << std::fixed << std::setprecision(2) << ms << " ms";
+  return ss.str();
+}
+
+}  // namespace
+
+bool gpuTimer::load() {
+  if (loaded || !supported) {
+    return loaded;
+  }
+
+  // core in GL 3.3 (ARB_timer_query), not available on older contexts
+  genQueries = reinterpret_cast<cglGenQueries>(glfwGetProcAddress("glGenQueries"));
+  deleteQueries = reinterpret_cast<cglDeleteQueries>(glfwGetProcAddress("glDeleteQueries"));
+  queryCounter = reinterpret_cast<cglQueryCounter>(glfwGetProcAddress("glQueryCounter"));
+  getQueryObjectiv = reinterpret_cast<cglGetQueryObjectiv>(glfwGetProcAddress("glGetQueryObjectiv"));
+  getQueryObjectui64v = reinterpret_cast<cglGetQueryObjectui64v>(glfwGetProcAddress("glGetQueryObjectui64v"));
+
+  if (!genQueries || !deleteQueries || !queryCounter || !getQueryObjectiv || !getQueryObjectui64v) {
+    logW(LL_WARN, "GPU timer queries are not supported by this context");
+    supported = false;
+    return false;
+  }
+
+  genQueries(GPU_TIMER_FRAMES * GPU_NONE * 2, &queries[0][0][0]);
+  loaded = true;
+  return true;
+}
+
+void gpuTimer::unload() {
+  if (loaded) {
+    deleteQueries(GPU_TIMER_FRAMES * GPU_NONE * 2, &queries[0][0][0]);
+    loaded = false;
+  }
+}
+
+void gpuTimer::setEnabled(bool value) {
+  if (value == enabled) {
+    return;
+  }
+  if (value && !load()) {
+    return;
+  }
+  if (!value) {
+    logTimes();
+  }
+
+  enabled = value;
+  missed = 0;
+  std::fill(&issued[0][0], &issued[0][0] + GPU_TIMER_FRAMES * GPU_NONE, false);
+  std::fill(average, average + GPU_NONE, 0.0);
+}
+
+void gpuTimer::begin(gpuPassType pass) {
+  if (!enabled) {
+    return;
+  }
+  // raylib batches draw calls, anything queued so far belongs to earlier work
+  rlDrawRenderBatchActive();
+  queryCounter(queries[slot][pass][0], CGL_TIMESTAMP);
+}
+
+void gpuTimer::end(gpuPassType pass) {
+  if (!enabled) {
+    return;
+  }
+  rlDrawRenderBatchActive();
+  queryCounter(queries[slot][pass][1], CGL_TIMESTAMP);
+  issued[slot][pass] = true;
+}
+
+void gpuTimer::frame() {
+  if (!enabled) {
+    return;
+  }
+
+  // the next slot is the oldest, issued GPU_TIMER_FRAMES - 1 frames ago
+  slot = (slot + 1) % GPU_TIMER_FRAMES;
+
+  for (int pass = 0; pass < GPU_NONE; ++pass) {
+    if (!issued[slot][pass]) {
+      // pass not drawn (display mode, option off)
+      average[pass] = 0;
+      continue;
+    }
+    issued[slot][pass] = false;
+
+    // timestamps complete in order, so the end one covers both
+    int available = 0;
+    getQueryObjectiv(queries[slot][pass][1], CGL_QUERY_RESULT_AVAILABLE, &available);
+    if (!available) {
+      missed++;
+      continue;
+    }
+
+    unsigned long long start = 0;
+    unsigned long long stop = 0;
+    getQueryObjectui64v(queries[slot][pass][0], CGL_QUERY_RESULT, &start);
+    getQueryObjectui64v(queries[slot][pass][1], CGL_QUERY_RESULT, &stop);
+
+    double ms = (stop - start) / 1e6;
+    average[pass] = average[pass] == 0 ? ms : average[pass] + GPU_TIMER_SMOOTHING * (ms - average[pass]);
+  }
+}
+
+double gpuTimer::getTotal() const {
+  double total = 0;
+  for (double t : average) {
+    total += t;
+  }
+  return total;
+}
+
+void gpuTimer::logTimes() const {
+  for (int pass = 0; pass < GPU_NONE; ++pass) {
+    logW(LL_INFO, "gpu:", ctr.text.getString(passLabel[pass]), "-", formatTime(average[pass]));
+  }
+  logW(LL_INFO, "gpu: total -", formatTime(getTotal()), "- results not ready in time:", missed);
+}
+
+void gpuTimer::render() const {
+  if (!enabled) {
+    return;
+  }
+
+  constexpr int margin = 4;
+  const int lineHeight = measureTextEx("0").y;
+
+  float width = 0;
+  vector<string> lines;
+  for (int pass = 0; pass < GPU_NONE; ++pass) {
+    lines.push_back(ctr.text.getString(passLabel[pass]) + ": " + formatTime(average[pass]));
+  }
+  lines.push_back(ctr.text.getString("GPU_TOTAL") + ": " + formatTime(getTotal()));
+  for (const auto& line : lines) {
+    width = max(width, measureTextEx(line).x);
+  }
+
+  const int x = ctr.getWidth() - width - 2 * margin;
+  const int y = ctr.topHeight + margin;
+  drawRectangle(x - margin, y - margin, width + 2 * margin, lines.size() * lineHeight + 2 * margin, ctr.bgMenu, 200);
+  for (int i = 0; const auto& line : lines) {
+    drawTextEx(line, x, y + lineHeight * i++, ctr.bgDark);
+  }
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include "data.h"
+#include "enum.h"
+#include "gl_compat.h"
+
+// GPU time of individual render passes through GL timestamp queries. queries
+// are issued into one of GPU_TIMER_FRAMES slots and read back once the slot
+// comes around again, so the render thread never waits on the GPU.
+// off by default: timing a pass flushes the raylib batch on both ends
+class gpuTimer {
+ public:
+  void begin(gpuPassType pass);
+  void end(gpuPassType pass);
+
+  // once per frame, after the frame is submitted
+  void frame();
+
+  void unload();
+
+  bool isEnabled() const { return enabled; }
+  void setEnabled(bool value);
+
+  // moving average in milliseconds, 0 until the pass has been sampled
+  double getTime(gpuPassType pass) const { return average[pass]; }
+  double getTotal() const;
+
+  void logTimes() const;
+
+  // per-pass overlay below the top bar while timing is on
+  void render() const;
+
+ private:
+  bool load();
+
+  bool enabled = false;
+  bool loaded = false;
+  bool supported = true;
+
+  cglGenQueries genQueries = nullptr;
+  cglDeleteQueries deleteQueries = nullptr;
+  cglQueryCounter queryCounter = nullptr;
+  cglGetQueryObjectiv getQueryObjectiv = nullptr;
+  cglGetQueryObjectui64v getQueryObjectui64v = nullptr;
+
+  // begin and end timestamp of each pass in each frame slot
+  unsigned int queries[GPU_TIMER_FRAMES][GPU_NONE][2] = {};
+  bool issued[GPU_TIMER_FRAMES][GPU_NONE] = {};
+  int slot = 0;
+
+  double average[GPU_NONE] = {};
+  int missed = 0;
+};
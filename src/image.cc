@@ -1,10 +1,14 @@
 #include "image.h"
 
 #include <algorithm>
+#include <cstdint>
 
 #include "define.h"
 #include "enum.h"
 #include "log.h"
+#include "mem_usage_raylib.h"
+#include "reaper.h"
+#include "task.h"
 #include "wrap.h"
 
 using std::max;
@@ -13,63 +17,127 @@ using std::min;
 void imageController::load(const string& path) {
   logW(LL_INFO, "load image:", path);
 
-  unloadData();
-
   if (!isValidPath(path, PATH_IMAGE)) {
     logW(LL_WARN, "invalid path:", path);
     return;
   }
 
-  image = LoadImage(path.c_str());
+  // decode off the render thread, the current image stays up until update()
+  // swaps in the result; a newer request supersedes the pending one
+  retireJob();
+  job = std::make_unique<imageJob>();
+  imageJob* j = job.get();
+
+  j->worker = thread([j, path] {
+    // the file is read once, for both decoding and saving to mki
+    ifstream imageData(path, std::ios::binary);
+    j->bytes.assign(std::istreambuf_iterator<char>(imageData), std::istreambuf_iterator<char>());
+    imageData.close();
+    if (j->cancel) {
+      return;
+    }
 
-  // file is known to work
-  ifstream imageData(path);
+    string ext = getExtension(path);
+    if (ext == "png") {
+      j->format = IMAGE_PNG;
+    }
+    else if (ext == "jpg" || ext == "peg") {
+      j->format = IMAGE_JPG;
+    }
+    else {
+      logW(LL_WARN, "unknown format", ext);
+      j->format = IMAGE_NONE;
+    }
 
-  string ext = getExtension(path);
+    decode(*j);
+    j->ready = true;
+  });
+}
 
-  if (ext == "jpg") {
-    format = IMAGE_JPG;
-  }
-  else if (ext == "png") {
-    format = IMAGE_PNG;
-  }
-  else {
-    logW(LL_WARN, "unknown format", ext);
-    format = IMAGE_NONE;
-  }
+void imageController::load(const char* byteData, int byteSize, int fmt) {
+  // image embedded in a file, decoded in place
+  retireJob();
+  job = std::make_unique<imageJob>();
+  job->format = fmt;
+  job->bytes.assign(byteData, byteSize);
 
-  buf.str("");
-  buf.clear();
-  buf << imageData.rdbuf();
-  imageData.close();
+  decode(*job);
+  job->ready = true;
 
-  process();
+  update();
 }
 
-void imageController::load(stringstream& byteData, int byteSize, int fmt) {
-  unloadData();
-
-  buf.str("");
-  buf.clear();
-  buf.write(byteData.str().c_str(), byteData.str().size());
-
+void imageController::decode(imageJob& j) {
   string ext = "";
 
-  switch (fmt) {
+  switch (j.format) {
     case IMAGE_PNG:
       ext = ".png";
-      format = IMAGE_PNG;
       break;
     case IMAGE_JPG:
       ext = ".jpg";
-      format = IMAGE_JPG;
       break;
     default:
-      logW(LL_WARN, "wrong image format:", fmt);
+      logW(LL_WARN, "wrong image format:", j.format);
       return;
   }
 
-  image = LoadImageFromMemory(ext.c_str(), reinterpret_cast<const unsigned char*>(byteData.str().c_str()), byteSize);
+  j.image = LoadImageFromMemory(ext.c_str(), reinterpret_cast<const unsigned char*>(j.bytes.data()), j.bytes.size());
+  // a cancelled job is never swapped in, its destructor frees the image
+  if (!j.image.data || j.cancel) {
+    return;
+  }
+
+  // no need to upload more pixels than can be displayed
+  int maxDim = max(j.image.width, j.image.height);
+  if (maxDim > IMAGE_MAX_DIM) {
+    double ratio = static_cast<double>(IMAGE_MAX_DIM) / maxDim;
+    ImageResize(&j.image, j.image.width * ratio, j.image.height * ratio);
+  }
+
+  if (j.cancel) {
+    return;
+  }
+
+  createRawData(j);
+}
+
+void imageController::retireJob() {
+  // the worker may still be decoding, it is joined on the reaper thread
+  if (job) {
+    job->cancel = true;
+    reaper().retire(std::move(job));
+  }
+}
+
+void imageController::update() {
+  // render thread only, finishes a pending load with the gpu upload
+  if (!job || !job->ready) {
+    return;
+  }
+
+  unique_ptr<imageJob> j = std::move(job);
+  if (j->worker.joinable()) {
+    j->worker.join();
+  }
+
+  if (!j->image.data) {
+    logW(LL_WARN, "unable to decode image");
+    return;
+  }
+
+  unloadData();
+
+  image = j->image;
+  j->image = {};
+
+  rawPixelData = std::move(j->rawPixelData);
+  meanV = j->meanV;
+  numColors = j->numColors;
+  format = j->format;
+
+  buf.str(j->bytes);
+  buf.clear();
 
   process();
 }
@@ -81,17 +149,12 @@ void imageController::process() {
     defaultScale = scale;
   }
 
-  meanV = 0;
-  numColors = 0;
-
   position = {0, 0};
 
   imageTex = LoadTextureFromImage(image);
   SetTextureFilter(imageTex, TEXTURE_FILTER_BILINEAR);
 
   isLoaded = true;
-
-  createRawData();
 }
 
 void imageController::unloadData() {
@@ -189,48 +252,84 @@ void imageController::changeScale(double scaleOffset) {
 
 vector<kMeansPoint> imageController::getRawData() { return rawPixelData; }
 
-void imageController::createRawData() {
-  rawPixelData.clear();
-
-  Image copy = ImageCopy(image);
-  constexpr int baseWidth = 100;
-  ImageResizeNN(&copy, baseWidth, baseWidth * (double)image.width / image.height);
-
-  vector<colorRGB> uniqueColors;
+void imageController::createRawData(imageJob& j) {
+  // runs on the loader thread, only touches the job
+  j.rawPixelData.clear();
+  j.meanV = 0;
+  j.numColors = 0;
 
-  auto exitCond = [&] {
-    meanV /= (copy.width * copy.height);
-    numColors = uniqueColors.size();
-    // logQ("numC", numColors);
+  if (!j.image.data) {
+    return;
+  }
 
+  Image copy = ImageCopy(j.image);
+  constexpr int baseWidth = 100;
+  ImageResizeNN(&copy, baseWidth, baseWidth * (double)j.image.width / j.image.height);
+  if (j.cancel) {
     UnloadImage(copy);
-  };
+    return;
+  }
 
-  if (isLoaded) {
-    // use original image values to prevent effects from scaling
-    for (int x = 0; x < copy.width; ++x) {
-      for (int y = 0; y < copy.height; ++y) {
-        if (uniqueColors.size() >= MAX_UNIQUE_COLORS) {
-          exitCond();
+  // read the pixel buffer directly instead of through GetImageColor
+  ImageFormat(&copy, PIXELFORMAT_UNCOMPRESSED_R8G8B8A8);
+  const Color* pixels = static_cast<const Color*>(copy.data);
+  const int count = copy.width * copy.height;
+
+  // use original image values to prevent effects from scaling
+  j.rawPixelData.resize(count);
+  double sumV = parallelReduce(
+      0, count, 1024, 0.0,
+      [&](int lo, int hi, double& acc) {
+        if (j.cancel) {
           return;
         }
-        // logQ(colorRGB(GetImageColor(copy, x, y)));
-        Color tmpColorR = GetImageColor(copy, x, y);
-        colorRGB tmpColor = {(double)tmpColorR.r, (double)tmpColorR.g, (double)tmpColorR.b};
-        meanV += tmpColor.getHSV().v;
-        rawPixelData.push_back(kMeansPoint(tmpColor));
-
-        if (uniqueColors.size() < MAX_UNIQUE_COLORS &&
-            find(uniqueColors.begin(), uniqueColors.end(), tmpColor) == uniqueColors.end()) {
-          uniqueColors.push_back(tmpColor);
+        for (int p = lo; p < hi; ++p) {
+          colorRGB tmpColor = {(double)pixels[p].r, (double)pixels[p].g, (double)pixels[p].b};
+          acc += tmpColor.getHSV().v;
+          j.rawPixelData[p] = kMeansPoint(tmpColor);
         }
-      }
+      },
+      [](double a, double b) { return a + b; });
+
+  // count unique colors with an open-addressing set of packed rgb values,
+  // the cap only limits the count and no longer truncates the pixel data
+  constexpr uint32_t emptySlot = 0xFFFFFFFF;
+  const unsigned int limit = min(count, MAX_UNIQUE_COLORS);
+  unsigned int tableSize = 1;
+  while (tableSize < 2 * limit) {
+    tableSize <<= 1;
+  }
+  vector<uint32_t> uniqueColors(tableSize, emptySlot);
+
+  for (int p = 0; p < count && j.numColors < MAX_UNIQUE_COLORS; ++p) {
+    if (p % 4096 == 0 && j.cancel) {
+      break;
+    }
+    uint32_t packed = (pixels[p].r << 16) | (pixels[p].g << 8) | pixels[p].b;
+    uint32_t slot = (packed * 2654435761u) & (tableSize - 1);
+
+    while (uniqueColors[slot] != emptySlot && uniqueColors[slot] != packed) {
+      slot = (slot + 1) & (tableSize - 1);
+    }
+    if (uniqueColors[slot] == emptySlot) {
+      uniqueColors[slot] = packed;
+      j.numColors++;
     }
   }
 
-  exitCond();
+  j.meanV = count ? sumV / count : 0;
+  // logQ("numC", numColors);
+
+  UnloadImage(copy);
 }
 
 double imageController::getMeanValue() { return meanV; }
 
 int imageController::getNumColors() { return numColors; }
+
+size_t imageController::getMemory() const {
+  if (!isLoaded) {
+    return 0;
+  }
+  return imageSize(image) + textureSize(imageTex) + heapSize(rawPixelData);
+}
@@ -1,20 +1,54 @@
 #pragma once
 
+#include <atomic>
+#include <memory>
 #include <string>
+#include <thread>
 #include <vector>
 
 #include "box.h"
 #include "build_target.h"
 #include "color.h"
 #include "colorgen.h"
+#include "mem_usage.h"
 
+using std::atomic;
 using std::ifstream;
 using std::max;
 using std::min;
 using std::string;
 using std::stringstream;
+using std::thread;
+using std::unique_ptr;
 using std::vector;
 
+// decoded image handed from the loader thread to the render thread; replaced
+// jobs are destroyed on the reaper thread
+struct imageJob {
+  ~imageJob() {
+    cancel = true;
+    if (worker.joinable()) {
+      worker.join();
+    }
+    if (image.data) {
+      UnloadImage(image);
+    }
+  }
+
+  thread worker;
+  atomic<bool> ready = false;
+
+  // checked between decode steps and in the pixel loops
+  atomic<bool> cancel = false;
+
+  Image image = {};
+  vector<kMeansPoint> rawPixelData;
+  double meanV = 0;
+  int numColors = 0;
+  int format = IMAGE_NONE;
+  string bytes;
+};
+
 class imageController {
  public:
   imageController()
@@ -31,19 +65,24 @@ class imageController {
         numColors(0),
         rawPixelData(),
         format(IMAGE_NONE),
-        buf(){};
+        buf(),
+        job(nullptr){};
 
   void load(const string& path);
+  void update();
   void unloadData();
 
   void render();
   void changeScale(double scaleOffset);
 
+  size_t getMemory() const;
+
   vector<kMeansPoint> getRawData();
   double getMeanValue();
   int getNumColors();
 
   bool exists() { return isLoaded; }
+  bool loading() { return job != nullptr; }
   bool movable() { return canMove; }
 
   int getX() { return position.x + offset.x; }
@@ -58,9 +97,11 @@ class imageController {
   friend class controller;
 
  private:
-  void createRawData();
+  static void decode(imageJob& j);
+  static void createRawData(imageJob& j);
+  void retireJob();
   void process();
-  void load(stringstream& byteData, int byteSize, int fmt);
+  void load(const char* byteData, int byteSize, int fmt);
 
   Image image;
   Texture2D imageTex;
@@ -81,4 +122,7 @@ class imageController {
 
   int format;
   stringstream buf;
+
+  // pending load, replaced when a newer image is requested
+  unique_ptr<imageJob> job;
 };
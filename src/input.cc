@@ -7,12 +7,30 @@
 #include "data.h"
 #include "define.h"
 #include "log.h"
-
-midiInput::midiInput() : midiIn(nullptr), msgQueue(0), numPort(0), curPort(-1), noteCount(0), numOn(0), timestamp(0) {
+#include "reaper.h"
+#include "trace.h"
+
+midiInput::midiInput()
+    : midiIn(nullptr),
+      msgQueue(0),
+      thruActive(false),
+      thruDropped(0),
+      numPort(0),
+      curPort(-1),
+      noteCount(0),
+      numOn(0),
+      timestamp(0),
+      noteEvents(0) {
   midiIn = unique_ptr<RtMidiIn>(new RtMidiIn());
   if (midiIn == nullptr) {
     logW(LL_WARN, "unable to initialize MIDI input");
   }
+  msgQueue.reserve(MIDI_THRU_MSG_SIZE);
+
+  // messages are delivered on the backend thread and forwarded from there,
+  // so thru latency does not depend on the render loop
+  midiIn->setCallback(&midiInput::thruCallback, this);
+
   for (auto& t : noteStream.getTracks()) {
     t.setNoteVector(&noteStream.notes);
   }
@@ -33,7 +51,7 @@ void midiInput::openPort(int port, bool pauseEvent) {
   midiIn->ignoreTypes(false, false, false);
 
   curPort = port;
-  timestamp = midiIn->getMessage(&msgQueue);
+  timestamp = 0;
 
   if (!pauseEvent) {
     logW(LL_INFO, "[IN] opened port", port);
@@ -41,16 +59,23 @@ void midiInput::openPort(int port, bool pauseEvent) {
 }
 
 void midiInput::resetInput() {
+  // the worker reads the notes cleared below
+  compactor.wait();
+  compaction.reset();
+
   ctr.livePlayOffset = 0;
   midiIn->closePort();
   msgQueue.clear();
+  thruQueue.clear();
   timestamp = 0;
   noteCount = 0;
   numOn = 0;
   curPort = 0;
+  keys.clear();
 
   // TODO: implement midi reset handler
   noteStream.notes.clear();
+  noteStream.notes.reserve(LIVE_CHUNK_SIZE);
   noteStream.measureMap.clear();
 
   for (unsigned int i = 0; i < noteStream.getTracks().size(); i++) {
@@ -72,8 +97,41 @@ vector<string> midiInput::getPorts() {
   return formatPortName(ports);
 }
 
+void midiInput::thruCallback(double delta, vector<unsigned char>* msg, void* userData) {
+  midiInput* in = static_cast<midiInput*>(userData);
+  if (!in->thruActive || msg->empty()) {
+    return;
+  }
+  TRACE_THREAD("midi input");
+  TRACE_ZONE("input: thru");
+
+  ctr.output.sendMessage(msg->data(), msg->size());
+
+  // the visualizer only parses channel/realtime messages, sysex is thru only
+  if (msg->size() > MIDI_THRU_MSG_SIZE) {
+    return;
+  }
+
+  midiEvent ev;
+  ev.delta = delta;
+  ev.size = msg->size();
+  std::copy(msg->begin(), msg->end(), ev.data);
+
+  if (!in->thruQueue.push(ev)) {
+    in->thruDropped++;
+  }
+}
+
 bool midiInput::updateQueue() {
-  int tempTS = midiIn->getMessage(&msgQueue);
+  midiEvent ev;
+  int tempTS = 0;
+
+  msgQueue.clear();
+  if (thruQueue.pop(ev)) {
+    msgQueue.assign(ev.data, ev.data + ev.size);
+    tempTS = ev.delta;
+  }
+
   if (isUntimedQueue()) {
     timestamp += GetFrameTime();
     ctr.livePlayOffset += GetFrameTime() * UNK_CST;
@@ -83,7 +141,6 @@ bool midiInput::updateQueue() {
   }
 
   if (msgQueue.size() > 0) {
-    ctr.output.sendMessage(&msgQueue);
     if (!any_of(static_cast<int>(msgQueue[0]), 248, 254)) {
       logQ("timestamp:", timestamp);
     }
@@ -118,7 +175,8 @@ void midiInput::convertEvents() {
       ctr.livePlayOffset += fmax(0, timestamp) * UNK_CST;
     }
     else if (msgQueue[i] == 0b10010000) {  // 144: note on/off
-      if (msgQueue[i + 2] != 0) {          // if note on
+      noteEvents++;
+      if (msgQueue[i + 2] != 0) {  // if note on
         note tmpNote;
 
         tmpNote.x = ctr.livePlayOffset;
@@ -135,6 +193,13 @@ void midiInput::convertEvents() {
         // logQ("count, x, track, trackct:", noteCount, tmpNote.x,
         // tmpNote.track, noteStream.getTracks()[tmpNote.track].getNoteCount());
 
+        // a pending compaction reads the kept notes in place, they may only
+        // move once it is done; with the headroom left at the snapshot this
+        // takes a whole chunk of notes arriving during one compaction
+        if (compaction && noteStream.notes.size() == noteStream.notes.capacity()) {
+          compactor.wait();
+        }
+
         // partition finder requires the current note to be present
         noteStream.notes.push_back(tmpNote);
 
@@ -145,6 +210,7 @@ void midiInput::convertEvents() {
         noteStream.notes[noteCount].track = tmpNote.track;
 
         noteStream.getTracks()[tmpNote.track].insert(noteCount);
+        keys.push(tmpNote.y);
 
         // update last index only AFTER track splitter
         noteCount++;
@@ -158,10 +224,12 @@ void midiInput::convertEvents() {
       }
       else {
         int idx = findNoteIndex(static_cast<int>(msgQueue[i + 1]));
-        noteStream.notes[idx].isOn = false;
-        // note tmpNote = noteStream.notes[idx];
+        if (idx >= 0) {
+          noteStream.notes[idx].isOn = false;
+          // note tmpNote = noteStream.notes[idx];
 
-        numOn--;
+          numOn--;
+        }
 
         // cerr << "this note is: x, Y, Velocity:" << tmpNote.x << ", " <<
         // tmpNote.y << ", " << tmpNote.velocity << endl;
@@ -170,7 +238,7 @@ void midiInput::convertEvents() {
       for (auto& t : noteStream.getTracks()) {
         t.buildChordMap();
       }
-      noteStream.buildLineMap();
+      noteStream.buildLineMap(true);
       // logQ("line size:", noteStream.lines.size());
     }
   }
@@ -178,7 +246,7 @@ void midiInput::convertEvents() {
 
 int midiInput::findPartition(const note& n) {
   // logW(LL_WARN, "new note @", n.y);
-  return findTrack(n, noteStream, true, numOn);
+  return findTrack(n, noteStream, ctr.getAnalysisContext(), true, numOn);
 }
 
 void midiInput::updatePosition() {
@@ -195,22 +263,172 @@ void midiInput::updatePosition() {
   }
 }
 
+int midiInput::evictHistory() {
+  // keep only the configured window of history so that memory and the
+  // per-event rebuild cost stay bounded over long sessions
+  if (compaction) {
+    return compactor.done() ? finishCompaction() : 0;
+  }
+
+  if (!ctr.option.get(OPTION::SET_LIVE_RETENTION)) {
+    return 0;
+  }
+
+  double cutoff = ctr.livePlayOffset - ctr.option.get(OPTION::LIVE_RETENTION) * UNK_CST;
+  if (cutoff <= 0) {
+    return 0;
+  }
+
+  // notes are in x order; stop at the first note still held or in the window
+  int evict = 0;
+  while (evict < noteCount) {
+    const note& n = noteStream.notes[evict];
+    if (n.isOn || n.x + n.duration >= cutoff) {
+      break;
+    }
+    evict++;
+  }
+
+  // compact a whole chunk at once
+  if (evict < LIVE_CHUNK_SIZE) {
+    return 0;
+  }
+
+  // the worker reads the notes in place, leave a chunk of headroom so that
+  // new notes do not have to wait for it before they can be appended
+  if (noteStream.notes.capacity() - noteStream.notes.size() < LIVE_CHUNK_SIZE) {
+    noteStream.notes.reserve(noteStream.notes.size() + LIVE_CHUNK_SIZE);
+  }
+
+  compaction = std::make_unique<liveCompaction>();
+  liveCompaction& c = *compaction;
+  c.src = noteStream.notes.data();
+  c.evict = evict;
+  c.end = noteCount;
+  c.events = noteEvents;
+
+  // held notes are all past evict, found from the back like updatePosition()
+  for (int j = noteCount - 1; j >= evict && int(c.held.size()) < numOn; j--) {
+    if (noteStream.notes[j].isOn) {
+      c.held.push_back(j);
+    }
+  }
+  std::reverse(c.held.begin(), c.held.end());
+  for (int h : c.held) {
+    c.heldNotes.push_back(noteStream.notes[h]);
+  }
+
+  c.stream.tracks.resize(noteStream.tracks.size());
+  for (auto& t : c.stream.tracks) {
+    t.setNoteVector(&c.stream.notes);
+  }
+
+  compactor.run([](void* self, int, int) { static_cast<midiInput*>(self)->compact(); }, this);
+  return 0;
+}
+
+void midiInput::compact() {
+  TRACE_ZONE("input: compact");
+  liveCompaction& c = *compaction;
+  auto& kept = c.stream.notes;
+
+  // room for another chunk, so the stream does not reallocate right after
+  // the swap
+  kept.reserve(c.end - c.evict + LIVE_CHUNK_SIZE);
+  kept.resize(c.end - c.evict);
+
+  int from = c.evict;
+  for (unsigned int h = 0; h < c.held.size(); h++) {
+    std::copy(c.src + from, c.src + c.held[h], kept.begin() + (from - c.evict));
+    kept[c.held[h] - c.evict] = c.heldNotes[h];
+    from = c.held[h] + 1;
+  }
+  std::copy(c.src + from, c.src + c.end, kept.begin() + (from - c.evict));
+
+  for (unsigned int i = 0; i < kept.size(); i++) {
+    c.stream.tracks[kept[i].track].insert(i);
+  }
+  for (auto& t : c.stream.tracks) {
+    t.buildChordMap();
+  }
+  c.stream.buildLineMap(true);
+}
+
+int midiInput::finishCompaction() {
+  TRACE_ZONE("input: swap history");
+  liveCompaction& c = *compaction;
+  auto& kept = c.stream.notes;
+
+  // held notes went on changing here, and new ones may have arrived
+  for (int h : c.held) {
+    kept[h - c.evict] = noteStream.notes[h];
+  }
+  for (int i = c.end; i < noteCount; i++) {
+    kept.push_back(noteStream.notes[i]);
+    c.stream.tracks[kept.back().track].insert(kept.size() - 1);
+  }
+
+  int evicted = c.evict;
+  bool stale = c.events != noteEvents;
+
+  // the fft generator reads the live notes on the pool
+  ctr.fft.generator_join();
+  noteStream.notes.swap(kept);
+  noteStream.tracks.swap(c.stream.tracks);
+  for (auto& t : noteStream.tracks) {
+    t.setNoteVector(&noteStream.notes);
+  }
+  noteStream.lines.swap(c.stream.lines);
+  noteStream.maxLineWidth = c.stream.maxLineWidth;
+
+  noteCount -= evicted;
+  noteStream.setNoteCount(noteCount);
+
+  // its bins still hold the indices from before the shift
+  ctr.fft.clearBins();
+
+  // the maps were built before the latest events, redo them once as
+  // convertEvents() would have
+  if (stale) {
+    for (auto& t : noteStream.getTracks()) {
+      t.buildChordMap();
+    }
+    noteStream.buildLineMap(true);
+  }
+
+  // the old history is freed off the render thread as well
+  reaper().retire(std::move(compaction));
+
+  logQ("evicted", evicted, "live notes, kept", noteCount);
+  return evicted;
+}
+
 int midiInput::findNoteIndex(int key) {
+  // only a held note is ended, finished ones are never written again
   for (int i = noteCount - 1; i >= 0; i--) {
-    if (noteStream.notes[i].y == key) {
+    if (noteStream.notes[i].y == key && noteStream.notes[i].isOn) {
       return i;
     }
   }
-  return 0;
+  return -1;
 }
 
-void midiInput::update() {
+int midiInput::update() {
+  TRACE_ZONE("input: update");
+  int evicted = 0;
+  thruActive = ctr.getLiveState();
+
+  if (unsigned int dropped = thruDropped.exchange(0)) {
+    logW(LL_WARN, "[IN] visualizer queue full, dropped", dropped, "events");
+  }
+
   if (ctr.getLiveState()) {
     if (midiIn->isPortOpen()) {
       while (updateQueue()) {
         convertEvents();
         updatePosition();
       }
+      evicted = evictHistory();
       // TODO: consider optimization
       // ctr.input.noteStream.buildLineMap();
     }
@@ -221,11 +439,7 @@ void midiInput::update() {
   }
   else {
     // empty midi queue
-    while (true) {
-      midiIn->getMessage(&msgQueue);
-      if (!msgQueue.size()) {
-        break;
-      }
-    }
+    thruQueue.clear();
   }
+  return evicted;
 }
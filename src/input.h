@@ -1,37 +1,75 @@
 #pragma once
 
+#include <atomic>
 #include <memory>
 #include <string>
 #include <vector>
 
 #include "../dpd/rtmidi/RtMidi.h"
+#include "data.h"
+#include "key_detect.h"
 #include "log.h"
 #include "midi.h"
 #include "note.h"
+#include "ring.h"
+#include "task.h"
 #include "track_split.h"
 
+using std::atomic;
 using std::string;
 using std::unique_ptr;
 using std::vector;
 
+struct midiEvent {
+  double delta;
+  unsigned char size;
+  unsigned char data[MIDI_THRU_MSG_SIZE];
+};
+
+// the history kept after an eviction, with its chord and line maps, built on
+// the pool from a snapshot of the live stream
+struct liveCompaction {
+  midi stream;
+
+  // live notes [evict, end) are kept; src is read in place by the worker, so
+  // the render thread neither moves them nor writes the finished ones
+  const note* src = nullptr;
+  int evict = 0;
+  int end = 0;
+  unsigned int events = 0;
+
+  // notes held at the snapshot keep changing on the render thread, which
+  // copies them instead of the worker
+  vector<int> held;
+  vector<note> heldNotes;
+};
+
 class midiInput {
  public:
   midiInput();
 
   void openPort(int port, bool pauseEvent = false);
   void resetInput();
-  void update();
+  // notes evicted from the front of noteStream this frame; indices into it
+  // held across frames have to be shifted down by as many
+  int update();
   void pauseInput();
   void resumeInput();
 
   int getNoteCount() { return noteCount; }
+  const keyWindow& getKeys() const { return keys; }
   vector<string> getPorts();
 
   midi noteStream;
 
  private:
+  static void thruCallback(double delta, vector<unsigned char>* msg, void* userData);
+
   void convertEvents();
   void updatePosition();
+  int evictHistory();
+  void compact();
+  int finishCompaction();
   bool updateQueue();
   bool isUntimedQueue();
   int findNoteIndex(int key);
@@ -39,9 +77,26 @@ class midiInput {
 
   unique_ptr<RtMidiIn> midiIn;
   vector<unsigned char> msgQueue;
+
+  // written by the input callback thread, drained by the render thread
+  ringBuffer<midiEvent, MIDI_THRU_QUEUE> thruQueue;
+  atomic<bool> thruActive;
+  atomic<unsigned int> thruDropped;
+
+  keyWindow keys = keyWindow(KEY_WINDOW_NOTES);
+
   int numPort;
   int curPort;
   int noteCount;
   int numOn;
   double timestamp;
+
+  // note on/off events seen, tells whether a compaction result is stale
+  unsigned int noteEvents;
+
+  unique_ptr<liveCompaction> compaction;
+
+  // declared last so that it waits for the worker before anything it reads
+  // is destroyed
+  taskGroup compactor;
 };
@@ -0,0 +1,89 @@
+#include "key_detect.h"
+
+#include <limits>
+
+#include "data.h"
+#include "task.h"
+
+namespace {
+
+// the 13 keys considered by the detector, 7 flat/sharp keys are left out
+constexpr int candidateKeys[] = {KEYSIG_C, KEYSIG_DFLAT, KEYSIG_D, KEYSIG_EFLAT, KEYSIG_E, KEYSIG_F, KEYSIG_FSHARP,
+                                 KEYSIG_GFLAT, KEYSIG_G, KEYSIG_AFLAT, KEYSIG_A, KEYSIG_BFLAT, KEYSIG_B};
+
+// scale degrees of a major scale, relative to the tonic
+constexpr bool majorScale[12] = {1, 0, 1, 0, 1, 1, 0, 1, 0, 1, 0, 1};
+
+}  // namespace
+
+int pitchHistogram::score(const keySig& key) const {
+  // notes on the key count for, notes off it against
+  int s = 0;
+  for (int pc = 0; pc < 12; ++pc) {
+    s += majorScale[(pc - key.getIndex() + 12) % 12] ? bins[pc] : -bins[pc];
+  }
+  return s;
+}
+
+int pitchHistogram::findKey() const {
+  int best = KEYSIG_C;
+  int bestScore = std::numeric_limits<int>::min();
+
+  for (int k : candidateKeys) {
+    int s = score(keySig(k, 0, 0));
+    if (s > bestScore) {
+      best = k;
+      bestScore = s;
+    }
+  }
+  return best;
+}
+
+pitchHistogram buildHistogram(const vector<note>& notes) {
+  using binArray = array<int, 12>;
+  const int count = notes.size();
+
+  auto countRange = [&](int lo, int hi, binArray& acc) {
+    for (int i = lo; i < hi; ++i) {
+      acc[pitchHistogram::pitchClass(notes[i].y)]++;
+    }
+  };
+  auto addBins = [](binArray a, const binArray& b) {
+    for (int pc = 0; pc < 12; ++pc) {
+      a[pc] += b[pc];
+    }
+    return a;
+  };
+
+  // songs below KEY_PARALLEL_MIN notes are a single range, counted inline
+  pitchHistogram hist;
+  hist.bins = parallelReduce(0, count, KEY_PARALLEL_MIN, binArray{}, countRange, addBins);
+  hist.total = count;
+  return hist;
+}
+
+void keyWindow::push(int y) {
+  if (history.empty()) {
+    return;
+  }
+
+  if (count == static_cast<int>(history.size())) {
+    hist.remove(history[head]);
+  }
+  else {
+    count++;
+  }
+
+  history[head] = y;
+  head = (head + 1) % history.size();
+  hist.add(y);
+
+  key = hist.findKey();
+}
+
+void keyWindow::clear() {
+  hist.clear();
+  head = 0;
+  count = 0;
+  key = KEYSIG_C;
+}
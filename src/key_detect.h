@@ -0,0 +1,64 @@
+#pragma once
+
+#include <array>
+#include <vector>
+
+#include "note.h"
+#include "timekey.h"
+
+using std::array;
+using std::vector;
+
+// 12-bin pitch class histogram; candidate keys are scored against the bins
+// instead of rescanning every note per key
+class pitchHistogram {
+ public:
+  void add(int y) {
+    bins[pitchClass(y)]++;
+    total++;
+  }
+  void remove(int y) {
+    bins[pitchClass(y)]--;
+    total--;
+  }
+  void clear() {
+    bins = {};
+    total = 0;
+  }
+
+  int getTotal() const { return total; }
+  int score(const keySig& key) const;
+
+  // major key (KEYSIG_*) matching the most notes, ties go to the earlier candidate
+  int findKey() const;
+
+  friend pitchHistogram buildHistogram(const vector<note>& notes);
+
+ private:
+  static int pitchClass(int y) { return (y % 12 + 12) % 12; }
+
+  array<int, 12> bins = {};
+  int total = 0;
+};
+
+pitchHistogram buildHistogram(const vector<note>& notes);
+
+// key over the most recent notes; each note enters and leaves the histogram
+// once, so keeping the window current is constant time per note
+class keyWindow {
+ public:
+  keyWindow(int size) : history(size), key(KEYSIG_C) {}
+
+  void push(int y);
+  void clear();
+
+  bool empty() const { return count == 0; }
+  int getKey() const { return key; }
+
+ private:
+  pitchHistogram hist;
+  vector<int> history;
+  int head = 0;
+  int count = 0;
+  int key;
+};
@@ -6,3 +6,11 @@
 #include "wrap.h"
 
 double kMeansPoint::distance(const kMeansPoint& point) { return deltaE(data, point.data); }
+
+double kMeansPoint::euclidean(const kMeansPoint& point) const {
+  // squared CIE76 distance, cheap screening metric for the full deltaE
+  double dl = data.l - point.data.l;
+  double da = data.a - point.data.a;
+  double db = data.b - point.data.b;
+  return dl * dl + da * da + db * db;
+}
@@ -3,6 +3,7 @@
 #include <vector>
 
 #include "color.h"
+#include "color_raylib.h"
 #include "log.h"
 
 struct lchIntermediary {
@@ -17,11 +18,12 @@ class kMeansPoint {
   kMeansPoint(const colorRGB& color) : data(color.getLAB()), cluster(-1), cDist(__DBL_MAX__) {}
   kMeansPoint(const colorLAB& color) : data(color), cluster(-1), cDist(__DBL_MAX__) {}
   kMeansPoint(float l, float a, float b) : data(l, a, b), cluster(-1), cDist(__DBL_MAX__) {}
-  kMeansPoint(const Color& color) : data(color), cluster(-1), cDist(__DBL_MAX__) {}
+  kMeansPoint(const Color& color) : data(toColorRGB(color)), cluster(-1), cDist(__DBL_MAX__) {}
 
   colorLAB data;
   int cluster = -1;
   double cDist;
 
   double distance(const kMeansPoint& point);
+  double euclidean(const kMeansPoint& point) const;
 };
@@ -0,0 +1,199 @@
+#include "log.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <mutex>
+#include <thread>
+
+using std::atomic;
+using std::lock_guard;
+using std::mutex;
+using std::thread;
+
+namespace {
+
+const char* levelText(logLevel level) {
+  switch (level) {
+    case LL_INFO:
+      return "INFO: ";
+    case LL_WARN:
+      return "WARN: ";
+    case LL_CRIT:
+      return "CRITICAL ERROR: ";
+    case LL_DEBUG:
+      return "DEBUG: ";
+  }
+  return "undefined error level: ";
+}
+
+void writeColor(logLevel level, ostringstream& out) {
+#ifdef __WIN32
+  // colored output not supported
+  out << levelText(level);
+#else
+  const char* csel[7] = {"\033[0;34m", "\033[0;32m",  // blue   , green
+                         "\033[0;36m", "\033[0;31m",  // cyan   , red
+                         "\033[0;35m", "\033[0;33m",  // magenta, yellow
+                         "\033[0m"};                  // default
+
+  int cpos = 7;
+  switch (level) {
+    case LL_DEBUG:
+      cpos = 1;
+      break;
+    case LL_INFO:
+      cpos = 3;
+      break;
+    case LL_WARN:
+      cpos = 6;
+      break;
+    case LL_CRIT:
+      cpos = 4;
+      break;
+  }
+  out << csel[cpos - 1] << levelText(level) << "\033[0m";
+#endif
+}
+
+template <typename T>
+T readValue(const char* data) {
+  T v;
+  std::memcpy(&v, data, sizeof(v));
+  return v;
+}
+
+void formatRecord(const logRecord& rec, ostringstream& out) {
+  writeColor(rec.level, out);
+
+  for (size_t pos = 0, idx = 0; pos < rec.size; ++idx) {
+    if (idx) {
+      out << " ";
+    }
+    const logArgType type = static_cast<logArgType>(rec.payload[pos++]);
+    switch (type) {
+      case LA_INT:
+        out << readValue<long long>(rec.payload + pos);
+        pos += sizeof(long long);
+        break;
+      case LA_UINT:
+        out << readValue<unsigned long long>(rec.payload + pos);
+        pos += sizeof(unsigned long long);
+        break;
+      case LA_FLOAT:
+        out << readValue<double>(rec.payload + pos);
+        pos += sizeof(double);
+        break;
+      case LA_CHAR:
+        out << rec.payload[pos];
+        pos += 1;
+        break;
+      case LA_STR: {
+        unsigned short len = readValue<unsigned short>(rec.payload + pos);
+        pos += sizeof(len);
+        out.write(rec.payload + pos, len);
+        pos += len;
+        break;
+      }
+    }
+  }
+  if (rec.truncated) {
+    out << "...";
+  }
+
+  out << LOGQ_SEP << rec.file << ":" << rec.line << "\n";
+}
+
+// formats and writes queued records; a single consumer at a time, either the
+// writer thread or a thread flushing a critical error
+class logBackend {
+ public:
+  logBackend() {
+    thread(&logBackend::writerLoop, this).detach();
+    std::atexit([] { logFlush(); });
+  }
+
+  logQueue ring;
+  atomic<size_t> dropped = 0;
+
+  // bumped after every push, the writer blocks on it while the queue is empty
+  atomic<unsigned int> pushed = 0;
+
+  // returns false if there was nothing to write
+  bool drain() {
+    lock_guard<mutex> lk(consumer);
+
+    out.str("");
+    size_t count = 0;
+    // bounded, so a thread that keeps logging cannot hold the lock forever
+    while (count < LOG_QUEUE_SIZE && ring.pop([&](const logRecord& rec) { formatRecord(rec, out); })) {
+      count++;
+    }
+
+    size_t lost = dropped.exchange(0, std::memory_order_relaxed);
+    if (lost) {
+      logRecord rec;
+      rec.level = LL_WARN;
+      rec.file = logFile(__FILE__);
+      rec.line = __LINE__;
+      rec.size = 0;
+      rec.truncated = false;
+      logEncode(rec, lost);
+      logEncode(rec, "log records dropped, queue full");
+      formatRecord(rec, out);
+    }
+
+    if (!count && !lost) {
+      return false;
+    }
+
+    // one write per batch keeps lines from other writers to stderr intact
+    const string text = out.str();
+    cerr.write(text.data(), text.size());
+    cerr.flush();
+    return true;
+  }
+
+ private:
+  void writerLoop() {
+    while (true) {
+      // read before draining, so a push that lands after the drain still
+      // changes it and the wait returns at once
+      const unsigned int seen = pushed.load(std::memory_order_acquire);
+      if (!drain()) {
+        pushed.wait(seen, std::memory_order_acquire);
+      }
+    }
+  }
+
+  mutex consumer;
+  ostringstream out;
+};
+
+logBackend& backend() {
+  // never destroyed, threads may still log while statics are torn down
+  static logBackend* b = new logBackend();
+  return *b;
+}
+
+}  // namespace
+
+logQueue& logRing() { return backend().ring; }
+
+void logNotify(logLevel level, bool queued) {
+  logBackend& b = backend();
+  if (!queued) {
+    b.dropped.fetch_add(1, std::memory_order_relaxed);
+  }
+  b.pushed.fetch_add(1, std::memory_order_release);
+  b.pushed.notify_one();
+
+  if (level == LL_CRIT) {
+    logFlush();
+  }
+}
+
+void logFlush() {
+  // the queue never holds more than one batch, so whatever was queued before
+  // this call is out once a drain has run after it
+  backend().drain();
+}
@@ -1,11 +1,18 @@
 #pragma once
 
+#include <cstring>
 #include <iomanip>
 #include <iostream>
 #include <sstream>
 #include <string>
+#include <string_view>
+#include <type_traits>
 #include <vector>
 
+#include "build_flags.h"
+#include "data.h"
+#include "ring.h"
+
 #ifdef __WIN32
   #define LOGQ_SEP " -> "
 #else
@@ -21,81 +28,48 @@ using std::ostringstream;
 using std::pair;
 using std::setprecision;
 using std::string;
+using std::string_view;
 using std::true_type;
 using std::vector;
 
-#define logW(a, ...) logOutput(a, __FILE__, __LINE__, __VA_ARGS__)
+// levels that are compiled out never evaluate their arguments
+#define logW(a, ...)                                                        \
+  do {                                                                      \
+    if constexpr (logEnabled(a)) {                                          \
+      logOutput(a, logFile(__FILE__), __LINE__ __VA_OPT__(, ) __VA_ARGS__); \
+    }                                                                       \
+  } while (0)
+
+// errors go through the queue like any record, and are written out before
+// the call returns
+#define logE(...) logW(LL_CRIT __VA_OPT__(, ) __VA_ARGS__)
 
 #ifndef NO_DEBUG
-  #define logQ(...) logOutput(LL_DEBUG, __FILE__, __LINE__, __VA_ARGS__)
-  #define logC(a, b) logOutput(LL_CRIT, __FILE__, __LINE__, a, "v.", b)
-  #define logE() cerr << endl
+  #define logQ(...) logW(LL_DEBUG, __VA_ARGS__)
+  #define logC(a, b) logW(LL_CRIT, a, "v.", b)
 #else
   #define logQ(...) ;
   #define logC(a, b) ;
-  #define logE() cerr << endl
 #endif
 enum logLevel { LL_INFO, LL_WARN, LL_CRIT, LL_DEBUG };
 
-inline void logProcess(const logLevel& level, string& lvmsg, string& file) {
-  if (level == LL_INFO) {
-    lvmsg = "INFO: ";
-  }
-  else if (level == LL_WARN) {
-    lvmsg = "WARN: ";
-  }
-  else if (level == LL_CRIT) {
-    lvmsg = "CRITICAL ERROR: ";
-  }
-  else if (level == LL_DEBUG) {
-    lvmsg = "DEBUG: ";
-  }
-  else {
-    lvmsg = "undefined error level: ";
-  }
-
-  for (unsigned int i = 0; i < file.length(); i++) {
-    if (file[file.length() - i] == '/') {
-      file = file.substr(file.length() - i + 1, file.length());
-    }
-  }
-}
-
-#ifdef __WIN32
-// colored output not supported
-inline void writeColor(string& lvmsg, ostringstream& out) {
+constexpr bool logEnabled([[maybe_unused]] logLevel level) {
+#ifdef NO_DEBUG
+  return level != LL_DEBUG;
 #else
-inline void writeColor(const logLevel& level, string& lvmsg, ostringstream& out) {
+  return true;
 #endif
+}
 
-#ifdef __WIN32
-  // HANDLE hConsole = GetStdHandle(STD_ERROR_HANDLE);
-  // SetConsoleTextAttribute(hConsole, cpos);
-  out << lvmsg;
-  // SetConsoleTextAttribute(hConsole, 7);
-#else
-  const char* csel[7] = {"\033[0;34m", "\033[0;32m",  // blue   , green
-                         "\033[0;36m", "\033[0;31m",  // cyan   , red
-                         "\033[0;35m", "\033[0;33m",  // magenta, yellow
-                         "\033[0m"};                  // default
-
-  int cpos = 7;
-  switch (level) {
-    case LL_DEBUG:
-      cpos = 1;
-      break;
-    case LL_INFO:
-      cpos = 3;
-      break;
-    case LL_WARN:
-      cpos = 6;
-      break;
-    case LL_CRIT:
-      cpos = 4;
-      break;
+// file name without its directories, cut at compile time
+consteval const char* logFile(const char* path) {
+  const char* file = path;
+  for (const char* c = path; *c; ++c) {
+    if (*c == '/' || *c == '\\') {
+      file = c + 1;
+    }
   }
-  out << csel[cpos - 1] << lvmsg << "\033[0m";
-#endif
+  return file;
 }
 
 template <typename T>
@@ -177,108 +151,112 @@ string formatVector(const vector<pair<U, V>>& vec) {
   return s;
 }
 
-template <typename U, typename V>
-U& logRecursive(U& stream, const V& arg1) {
-  stream << " ";
-  if constexpr (is_vector<V>::value) {
-    return (stream << formatVector(arg1));
-  }
-  else if constexpr (is_pair<V>::value) {
-    return (stream << formatPair(arg1));
-  }
-  else if constexpr (is_enum<V>::value) {
-    return (stream << static_cast<int>(arg1));
-  }
-  else {
-    return (stream << arg1);
-  }
-}
+// argument tags in a record payload: one byte of tag, then the value
+enum logArgType : unsigned char { LA_INT, LA_UINT, LA_FLOAT, LA_CHAR, LA_STR };
+
+// what a call site hands to the writer thread; arguments are stored by value so
+// nothing is formatted or allocated on the calling thread for plain types
+struct logRecord {
+  logLevel level;
+  const char* file;
+  int line;
+  unsigned short size;
+  bool truncated;
+  char payload[LOG_PAYLOAD_SIZE];
+};
 
-template <typename U, typename V, typename... W>
-U& logRecursive(U& stream, const V& arg1, const W&... args) {
-  stream << " ";
-  if constexpr (is_vector<V>::value) {
-    return logRecursive((stream << formatVector(arg1)), args...);
-  }
-  else if constexpr (is_pair<V>::value) {
-    return logRecursive((stream << formatPair(arg1)), args...);
-  }
-  else if constexpr (is_enum<V>::value) {
-    return logRecursive((stream << static_cast<int>(arg1)), args...);
-  }
-  else {
-    return logRecursive((stream << arg1), args...);
+using logQueue = mpscRing<logRecord, LOG_QUEUE_SIZE>;
+
+// shared by all threads, drained by the writer thread
+logQueue& logRing();
+
+// wakes the writer thread, counts a record that did not fit, and writes
+// everything out right away for critical errors so they are not lost if the
+// program goes down
+void logNotify(logLevel level, bool queued);
+
+// writes out all queued records on the calling thread
+void logFlush();
+
+inline void logPut(logRecord& rec, logArgType type, const void* data, size_t bytes) {
+  if (rec.truncated || rec.size + 1 + bytes > LOG_PAYLOAD_SIZE) {
+    rec.truncated = true;
+    return;
   }
+  rec.payload[rec.size++] = type;
+  std::memcpy(rec.payload + rec.size, data, bytes);
+  rec.size += bytes;
 }
 
-template <typename V, typename... W>
-void logOutput(logLevel level, string file, int line, const V& arg1, const W&... args) {
-#ifdef NO_DEBUG
-  if (level == LL_DEBUG) {
+inline void logPutString(logRecord& rec, string_view str) {
+  const size_t header = 1 + sizeof(unsigned short);
+  if (rec.truncated || rec.size + header > LOG_PAYLOAD_SIZE) {
+    rec.truncated = true;
     return;
   }
-#endif
-
-  ostringstream out;
-  string lvmsg = "";
-
-  logProcess(level, lvmsg, file);
-#ifdef __WIN32
-  writeColor(lvmsg, out);
-#else
-  writeColor(level, lvmsg, out);
-#endif
+  unsigned short len = std::min(str.size(), LOG_PAYLOAD_SIZE - rec.size - header);
+  rec.payload[rec.size++] = LA_STR;
+  std::memcpy(rec.payload + rec.size, &len, sizeof(len));
+  rec.size += sizeof(len);
+  std::memcpy(rec.payload + rec.size, str.data(), len);
+  rec.size += len;
+  rec.truncated = len < str.size();
+}
 
-  if constexpr (is_vector<V>::value) {
-    logRecursive((out << formatVector(arg1)), args...);
-  }
-  else if constexpr (is_pair<V>::value) {
-    logRecursive((out << formatPair(arg1)), args...);
+template <typename V>
+void logEncode(logRecord& rec, const V& arg) {
+  if constexpr (std::is_same_v<V, char> || std::is_same_v<V, signed char> || std::is_same_v<V, unsigned char>) {
+    logPut(rec, LA_CHAR, &arg, 1);
   }
   else if constexpr (is_enum<V>::value) {
-    logRecursive((out << static_cast<int>(arg1)), args...);
+    long long v = static_cast<int>(arg);
+    logPut(rec, LA_INT, &v, sizeof(v));
   }
-  else {
-    logRecursive((out << arg1), args...);
+  else if constexpr (std::is_integral_v<V> && std::is_signed_v<V>) {
+    long long v = arg;
+    logPut(rec, LA_INT, &v, sizeof(v));
   }
-
-  out << LOGQ_SEP << file << ":" << line << endl;
-
-  cerr << out.str();
-}
-
-template <typename V>
-void logOutput(logLevel level, string file, int line, const V& arg1) {
-#ifdef NO_DEBUG
-  if (level == LL_DEBUG) {
-    return;
+  else if constexpr (std::is_integral_v<V>) {
+    unsigned long long v = arg;
+    logPut(rec, LA_UINT, &v, sizeof(v));
   }
-#endif
-
-  ostringstream out;
-  string lvmsg = "";
-
-  logProcess(level, lvmsg, file);
-#ifdef __WIN32
-  writeColor(lvmsg, out);
-#else
-  writeColor(level, lvmsg, out);
-#endif
-
-  if constexpr (is_vector<V>::value) {
-    out << formatVector(arg1);
+  else if constexpr (std::is_floating_point_v<V>) {
+    double v = arg;
+    logPut(rec, LA_FLOAT, &v, sizeof(v));
   }
-  else if constexpr (is_pair<V>::value) {
-    out << formatPair(arg1);
+  else if constexpr (std::is_convertible_v<const V&, string_view>) {
+    logPutString(rec, string_view(arg));
   }
-  else if constexpr (is_enum<V>::value) {
-    out << static_cast<int>(arg1);
+  else if constexpr (is_vector<V>::value) {
+    logPutString(rec, formatVector(arg));
+  }
+  else if constexpr (is_pair<V>::value) {
+    logPutString(rec, formatPair(arg));
   }
   else {
-    out << arg1;
+    // anything else only has operator<<, so it is formatted here
+    ostringstream ss;
+    ss << arg;
+    logPutString(rec, ss.str());
   }
+}
 
-  out << LOGQ_SEP << file << ":" << line << endl;
-
-  cerr << out.str();
+template <typename... V>
+void logOutput(logLevel level, const char* file, int line, const V&... args) {
+  logRecord rec;
+  rec.level = level;
+  rec.file = file;
+  rec.line = line;
+  rec.size = 0;
+  rec.truncated = false;
+  (logEncode(rec, args), ...);
+
+  auto copy = [&](logRecord& slot) { std::memcpy(&slot, &rec, offsetof(logRecord, payload) + rec.size); };
+  bool queued = logRing().push(copy);
+  if (!queued && level == LL_CRIT) {
+    // a critical error is never dropped, make room for it instead
+    logFlush();
+    queued = logRing().push(copy);
+  }
+  logNotify(level, queued);
 }
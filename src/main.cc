@@ -1,5 +1,6 @@
 #include <algorithm>
 #include <bit>
+#include <chrono>
 #include <ctime>
 #include <string>
 #include <thread>
@@ -14,6 +15,7 @@
 #include "data.h"
 #include "define.h"
 #include "draw.h"
+#include "draw_list.h"
 #include "enum.h"
 #include "fft.h"
 #include "gl_compat.h"
@@ -23,6 +25,8 @@
 #include "menu.h"
 #include "menuctr.h"
 #include "misc.h"
+#include "task.h"
+#include "trace.h"
 #include "wrap.h"
 
 using std::countl_zero;
@@ -43,6 +47,12 @@ int main(int argc, char* argv[]) {
   // SetTraceLogLevel(LOG_DEBUG);
 #endif
 
+  TRACE_THREAD("render");
+
+  // startup phases are logged to find what delays the first frame
+  auto startupPhase = std::chrono::high_resolution_clock::now();
+  bool firstFrame = true;
+
   // basic window setup
   const string windowTitle = string(W_NAME) + " " + string(W_VER);
 
@@ -57,9 +67,14 @@ int main(int argc, char* argv[]) {
   SetExitKey(KEY_F7);
   SetWindowMinSize(W_WIDTH, W_HEIGHT);
 
+  debug_time(startupPhase, "startup: window");
+  startupPhase = std::chrono::high_resolution_clock::now();
+
   // no packed executable data can be loaded before this point
   ctr.init(assetSet);
 
+  startupPhase = std::chrono::high_resolution_clock::now();
+
   // program-wide variables
 
   // scaling settings
@@ -90,6 +105,7 @@ int main(int argc, char* argv[]) {
   double nowLineX = ctr.getWidth() / 2.0f;
 
   string FPSText = "";
+  string fileText = "";
 
   enumChecker<hoverType> hoverType;
   ACTION action = ACTION::NONE;
@@ -108,6 +124,28 @@ int main(int argc, char* argv[]) {
   bool clickOn = false;
   bool clickOnTmp = false;
 
+  // everything a hit test depends on, the last result is reused while none of
+  // it changes (paused, mouse at rest)
+  struct hoverView {
+    int mouseX;
+    int mouseY;
+    double timeOffset;
+    double zoomLevel;
+    double nowLineX;
+    int width;
+    int height;
+    int topHeight;
+    int displayMode;
+    bool onMenu;
+    const note* noteData;
+    int noteCount;
+
+    bool operator==(const hoverView&) const = default;
+  };
+  hoverView lastHoverView = {};
+  // note under the mouse, or line in the line modes; last in draw order wins
+  int hoverItem = -1;
+
   // screen space conversion functions
   const auto convertSSX = [&](int value) { return nowLineX + (value - timeOffset) * zoomLevel; };
 
@@ -169,6 +207,9 @@ int main(int argc, char* argv[]) {
 
   menu colorSelect(ctr.getSize(), CONTENT_COLORSELECT, TYPE_COLOR, -100, -100, &rightMenu, 1);
 
+  debug_time(startupPhase, "startup: menus");
+  startupPhase = std::chrono::high_resolution_clock::now();
+
   if (argc >= 2) {
     // input parameter order is arbitrary
     ctr.updateFiles(&argv[1], argc - 1);
@@ -181,19 +222,17 @@ int main(int argc, char* argv[]) {
 
   // main program logic
   while (ctr.getProgramState()) {
+    TRACE_ZONE("frame");
+    TRACE_STAGE(stage, "frame: poll");
+
     if (ctr.open_file.pending() || clearFile) {
       ctr.run = false;
       timeOffset = 0;
       pauseOffset = 0;
 
       if (ctr.open_file.pending()) {
-        ctr.load(ctr.open_file.getPath(), nowLine, showFPS, showImage, sheetMusicDisplay, measureLine, measureNumber,
-                 colorMode, displayMode, songTimeType, tonicOffset, zoomLevel);
-
-        if (ctr.getFileType() == FILE_MKI) {
-          ctr.save_file.setPending(ctr.open_file.getPath());
-        }
-
+        // parsed in the background, replacing any load still in flight
+        ctr.load(ctr.open_file.getPath());
         ctr.open_file.reset();
       }
       if (clearFile) {
@@ -202,17 +241,34 @@ int main(int argc, char* argv[]) {
       }
     }
 
+    // swap in a file once the loader thread has parsed it
+    if (ctr.updateLoad(nowLine, showFPS, showImage, sheetMusicDisplay, measureLine, measureNumber, colorMode,
+                       displayMode, songTimeType, tonicOffset, zoomLevel)) {
+      ctr.run = false;
+      timeOffset = 0;
+      pauseOffset = 0;
+
+      if (ctr.getFileType() == FILE_MKI) {
+        ctr.save_file.setPending(ctr.getFileFullPath());
+      }
+    }
+
     if (ctr.open_image.pending()) {
       ctr.image.load(ctr.open_image.getPath());
       ctr.open_image.reset();
     }
+    // upload an image once the loader thread has decoded it
+    ctr.image.update();
 
     if (ctr.getLiveState()) {
       timeOffset = ctr.livePlayOffset;
       ctr.run = false;
     }
     // empty input queue even if not rendering live input
-    ctr.input.update();
+    if (int evicted = ctr.input.update()) {
+      // live history moved down, forget a selection that was evicted with it
+      clickNote = clickNote >= evicted ? clickNote - evicted : -1;
+    }
 
     // fix FPS count bug
     GetFPS();
@@ -239,7 +295,576 @@ int main(int argc, char* argv[]) {
       hoverType.add(HOVER_DIALOG);
     }
 
+    auto getColorID = [&](int track, int velocity, int y) {
+      switch (colorMode) {
+        case COLOR_PART:
+          return track;
+        case COLOR_VELOCITY:
+          if (ctr.option.get(OPTION::SCALE_VELOCITY) && !ctr.getLiveState() &&
+              stream.velocityBounds.first != stream.velocityBounds.second) {
+            int range = stream.velocityBounds.second - stream.velocityBounds.first;
+            return static_cast<int>((velocity - stream.velocityBounds.first) * (127.0 / range));
+          }
+          else {
+            return velocity;
+          }
+        case COLOR_TONIC:
+          return (y - MIN_NOTE_IDX + tonicOffset) % 12;
+      }
+      return 0;
+    };
+    auto getColorSet = [&](int idx) { return getColorID(notes[idx].track, notes[idx].velocity, notes[idx].y); };
+
+    // hit tests ask the time index for the few notes near the mouse instead of
+    // testing every note on screen; live input has no index and scans them all
+    const noteLOD& lod = stream.getLOD();
+    const auto hitNote = [&](int i) {
+      float cX = convertSSX(notes[i].x);
+      float cY = convertSSY(notes[i].y);
+      float cW = notes[i].duration * zoomLevel < 1 ? 1 : notes[i].duration * zoomLevel;
+      float cH = (ctr.getHeight() - ctr.menuHeight) / 88.0f;
+      bool noteOn = notes[i].isOn || (timeOffset >= notes[i].x && timeOffset < notes[i].x + notes[i].duration);
+
+      switch (displayMode) {
+        case DISPLAY_BAR:
+        case DISPLAY_FFT:
+          return pointInBox(getMousePosition(), (rect){int(cX), int(cY), int(cW), int(cH)}) && !ctr.menu.mouseOnMenu();
+        case DISPLAY_VORONOI: {
+          if (cX <= -0.2 * ctr.getWidth() || cX + cW >= 1.2 * ctr.getWidth()) {
+            return false;
+          }
+          float radius = 1 + log2(cW + 1);
+          return getDistance(ctr.getMouseX(), ctr.getMouseY(), cX, cY + cH / 2) < radius + 2;
+        }
+        case DISPLAY_BALL: {
+          if (ctr.menu.mouseOnMenu()) {
+            return false;
+          }
+          float radius = -1 + 2 * (32 - countl_zero(static_cast<unsigned int>(cW)));
+          float ballY = cY + 2;
+          if (cX < nowLineX - cW) {
+            radius *= 0.3;
+          }
+          if (noteOn) {
+            radius *= (0.3f + 0.7f * (1.0f - float(timeOffset - notes[i].x) / notes[i].duration));
+          }
+          int realX = cX > nowLineX ? cX : cX + cW < nowLineX ? cX + cW : nowLineX;
+          if (getDistance(ctr.getMouseX(), ctr.getMouseY(), realX, ballY) < radius) {
+            return true;
+          }
+          return realX == nowLineX &&
+                 (getDistance(ctr.getMouseX(), ctr.getMouseY(), cX, ballY) < radius ||
+                  pointInBox(getMousePosition(), (rect){int(cX), int(ballY) - 2, max(int(nowLineX - cX), 0), 4}));
+        }
+      }
+      return false;
+    };
+    const auto hitLine = [&](const lineData& l) {
+      point a = {static_cast<int>(convertSSX(l.x_l)), static_cast<int>(convertSSY(l.y_l))};
+      point b = {static_cast<int>(l.in_progress ? nowLineX : convertSSX(l.x_r)), static_cast<int>(convertSSY(l.y_r))};
+      return pointInBox(getMousePosition(), pointToRect(a, b));
+    };
+    const auto findHover = [&]() {
+      int hit = -1;
+      const double mouseTime = unconvertSSX(ctr.getMouseX());
+      const double reach = HOVER_REACH / zoomLevel;
+      switch (displayMode) {
+        case DISPLAY_LINE:
+        case DISPLAY_PULSE:
+        case DISPLAY_LOOP: {
+          const vector<lineData>& lp = stream.getLines();
+          unsigned int j = ctr.getLiveState() ? 0 : stream.findFirstLine(mouseTime - reach);
+          for (; j < lp.size() && (ctr.getLiveState() || lp[j].x_l <= mouseTime + reach); ++j) {
+            if (hitLine(lp[j])) {
+              hit = j;
+            }
+          }
+        } break;
+        default:
+          if (!ctr.getLiveState() && lod.isBuilt()) {
+            lod.findNotes(notes, mouseTime - reach, mouseTime + reach, [&](int idx) {
+              if (hitNote(idx)) {
+                hit = max(hit, idx);
+              }
+            });
+          }
+          else {
+            for (int i = 0; i < ctr.getNoteCount(); i++) {
+              if (hitNote(i)) {
+                hit = i;
+              }
+            }
+          }
+      }
+      return hit;
+    };
+
+    const hoverView view = {ctr.getMouseX(),  ctr.getMouseY(),        timeOffset,   zoomLevel,
+                            nowLineX,         ctr.getWidth(),         ctr.getHeight(), ctr.topHeight,
+                            displayMode,      ctr.menu.mouseOnMenu(), notes.data(), ctr.getNoteCount()};
+    if (ctr.getLiveState() || !(view == lastHoverView)) {
+      hoverItem = findHover();
+      lastHoverView = view;
+    }
+
+    // away from the now line, bars and balls keep their look and only move with
+    // song time, so they are drawn once per view into cached tiles; zoomed out
+    // far enough that pixel columns hold many notes, bars come from the
+    // load-time summary instead. either way only notes that are playing or near
+    // the mouse go through the loop below
+    const bool staticField =
+        (displayMode == DISPLAY_BAR || displayMode == DISPLAY_BALL) && !ctr.getLiveState() && lod.isBuilt();
+    const bool useLOD = staticField && displayMode == DISPLAY_BAR && zoomLevel < LOD_MAX_ZOOM;
+    bool useTiles = staticField && !useLOD;
+
+    // snapshot, the render thread adds hover flags while the worker runs
+    const bool dialogHover = hoverType.contains(HOVER_DIALOG);
+
+    // the note field is recorded on a worker while this thread draws the
+    // background, image, voronoi pass and measure grid, and replayed at the
+    // note stage. the worker only reads song and view state, everything it
+    // would hand to other subsystems goes through the list
+    const auto buildScene = [&](drawList& scene, bool cachedField) {
+      TRACE_ZONE("scene: build");
+      scene.clear();
+      pair<double, double> currentBoundaries = inverseSSX();
+
+      if (useLOD) {
+        const int level = lod.findLevel(1.0 / zoomLevel);
+        const double bucketWidth = lod.getBucketWidth(level);
+        const float cW = max(bucketWidth * zoomLevel, 1.0);
+        const float cH = (ctr.getHeight() - ctr.menuHeight) / 88.0f;
+
+        auto [cell, lastCell] = lod.getCells(level, unconvertSSX(0), unconvertSSX(ctr.getWidth()));
+        while (cell != lastCell) {
+          // the track holding the pitch longest gives the color
+          const lodCell* top = cell;
+          for (++cell; cell != lastCell && cell->bucket == top->bucket && cell->y == top->y; ++cell) {
+            if (cell->coverage > top->coverage) {
+              top = cell;
+            }
+          }
+          const auto& col = colorSetOff[getColorID(top->track, top->velocity, top->y)];
+          scene.drawRectangle(convertSSX(top->bucket * bucketWidth), convertSSY(top->y), cW, cH, col,
+                              64 + 191 * top->coverage);
+        }
+      }
+
+      if (cachedField) {
+        const auto addNotes = [&](double begin, double end) {
+          lod.findNotes(notes, begin, end, [&](int idx) { scene.selection.push_back(idx); });
+        };
+        // a ring reaches TILE_PAD past its note, any ball within twice that of
+        // the now line may be drawn into the band
+        const double band = displayMode == DISPLAY_BALL ? 2 * TILE_PAD / zoomLevel : 0;
+        addNotes(timeOffset - band, timeOffset + band);
+        if (hoverItem != -1) {
+          scene.selection.push_back(hoverItem);
+        }
+        std::sort(scene.selection.begin(), scene.selection.end());
+        scene.selection.erase(std::unique(scene.selection.begin(), scene.selection.end()), scene.selection.end());
+      }
+
+      const int noteTotal = cachedField ? scene.selection.size() : ctr.getNoteCount();
+      for (int n = 0; n < noteTotal; n++) {
+        const int i = cachedField ? scene.selection[n] : n;
+        auto break_line = [&]() {
+          switch (displayMode) {
+            case DISPLAY_LINE:
+            case DISPLAY_PULSE:
+            case DISPLAY_LOOP:
+              return i != 0;
+            default:
+              return false;
+          }
+        };
+        if (break_line()) {
+          break;
+        }
+
+        if (!ctr.getLiveState()) {
+          if (notes[i].x < currentBoundaries.first * 0.9 && notes[i].x > currentBoundaries.second * 1.1) {
+            continue;
+          }
+        }
+
+        bool noteOn = false;
+
+        const auto updateClickIndex = [&](int clickIndex = -1) {
+          if (!dialogHover) {
+            scene.clickOn = noteOn;
+            noteOn = !noteOn;
+            scene.clickIndex = clickIndex == -1 ? i : clickIndex;
+          }
+        };
+
+        float cX = convertSSX(notes[i].x);
+        float cY = convertSSY(notes[i].y);
+        float cW = notes[i].duration * zoomLevel < 1 ? 1 : notes[i].duration * zoomLevel;
+        float cH = (ctr.getHeight() - ctr.menuHeight) / 88.0f;
+
+        switch (displayMode) {
+          case DISPLAY_BAR: {
+            int colorID = getColorSet(i);
+            if (notes[i].isOn || (timeOffset >= notes[i].x && timeOffset < notes[i].x + notes[i].duration)) {
+              noteOn = true;
+            }
+
+            if (i == hoverItem) {
+              updateClickIndex();
+            }
+
+            const auto& cSet = noteOn ? colorSetOn : colorSetOff;
+            const auto& cSetInv = !noteOn ? colorSetOn : colorSetOff;
+            const auto& col = cSet[colorID];
+            const auto& col_inv = cSetInv[colorID];
+
+            if (timeOffset >= notes[i].x && timeOffset < notes[i].x + notes[i].duration) {
+              scene.addEmitter(i, {nowLineX, cY, 0, cH, col, col_inv});
+            }
+
+            if (noteOn) {
+            }
+
+            scene.drawRectangle(cX, cY, cW, cH, col);
+          } break;
+          case DISPLAY_VORONOI:
+            if (cX > -0.2 * ctr.getWidth() && cX + cW < 1.2 * ctr.getWidth()) {
+              int colorID = getColorSet(i);
+              if (notes[i].isOn || (timeOffset >= notes[i].x && timeOffset < notes[i].x + notes[i].duration)) {
+                noteOn = true;
+              }
+
+              // float radius = -1 + 2 * (32 - countl_zero(int(cW)));
+              float radius = 1 + log2(cW + 1);
+              if (i == hoverItem) {
+                updateClickIndex();
+              }
+
+              const auto& cSet = noteOn ? colorSetOn : colorSetOff;
+              const auto& cSetInv = !noteOn ? colorSetOn : colorSetOff;
+              const auto& col = cSet[colorID];
+              const auto& col_inv = cSetInv[colorID];
+
+              scene.vertex.push_back({cX / ctr.getWidth(), 1 - (cY + cH / 2) / ctr.getHeight()});
+              scene.color.push_back(col);
+
+              if (timeOffset >= notes[i].x && timeOffset < notes[i].x + notes[i].duration) {
+                scene.addEmitter(i, {cX, (cY + cH / 2) - radius / 2.0, 0, radius, col, col_inv});
+              }
+
+              scene.drawRing({cX, (cY + cH / 2)}, radius - 1, radius + 2, ctr.bgDark);
+              scene.drawRing({cX, (cY + cH / 2)}, 0, radius, col);
+            }
+            break;
+          case DISPLAY_BALL: {
+            int colorID = getColorSet(i);
+            const auto& cSet = noteOn ? colorSetOn : colorSetOff;
+            const auto& cSetInv = !noteOn ? colorSetOn : colorSetOff;
+            const auto& col = cSet[colorID];
+            const auto& col_inv = cSetInv[colorID];
+            float radius = -1 + 2 * (32 - countl_zero(static_cast<unsigned int>(cW)));
+            float maxRad = radius;
+            float ballY = cY + 2;
+            if (cX + cW + radius > 0 && cX - radius < ctr.getWidth()) {
+              if (cX < nowLineX - cW) {
+                radius *= 0.3;
+              }
+              if (notes[i].isOn || (timeOffset >= notes[i].x && timeOffset < notes[i].x + notes[i].duration)) {
+                noteOn = true;
+                radius *= (0.3f + 0.7f * (1.0f - float(timeOffset - notes[i].x) / notes[i].duration));
+              }
+              if (i == hoverItem) {
+                updateClickIndex();
+              }
+
+              if (timeOffset >= notes[i].x && timeOffset < notes[i].x + notes[i].duration) {
+                scene.addEmitter(i, {nowLineX, ballY, 0, 0, col, col_inv});
+              }
+
+              if (noteOn) {
+                if (cX >= nowLineX) {
+                  scene.drawRing({cX, ballY}, radius - 2, radius, col);
+                }
+                else if (cX + cW < nowLineX) {
+                  scene.drawRing({cX + cW, ballY}, radius - 2, radius, col);
+                }
+                else if (cX < nowLineX) {
+                  scene.drawRing({cX, ballY}, radius - 2, radius, col, 255 * radius / maxRad);
+                  scene.drawRing({static_cast<float>(nowLineX), ballY}, radius - 2, radius, col);
+                  if (nowLineX - cX > 2 * radius) {
+                    scene.drawGradientLineH({cX + radius, ballY + 1},
+                                            {static_cast<float>(nowLineX) - radius + 1, ballY + 1}, 2, col, 255,
+                                            255 * radius / maxRad);
+                  }
+                }
+              }
+              else {
+                if (cX < nowLineX && cX + cW > nowLineX) {
+                  scene.drawRing({cX, ballY}, radius - 2, radius, col_inv, 255 * radius / maxRad);
+                  scene.drawRing({static_cast<float>(nowLineX), ballY}, radius - 2, radius, col_inv);
+                  if (nowLineX - cX > 2 * radius) {
+                    scene.drawLineEx(cX + radius, ballY + 1, nowLineX - radius, ballY + 1, 2, col_inv);
+                  }
+                }
+                else if (cX < nowLineX) {
+                  scene.drawRing({cX + cW, ballY}, radius - 2, radius, col_inv);
+                }
+                else {
+                  scene.drawRing({cX, ballY}, radius - 2, radius, col_inv);
+                }
+              }
+              // drawSymbol(SYM_TREBLE, 75, cX,cY, col_inv);
+            }
+          } break;
+          case DISPLAY_LINE: {
+            const vector<lineData>& lp = stream.getLines();
+            unsigned int firstLine = ctr.getLiveState() ? 0 : stream.findFirstLine(unconvertSSX(0));
+            for (unsigned int j = firstLine; j < lp.size(); ++j) {
+              if (!ctr.getLiveState()) {
+                if (convertSSX(lp[j].x_r) < 0) {
+                  continue;
+                }
+                if (convertSSX(lp[j].x_l) > ctr.getWidth()) {
+                  break;
+                }
+              }
+              int colorID = getColorSet(lp[j].idx);
+
+              float convSS[4] = {static_cast<float>(convertSSX(lp[j].x_l)), static_cast<float>(convertSSY(lp[j].y_l)),
+                                 static_cast<float>(convertSSX(lp[j].x_r)), static_cast<float>(convertSSY(lp[j].y_r))};
+              if (lp[j].in_progress) {
+                convSS[2] = nowLineX;
+              }
+
+              noteOn = convSS[0] <= nowLineX && convSS[2] > nowLineX;
+              if (static_cast<int>(j) == hoverItem) {
+                updateClickIndex(lp[j].idx);
+              }
+
+              const auto& cSet = noteOn ? colorSetOn : colorSetOff;
+              const auto& cSetInv = !noteOn ? colorSetOn : colorSetOff;
+              const auto& col = cSet[colorID];
+              const auto& col_inv = cSetInv[colorID];
+
+              if (timeOffset >= notes[lp[j].idx].x && timeOffset < notes[lp[j].idx].x + notes[lp[j].idx].duration) {
+                scene.addEmitter(lp[j].idx, {convSS[0], convSS[1], 0, 0, col, col_inv});
+              }
+
+              if (convSS[2] - convSS[0] > 3) {
+                scene.drawLineBezier(convSS[0], convSS[1], convSS[2], convSS[3], 2, col);
+              }
+              else {
+                scene.drawLineEx(convSS[0], convSS[1], convSS[2], convSS[3], 2, col);
+              }
+            }
+          } break;
+          case DISPLAY_PULSE: {
+            const vector<lineData>& lp = stream.getLines();
+            unsigned int firstLine = ctr.getLiveState() ? 0 : stream.findFirstLine(unconvertSSX(0));
+            for (unsigned int j = firstLine; j < lp.size(); ++j) {
+              if (!ctr.getLiveState()) {
+                if (convertSSX(lp[j].x_r) < 0) {
+                  continue;
+                }
+                if (convertSSX(lp[j].x_l) > ctr.getWidth()) {
+                  break;
+                }
+              }
+              int colorID = getColorSet(lp[j].idx);
+
+              float convSS[4] = {static_cast<float>(convertSSX(lp[j].x_l)), static_cast<float>(convertSSY(lp[j].y_l)),
+                                 static_cast<float>(convertSSX(lp[j].x_r)), static_cast<float>(convertSSY(lp[j].y_r))};
+              if (lp[j].in_progress) {
+                convSS[2] = nowLineX;
+              }
+
+              noteOn = convSS[0] <= nowLineX && convSS[2] > nowLineX;
+              if (static_cast<int>(j) == hoverItem) {
+                updateClickIndex(lp[j].idx);
+              }
+
+              const auto& cSet = noteOn ? colorSetOn : colorSetOff;
+              const auto& cSetInv = !noteOn ? colorSetOn : colorSetOff;
+              const auto& col = cSet[colorID];
+              const auto& col_inv = cSetInv[colorID];
+
+              double nowRatio = (nowLineX - convSS[0]) / (convSS[2] - convSS[0]);
+              if (noteOn || scene.clickIndex == static_cast<int>(lp[j].idx)) {
+                double newY = (convSS[3] - convSS[1]) * nowRatio + convSS[1];
+                bool nowNote = scene.clickIndex == static_cast<int>(lp[j].idx) ? false : noteOn;
+                scene.drawLineEx(
+                    nowNote ? nowLineX - floatLERP(0, (nowLineX - convSS[0]) / 2.0, nowRatio, INT_SINE) : convSS[0],
+                    nowNote ? newY - floatLERP(0, (newY - convSS[1]) / 2.0, nowRatio, INT_SINE) : convSS[1],
+                    nowNote ? nowLineX - floatLERP(0, (nowLineX - convSS[2]) / 2.0, nowRatio, INT_ISINE) : convSS[2],
+                    nowNote ? newY - floatLERP(0, (newY - convSS[3]) / 2.0, nowRatio, INT_ISINE) : convSS[3], 3, col);
+                if (timeOffset >= notes[lp[j].idx].x && timeOffset < notes[lp[j].idx].x + notes[lp[j].idx].duration) {
+                  scene.addEmitter(
+                      lp[j].idx,
+                      {nowNote ? nowLineX - floatLERP(0, (nowLineX - convSS[2]) / 2.0, nowRatio, INT_ISINE) : convSS[2],
+                       nowNote ? newY - floatLERP(0, (newY - convSS[3]) / 2.0, nowRatio, INT_ISINE) : convSS[3], 0, 0,
+                       col, col_inv});
+                }
+
+                scene.drawRing(
+                    {float(nowNote ? nowLineX - floatLERP(0, (nowLineX - convSS[0]) / 2.0, nowRatio, INT_SINE)
+                                   : convSS[0]),
+                     float(nowNote ? newY - floatLERP(0, (newY - convSS[1]) / 2.0, nowRatio, INT_SINE) : convSS[1])},
+                    0, 1.5, col);
+                scene.drawRing(
+                    {float(nowNote ? nowLineX - floatLERP(0, (nowLineX - convSS[2]) / 2.0, nowRatio, INT_ISINE)
+                                   : convSS[0]),
+                     float(nowNote ? newY - floatLERP(0, (newY - convSS[3]) / 2.0, nowRatio, INT_ISINE) : convSS[1])},
+                    0, 1.5, col);
+              }
+
+              if (convSS[2] >= nowLineX) {
+                double ringFadeAlpha = noteOn ? 255 * (1 - nowRatio) : 255;
+                scene.drawRing({convSS[0], convSS[1]}, 0, 3, col, ringFadeAlpha);
+              }
+              if (convSS[2] <= nowLineX) {
+                scene.drawRing({convSS[2], convSS[3]}, 0, 3, col);
+              }
+
+              int ringLimit = 400;
+              int ringDist = timeOffset - lp[j].x_l;
+
+              double ringRatio = ringDist / static_cast<double>(ringLimit);
+              if (ctr.run && lp[j].x_l < pauseOffset && timeOffset >= pauseOffset) {
+                ringRatio = 0;
+              }
+              else if (ctr.getPauseTime() < 1 && timeOffset == pauseOffset) {  // || linePositions[j+1] >=
+                                                                               // pauseOffset) {
+                // this effect has a run-down time of 1 second
+                ringRatio += min(1 - ringRatio, ctr.getPauseTime());
+              }
+              else if (lp[j].x_l < pauseOffset && timeOffset == pauseOffset) {
+                ringRatio = 0;
+                // ringRatio *= max(ctr.getRunTime(), 1.0);
+              }
+              // logQ(timeOffset, (linePositions[j+1], linePositions[j+2]));
+              if (ringDist <= ringLimit && ringDist > 4) {
+                unsigned int noteLen =
+                    notes[lp[j].idx].duration * zoomLevel < 1 ? 1 : notes[lp[j].idx].duration * zoomLevel;
+                noteLen = noteLen ? 32 - countl_zero(noteLen) : 0;
+                double ringRad = floatLERP(6, 5 * noteLen, ringRatio, INT_ILINEAR);
+
+                if (ringRatio > 0) {
+                  scene.drawRing({convSS[0], convSS[1]}, ringRad - 3, ringRad,
+                                 colorLERP(col, col_inv, ringRatio, INT_ICIRCULAR),
+                                 floatLERP(0, 255, ringRatio, INT_ICIRCULAR));
+                }
+              }
+            }
+          } break;
+          case DISPLAY_LOOP: {
+            const vector<lineData>& lp = stream.getLines();
+            unsigned int firstLine = ctr.getLiveState() ? 0 : stream.findFirstLine(unconvertSSX(0));
+            for (unsigned int j = firstLine; j < lp.size(); ++j) {
+              if (!ctr.getLiveState()) {
+                if (convertSSX(lp[j].x_r) < 0) {
+                  continue;
+                }
+                if (convertSSX(lp[j].x_l) > ctr.getWidth()) {
+                  break;
+                }
+              }
+              int colorID = getColorSet(lp[j].idx);
+
+              float convSS[4] = {static_cast<float>(convertSSX(lp[j].x_l)), static_cast<float>(convertSSY(lp[j].y_l)),
+                                 static_cast<float>(convertSSX(lp[j].x_r)), static_cast<float>(convertSSY(lp[j].y_r))};
+              if (lp[j].in_progress) {
+                convSS[2] = nowLineX;
+              }
+
+              noteOn = convSS[0] <= nowLineX && convSS[2] > nowLineX;
+              if (static_cast<int>(j) == hoverItem) {
+                updateClickIndex(lp[j].idx);
+              }
+
+              const auto& cSet = noteOn ? colorSetOn : colorSetOff;
+              const auto& cSetInv = !noteOn ? colorSetOn : colorSetOff;
+              const auto& col = cSet[colorID];
+              const auto& col_inv = cSetInv[colorID];
+
+              double nowRatio = (nowLineX - convSS[0]) / (convSS[2] - convSS[0]);
+              double newY = (convSS[3] - convSS[1]) * nowRatio + convSS[1];
+              if (scene.clickIndex == static_cast<int>(lp[j].idx) || convSS[2] < nowLineX) {
+                scene.drawLineEx(convSS[0], convSS[1], convSS[2], convSS[3], 2, col);
+              }
+              else if (convSS[0] < nowLineX) {
+                scene.drawLineEx(
+                    convSS[0], convSS[1],
+                    noteOn ? nowLineX - floatLERP(0, (nowLineX - convSS[2]) / 2.0, nowRatio, INT_ISINE) : convSS[2],
+                    noteOn ? newY - floatLERP(0, (newY - convSS[3]) / 2.0, nowRatio, INT_ISINE) : convSS[3], 3, col);
+              }
+
+              if (timeOffset >= notes[lp[j].idx].x && timeOffset < notes[lp[j].idx].x + notes[lp[j].idx].duration) {
+                scene.addEmitter(
+                    lp[j].idx,
+                    {noteOn ? nowLineX - floatLERP(0, (nowLineX - convSS[2]) / 2.0, nowRatio, INT_ISINE) : convSS[2],
+                     noteOn ? newY - floatLERP(0, (newY - convSS[3]) / 2.0, nowRatio, INT_ISINE) : convSS[3], 0, 0, col,
+                     col_inv});
+              }
+
+              double scale = (1.2 * (32 - countl_zero(static_cast<unsigned int>(cW)))) / 8.0;
+              scene.drawRing({convSS[0], convSS[1]}, 0, 3 * scale, col);
+              scene.drawRing({convSS[2], convSS[3]}, 0, 3 * scale, col);
+              if (convSS[2] < nowLineX) {
+                scene.drawRing({convSS[2], convSS[3]}, 4 * scale, 8 * scale, col);
+              }
+
+              if (nowRatio > 0 && nowRatio < 1) {
+                scene.drawRing({convSS[2], convSS[3]}, 4 * scale, 8 * scale, col, 255, 180.0f,
+                               (-nowRatio + 0.5f) * 360.0f);
+              }
+            }
+          } break;
+          case DISPLAY_FFT:
+            if (cX + cW > 0 && cX < ctr.getWidth()) {
+              bool drawFFT = false;
+              double fftStretchRatio = 1.78;  // TODO: make fft-selection semi-duration-invariant
+              int colorID = getColorSet(i);
+              if (notes[i].isOn || (timeOffset >= notes[i].x && timeOffset < notes[i].x + notes[i].duration)) {
+                noteOn = true;
+                drawFFT = true;
+              }
+              else if ((timeOffset >= notes[i].x + notes[i].duration &&
+                        timeOffset < notes[i].x + fftStretchRatio * notes[i].duration) ||
+                       (timeOffset < notes[i].x && timeOffset >= notes[i].x - ctr.getMinTickLen())) {
+                drawFFT = true;
+              }
+              if (i == hoverItem) {
+                updateClickIndex();
+              }
+
+              const auto& cSet = noteOn ? colorSetOn : colorSetOff;
+              const auto& cSetInv = !noteOn ? colorSetOn : colorSetOff;
+              const auto& col = cSet[colorID];
+              const auto& col_inv = cSetInv[colorID];
+
+              if (timeOffset >= notes[i].x && timeOffset < notes[i].x + notes[i].duration) {
+                scene.addEmitter(i, {nowLineX, cY, 0, cH, col, col_inv});
+              }
+
+              if (drawFFT) {
+                scene.fftNotes.push_back(i);
+              }
+
+              scene.drawRectangle(cX, cY, cW, cH, col);
+            }
+            break;
+        }
+      }
+    };
+
+    drawList& scene = ctr.scene;
+    auto sceneJob = [&, cachedField = useLOD || useTiles] { buildScene(scene, cachedField); };
+    taskGroup sceneTask;
+    sceneTask.run(sceneJob);
+
     // main render loop
+    TRACE_NEXT(stage, "frame: background");
     BeginDrawing();
     clearBackground(ctr.bgColor);
 
@@ -267,6 +892,7 @@ int main(int argc, char* argv[]) {
 
     switch (displayMode) {
       case DISPLAY_VORONOI:
+        ctr.gpuTime.begin(GPU_MEASURE_BLEND);
         ctr.beginBlendMode(CGL_ONE_MINUS_DST_COLOR, CGL_ZERO, CGL_ADD);
         ctr.beginShaderMode("SH_INVERT");
         break;
@@ -358,6 +984,7 @@ int main(int argc, char* argv[]) {
       case DISPLAY_VORONOI:
         ctr.endShaderMode();
         ctr.endBlendMode();
+        ctr.gpuTime.end(GPU_MEASURE_BLEND);
         break;
     }
 
@@ -372,453 +999,90 @@ int main(int argc, char* argv[]) {
       drawLineEx(nowLineX, nowLineY, nowLineX, ctr.getHeight(), nowLineWidth, ctr.bgNow);
     }
 
+    // note rendering
+    TRACE_NEXT(stage, "frame: notes");
+
+    if (useTiles) {
+      ctr.tiles.update({zoomLevel, ctr.getHeight(), ctr.topHeight, displayMode, colorMode, tonicOffset,
+                        static_cast<bool>(ctr.option.get(OPTION::SCALE_VELOCITY)), &colorSetOn, &colorSetOff});
+
+      const float cH = (ctr.getHeight() - ctr.menuHeight) / 88.0f;
+      const auto drawTile = [&](int layer, double begin, double end) {
+        const double pad = TILE_PAD / zoomLevel;
+        lod.findNotes(notes, begin - pad, end + pad, [&](int idx) {
+          const int colorID = getColorSet(idx);
+          const float cX = (notes[idx].x - begin) * zoomLevel;
+          const float cY = convertSSY(notes[idx].y);
+          const float cW = notes[idx].duration * zoomLevel < 1 ? 1 : notes[idx].duration * zoomLevel;
+          if (displayMode == DISPLAY_BAR) {
+            drawRectangle(cX, cY, cW, cH, colorSetOff[colorID]);
+            return;
+          }
+
+          // ball rings sit on the start of upcoming notes and shrink onto the
+          // end of passed ones
+          float radius = -1 + 2 * (32 - countl_zero(static_cast<unsigned int>(cW)));
+          if (layer == TILE_PAST) {
+            radius *= 0.3;
+            drawRing({cX + cW, cY + 2}, radius - 2, radius, colorSetOn[colorID]);
+          }
+          else {
+            drawRing({cX, cY + 2}, radius - 2, radius, colorSetOn[colorID]);
+          }
+        });
+      };
+      const int layers = displayMode == DISPLAY_BALL ? TILE_LAYER_COUNT : 1;
+      useTiles = ctr.tiles.prepare(layers, unconvertSSX(0), unconvertSSX(ctr.getWidth()), drawTile);
+    }
+
     switch (displayMode) {
       case DISPLAY_VORONOI:
         break;
       default:
         if (ctr.option.get(OPTION::SHADOW)) {
-          ctr.beginTextureMode(ctr.shadow.buffer);
+          ctr.gpuTime.begin(GPU_SHADOW_FILL);
+          ctr.beginTextureMode(ctr.shadow.getBuffer());
           clearBackground();
         }
     }
 
-    auto getColorSet = [&](int idx) {
-      switch (colorMode) {
-        case COLOR_PART:
-          return notes[idx].track;
-        case COLOR_VELOCITY:
-          if (ctr.option.get(OPTION::SCALE_VELOCITY) && !ctr.getLiveState() &&
-              stream.velocityBounds.first != stream.velocityBounds.second) {
-            int range = stream.velocityBounds.second - stream.velocityBounds.first;
-            return static_cast<int>((notes[idx].velocity - stream.velocityBounds.first) * (127.0 / range));
-          }
-          else {
-            return notes[idx].velocity;
-          }
-        case COLOR_TONIC:
-          return (notes[idx].y - MIN_NOTE_IDX + tonicOffset) % 12;
-      }
-      return 0;
-    };
-
-    pair<double, double> currentBoundaries = inverseSSX();
-    vector<int> current_note;
+    sceneTask.wait();
+    if (staticField && !useLOD && !useTiles) {
+      // the view needs more tiles than the cache holds, draw every note
+      buildScene(scene, false);
+    }
 
-    // note rendering
-    for (int i = 0; i < ctr.getNoteCount(); i++) {
-      auto break_line = [&]() {
-        switch (displayMode) {
-          case DISPLAY_LINE:
-          case DISPLAY_PULSE:
-          case DISPLAY_LOOP:
-            return i != 0;
-          default:
-            return false;
-        }
-      };
-      if (break_line()) {
-        break;
+    if (useTiles) {
+      if (displayMode == DISPLAY_BALL) {
+        // the band around the now line is left to the exact notes
+        ctr.tiles.render(TILE_UPCOMING, timeOffset, nowLineX, nowLineX + TILE_PAD, ctr.getWidth());
+        ctr.tiles.render(TILE_PAST, timeOffset, nowLineX, 0, nowLineX - TILE_PAD);
       }
-
-      if (!ctr.getLiveState()) {
-        if (notes[i].x < currentBoundaries.first * 0.9 && notes[i].x > currentBoundaries.second * 1.1) {
-          continue;
-        }
+      else {
+        ctr.tiles.render(TILE_UPCOMING, timeOffset, nowLineX, 0, ctr.getWidth());
       }
+    }
 
-      bool noteOn = false;
-
-      const auto updateClickIndex = [&](int clickIndex = -1) {
-        if (!hoverType.contains(HOVER_DIALOG)) {
-          clickOnTmp = noteOn;
-          noteOn = !noteOn;
-          clickTmp = clickIndex == -1 ? i : clickIndex;
-          hoverType.add(HOVER_NOTE);
-        }
-      };
-
-      float cX = convertSSX(notes[i].x);
-      float cY = convertSSY(notes[i].y);
-      float cW = notes[i].duration * zoomLevel < 1 ? 1 : notes[i].duration * zoomLevel;
-      float cH = (ctr.getHeight() - ctr.menuHeight) / 88.0f;
-
-      switch (displayMode) {
-        case DISPLAY_BAR: {
-          int colorID = getColorSet(i);
-          if (notes[i].isOn || (timeOffset >= notes[i].x && timeOffset < notes[i].x + notes[i].duration)) {
-            noteOn = true;
-          }
-
-          if (pointInBox(getMousePosition(), (rect){int(cX), int(cY), int(cW), int(cH)}) && !ctr.menu.mouseOnMenu()) {
-            updateClickIndex();
-          }
-
-          auto cSet = noteOn ? colorSetOn : colorSetOff;
-          auto cSetInv = !noteOn ? colorSetOn : colorSetOff;
-          const auto& col = cSet[colorID];
-          const auto& col_inv = cSetInv[colorID];
-
-          if (timeOffset >= notes[i].x && timeOffset < notes[i].x + notes[i].duration) {
-            ctr.particle.add_emitter(i, {nowLineX, cY, 0, cH, col, col_inv});
-          }
-
-          if (noteOn) {
-          }
-
-          drawRectangle(cX, cY, cW, cH, col);
-        } break;
-        case DISPLAY_VORONOI:
-          if (cX > -0.2 * ctr.getWidth() && cX + cW < 1.2 * ctr.getWidth()) {
-            int colorID = getColorSet(i);
-            if (notes[i].isOn || (timeOffset >= notes[i].x && timeOffset < notes[i].x + notes[i].duration)) {
-              noteOn = true;
-            }
-
-            // float radius = -1 + 2 * (32 - countl_zero(int(cW)));
-            float radius = 1 + log2(cW + 1);
-            if (getDistance(ctr.getMouseX(), ctr.getMouseY(), cX, cY + cH / 2) < radius + 2) {
-              updateClickIndex();
-            }
-
-            auto cSet = noteOn ? colorSetOn : colorSetOff;
-            auto cSetInv = !noteOn ? colorSetOn : colorSetOff;
-            const auto& col = cSet[colorID];
-            const auto& col_inv = cSetInv[colorID];
-
-            ctr.voronoi.vertex.push_back({cX / ctr.getWidth(), 1 - (cY + cH / 2) / ctr.getHeight()});
-            ctr.voronoi.color.push_back(col);
-
-            if (timeOffset >= notes[i].x && timeOffset < notes[i].x + notes[i].duration) {
-              ctr.particle.add_emitter(i, {cX, (cY + cH / 2) - radius / 2.0, 0, radius, col, col_inv});
-            }
-
-            drawRing({cX, (cY + cH / 2)}, radius - 1, radius + 2, ctr.bgDark);
-            drawRing({cX, (cY + cH / 2)}, 0, radius, col);
-          }
-          break;
-        case DISPLAY_BALL: {
-          int colorID = getColorSet(i);
-          auto cSet = noteOn ? colorSetOn : colorSetOff;
-          auto cSetInv = !noteOn ? colorSetOn : colorSetOff;
-          const auto& col = cSet[colorID];
-          const auto& col_inv = cSetInv[colorID];
-          float radius = -1 + 2 * (32 - countl_zero(static_cast<unsigned int>(cW)));
-          float maxRad = radius;
-          float ballY = cY + 2;
-          if (cX + cW + radius > 0 && cX - radius < ctr.getWidth()) {
-            if (cX < nowLineX - cW) {
-              radius *= 0.3;
-            }
-            if (notes[i].isOn || (timeOffset >= notes[i].x && timeOffset < notes[i].x + notes[i].duration)) {
-              noteOn = true;
-              radius *= (0.3f + 0.7f * (1.0f - float(timeOffset - notes[i].x) / notes[i].duration));
-            }
-            if (!ctr.menu.mouseOnMenu()) {
-              int realX = 0;
-              if (cX > nowLineX) {
-                realX = cX;
-              }
-              else if (cX + cW < nowLineX) {
-                realX = cX + cW;
-              }
-              else {
-                realX = nowLineX;
-              }
-              if (getDistance(ctr.getMouseX(), ctr.getMouseY(), realX, ballY) < radius) {
-                updateClickIndex();
-              }
-              else if (realX == nowLineX && (getDistance(ctr.getMouseX(), ctr.getMouseY(), cX, ballY) < radius ||
-                                             pointInBox(getMousePosition(), (rect){int(cX), int(ballY) - 2,
-                                                                                   max(int(nowLineX - cX), 0), 4}))) {
-                updateClickIndex();
-              }
-            }
-
-            if (timeOffset >= notes[i].x && timeOffset < notes[i].x + notes[i].duration) {
-              ctr.particle.add_emitter(i, {nowLineX, ballY, 0, 0, col, col_inv});
-            }
-
-            if (noteOn) {
-              if (cX >= nowLineX) {
-                drawRing({cX, ballY}, radius - 2, radius, col);
-              }
-              else if (cX + cW < nowLineX) {
-                drawRing({cX + cW, ballY}, radius - 2, radius, col);
-              }
-              else if (cX < nowLineX) {
-                drawRing({cX, ballY}, radius - 2, radius, col, 255 * radius / maxRad);
-                drawRing({static_cast<float>(nowLineX), ballY}, radius - 2, radius, col);
-                if (nowLineX - cX > 2 * radius) {
-                  drawGradientLineH({cX + radius, ballY + 1}, {static_cast<float>(nowLineX) - radius + 1, ballY + 1}, 2,
-                                    col, 255, 255 * radius / maxRad);
-                }
-              }
-            }
-            else {
-              if (cX < nowLineX && cX + cW > nowLineX) {
-                drawRing({cX, ballY}, radius - 2, radius, col_inv, 255 * radius / maxRad);
-                drawRing({static_cast<float>(nowLineX), ballY}, radius - 2, radius, col_inv);
-                if (nowLineX - cX > 2 * radius) {
-                  drawLineEx(cX + radius, ballY + 1, nowLineX - radius, ballY + 1, 2, col_inv);
-                }
-              }
-              else if (cX < nowLineX) {
-                drawRing({cX + cW, ballY}, radius - 2, radius, col_inv);
-              }
-              else {
-                drawRing({cX, ballY}, radius - 2, radius, col_inv);
-              }
-            }
-            // drawSymbol(SYM_TREBLE, 75, cX,cY, col_inv);
-          }
-        } break;
-        case DISPLAY_LINE: {
-          const vector<lineData>& lp = stream.getLines();
-          for (unsigned int j = 0; j < lp.size(); ++j) {
-            if (!ctr.getLiveState()) {
-              if (convertSSX(lp[j].x_r) < 0) {
-                continue;
-              }
-              if (convertSSX(lp[j].x_l) > ctr.getWidth()) {
-                break;
-              }
-            }
-            int colorID = getColorSet(lp[j].idx);
-
-            float convSS[4] = {static_cast<float>(convertSSX(lp[j].x_l)), static_cast<float>(convertSSY(lp[j].y_l)),
-                               static_cast<float>(convertSSX(lp[j].x_r)), static_cast<float>(convertSSY(lp[j].y_r))};
-            if (lp[j].in_progress) {
-              convSS[2] = nowLineX;
-            }
-
-            noteOn = convSS[0] <= nowLineX && convSS[2] > nowLineX;
-            if (pointInBox(getMousePosition(),
-                           pointToRect({static_cast<int>(convSS[0]), static_cast<int>(convSS[1])},
-                                       {static_cast<int>(convSS[2]), static_cast<int>(convSS[3])}))) {
-              updateClickIndex(lp[j].idx);
-            }
-
-            auto cSet = noteOn ? colorSetOn : colorSetOff;
-            auto cSetInv = !noteOn ? colorSetOn : colorSetOff;
-            const auto& col = cSet[colorID];
-            const auto& col_inv = cSetInv[colorID];
-
-            if (timeOffset >= notes[lp[j].idx].x && timeOffset < notes[lp[j].idx].x + notes[lp[j].idx].duration) {
-              ctr.particle.add_emitter(lp[j].idx, {convSS[0], convSS[1], 0, 0, col, col_inv});
-            }
-
-            if (convSS[2] - convSS[0] > 3) {
-              drawLineBezier(convSS[0], convSS[1], convSS[2], convSS[3], 2, col);
-            }
-            else {
-              drawLineEx(convSS[0], convSS[1], convSS[2], convSS[3], 2, col);
-            }
-          }
-        } break;
-        case DISPLAY_PULSE: {
-          const vector<lineData>& lp = stream.getLines();
-          for (unsigned int j = 0; j < lp.size(); ++j) {
-            if (!ctr.getLiveState()) {
-              if (convertSSX(lp[j].x_r) < 0) {
-                continue;
-              }
-              if (convertSSX(lp[j].x_l) > ctr.getWidth()) {
-                break;
-              }
-            }
-            int colorID = getColorSet(lp[j].idx);
-
-            float convSS[4] = {static_cast<float>(convertSSX(lp[j].x_l)), static_cast<float>(convertSSY(lp[j].y_l)),
-                               static_cast<float>(convertSSX(lp[j].x_r)), static_cast<float>(convertSSY(lp[j].y_r))};
-            if (lp[j].in_progress) {
-              convSS[2] = nowLineX;
-            }
-
-            noteOn = convSS[0] <= nowLineX && convSS[2] > nowLineX;
-            if (pointInBox(getMousePosition(),
-                           pointToRect({static_cast<int>(convSS[0]), static_cast<int>(convSS[1])},
-                                       {static_cast<int>(convSS[2]), static_cast<int>(convSS[3])}))) {
-              updateClickIndex(lp[j].idx);
-            }
-
-            auto cSet = noteOn ? colorSetOn : colorSetOff;
-            auto cSetInv = !noteOn ? colorSetOn : colorSetOff;
-            const auto& col = cSet[colorID];
-            const auto& col_inv = cSetInv[colorID];
-
-            double nowRatio = (nowLineX - convSS[0]) / (convSS[2] - convSS[0]);
-            if (noteOn || clickTmp == static_cast<int>(lp[j].idx)) {
-              double newY = (convSS[3] - convSS[1]) * nowRatio + convSS[1];
-              bool nowNote = clickTmp == static_cast<int>(lp[j].idx) ? false : noteOn;
-              drawLineEx(
-                  nowNote ? nowLineX - floatLERP(0, (nowLineX - convSS[0]) / 2.0, nowRatio, INT_SINE) : convSS[0],
-                  nowNote ? newY - floatLERP(0, (newY - convSS[1]) / 2.0, nowRatio, INT_SINE) : convSS[1],
-                  nowNote ? nowLineX - floatLERP(0, (nowLineX - convSS[2]) / 2.0, nowRatio, INT_ISINE) : convSS[2],
-                  nowNote ? newY - floatLERP(0, (newY - convSS[3]) / 2.0, nowRatio, INT_ISINE) : convSS[3], 3, col);
-              if (timeOffset >= notes[lp[j].idx].x && timeOffset < notes[lp[j].idx].x + notes[lp[j].idx].duration) {
-                ctr.particle.add_emitter(
-                    lp[j].idx,
-                    {nowNote ? nowLineX - floatLERP(0, (nowLineX - convSS[2]) / 2.0, nowRatio, INT_ISINE) : convSS[2],
-                     nowNote ? newY - floatLERP(0, (newY - convSS[3]) / 2.0, nowRatio, INT_ISINE) : convSS[3], 0, 0,
-                     col, col_inv});
-              }
-
-              drawRing({float(nowNote ? nowLineX - floatLERP(0, (nowLineX - convSS[0]) / 2.0, nowRatio, INT_SINE)
-                                      : convSS[0]),
-                        float(nowNote ? newY - floatLERP(0, (newY - convSS[1]) / 2.0, nowRatio, INT_SINE) : convSS[1])},
-                       0, 1.5, col);
-              drawRing(
-                  {float(nowNote ? nowLineX - floatLERP(0, (nowLineX - convSS[2]) / 2.0, nowRatio, INT_ISINE)
-                                 : convSS[0]),
-                   float(nowNote ? newY - floatLERP(0, (newY - convSS[3]) / 2.0, nowRatio, INT_ISINE) : convSS[1])},
-                  0, 1.5, col);
-            }
-
-            if (convSS[2] >= nowLineX) {
-              double ringFadeAlpha = noteOn ? 255 * (1 - nowRatio) : 255;
-              drawRing({convSS[0], convSS[1]}, 0, 3, col, ringFadeAlpha);
-            }
-            if (convSS[2] <= nowLineX) {
-              drawRing({convSS[2], convSS[3]}, 0, 3, col);
-            }
-
-            int ringLimit = 400;
-            int ringDist = timeOffset - lp[j].x_l;
-
-            double ringRatio = ringDist / static_cast<double>(ringLimit);
-            if (ctr.run && lp[j].x_l < pauseOffset && timeOffset >= pauseOffset) {
-              ringRatio = 0;
-            }
-            else if (ctr.getPauseTime() < 1 && timeOffset == pauseOffset) {  // || linePositions[j+1] >=
-                                                                             // pauseOffset) {
-              // this effect has a run-down time of 1 second
-              ringRatio += min(1 - ringRatio, ctr.getPauseTime());
-            }
-            else if (lp[j].x_l < pauseOffset && timeOffset == pauseOffset) {
-              ringRatio = 0;
-              // ringRatio *= max(ctr.getRunTime(), 1.0);
-            }
-            // logQ(timeOffset, (linePositions[j+1], linePositions[j+2]));
-            if (ringDist <= ringLimit && ringDist > 4) {
-              unsigned int noteLen =
-                  notes[lp[j].idx].duration * zoomLevel < 1 ? 1 : notes[lp[j].idx].duration * zoomLevel;
-              noteLen = noteLen ? 32 - countl_zero(noteLen) : 0;
-              double ringRad = floatLERP(6, 5 * noteLen, ringRatio, INT_ILINEAR);
-
-              if (ringRatio > 0) {
-                drawRing({convSS[0], convSS[1]}, ringRad - 3, ringRad,
-                         colorLERP(col, col_inv, ringRatio, INT_ICIRCULAR),
-                         floatLERP(0, 255, ringRatio, INT_ICIRCULAR));
-              }
-            }
-          }
-        } break;
-        case DISPLAY_LOOP: {
-          const vector<lineData>& lp = stream.getLines();
-          for (unsigned int j = 0; j < lp.size(); ++j) {
-            if (!ctr.getLiveState()) {
-              if (convertSSX(lp[j].x_r) < 0) {
-                continue;
-              }
-              if (convertSSX(lp[j].x_l) > ctr.getWidth()) {
-                break;
-              }
-            }
-            int colorID = getColorSet(lp[j].idx);
-
-            float convSS[4] = {static_cast<float>(convertSSX(lp[j].x_l)), static_cast<float>(convertSSY(lp[j].y_l)),
-                               static_cast<float>(convertSSX(lp[j].x_r)), static_cast<float>(convertSSY(lp[j].y_r))};
-            if (lp[j].in_progress) {
-              convSS[2] = nowLineX;
-            }
-
-            noteOn = convSS[0] <= nowLineX && convSS[2] > nowLineX;
-            if (pointInBox(getMousePosition(),
-                           pointToRect({static_cast<int>(convSS[0]), static_cast<int>(convSS[1])},
-                                       {static_cast<int>(convSS[2]), static_cast<int>(convSS[3])}))) {
-              updateClickIndex(lp[j].idx);
-            }
-
-            auto cSet = noteOn ? colorSetOn : colorSetOff;
-            auto cSetInv = !noteOn ? colorSetOn : colorSetOff;
-            const auto& col = cSet[colorID];
-            const auto& col_inv = cSetInv[colorID];
-
-            double nowRatio = (nowLineX - convSS[0]) / (convSS[2] - convSS[0]);
-            double newY = (convSS[3] - convSS[1]) * nowRatio + convSS[1];
-            if (clickTmp == static_cast<int>(lp[j].idx) || convSS[2] < nowLineX) {
-              drawLineEx(convSS[0], convSS[1], convSS[2], convSS[3], 2, col);
-            }
-            else if (convSS[0] < nowLineX) {
-              drawLineEx(
-                  convSS[0], convSS[1],
-                  noteOn ? nowLineX - floatLERP(0, (nowLineX - convSS[2]) / 2.0, nowRatio, INT_ISINE) : convSS[2],
-                  noteOn ? newY - floatLERP(0, (newY - convSS[3]) / 2.0, nowRatio, INT_ISINE) : convSS[3], 3, col);
-            }
-
-            if (timeOffset >= notes[lp[j].idx].x && timeOffset < notes[lp[j].idx].x + notes[lp[j].idx].duration) {
-              ctr.particle.add_emitter(
-                  lp[j].idx,
-                  {noteOn ? nowLineX - floatLERP(0, (nowLineX - convSS[2]) / 2.0, nowRatio, INT_ISINE) : convSS[2],
-                   noteOn ? newY - floatLERP(0, (newY - convSS[3]) / 2.0, nowRatio, INT_ISINE) : convSS[3], 0, 0, col,
-                   col_inv});
-            }
-
-            double scale = (1.2 * (32 - countl_zero(static_cast<unsigned int>(cW)))) / 8.0;
-            drawRing({convSS[0], convSS[1]}, 0, 3 * scale, col);
-            drawRing({convSS[2], convSS[3]}, 0, 3 * scale, col);
-            if (convSS[2] < nowLineX) {
-              drawRing({convSS[2], convSS[3]}, 4 * scale, 8 * scale, col);
-            }
-
-            if (nowRatio > 0 && nowRatio < 1) {
-              drawRing({convSS[2], convSS[3]}, 4 * scale, 8 * scale, col, 255, 180.0f, (-nowRatio + 0.5f) * 360.0f);
-            }
-          }
-        } break;
-        case DISPLAY_FFT:
-          if (cX + cW > 0 && cX < ctr.getWidth()) {
-            bool drawFFT = false;
-            double fftStretchRatio = 1.78;  // TODO: make fft-selection semi-duration-invariant
-            int colorID = getColorSet(i);
-            if (notes[i].isOn || (timeOffset >= notes[i].x && timeOffset < notes[i].x + notes[i].duration)) {
-              noteOn = true;
-              drawFFT = true;
-            }
-            else if ((timeOffset >= notes[i].x + notes[i].duration &&
-                      timeOffset < notes[i].x + fftStretchRatio * notes[i].duration) ||
-                     (timeOffset < notes[i].x && timeOffset >= notes[i].x - ctr.getMinTickLen())) {
-              drawFFT = true;
-            }
-            if (pointInBox(getMousePosition(), (rect){int(cX), int(cY), int(cW), int(cH)}) && !ctr.menu.mouseOnMenu()) {
-              updateClickIndex();
-            }
-
-            auto cSet = noteOn ? colorSetOn : colorSetOff;
-            auto cSetInv = !noteOn ? colorSetOn : colorSetOff;
-            const auto& col = cSet[colorID];
-            const auto& col_inv = cSetInv[colorID];
-
-            if (timeOffset >= notes[i].x && timeOffset < notes[i].x + notes[i].duration) {
-              ctr.particle.add_emitter(i, {nowLineX, cY, 0, cH, col, col_inv});
-            }
-
-            if (drawFFT) {
-              current_note.push_back(i);
-            }
+    scene.execute();
 
-            drawRectangle(cX, cY, cW, cH, col);
-          }
-          break;
-      }
+    for (const auto& e : scene.emitters) {
+      ctr.particle.add_emitter(e.first, e.second);
+    }
+    ctr.voronoi.vertex.swap(scene.vertex);
+    ctr.voronoi.color.swap(scene.color);
+    if (scene.clickIndex != -1) {
+      clickOnTmp = scene.clickOn;
+      clickTmp = scene.clickIndex;
+      hoverType.add(HOVER_NOTE);
     }
 
     // render FFT lines after notes
+    TRACE_NEXT(stage, "frame: fft");
     if (displayMode == DISPLAY_FFT) {
       // int pf_calls = 0;
       //  must obtain last bins before dispatching next set
-      const auto bins = ctr.fft.getFFTBins();
-      ctr.fft.generateFFTBins(current_note, timeOffset);
+      const auto& bins = ctr.fft.getFFTBins();
+      ctr.fft.generateFFTBins(scene.fftNotes, timeOffset);
 
       bool foundNote = false;
       for (unsigned int bin = 0; bin < bins.size(); ++bin) {
@@ -829,7 +1093,7 @@ int main(int argc, char* argv[]) {
 
           if (bin_len >= 1) {
             int startX = FFT_BIN_WIDTH * (bin + 1);
-            auto cSet = colorSetOn;
+            const vector<colorRGB>* cSet = &colorSetOn;
 
             // collision
             if (clickTmp == idx ||
@@ -838,7 +1102,7 @@ int main(int argc, char* argv[]) {
                             {startX - 3, static_cast<int>(ctr.getHeight() - ctr.fft.bins[bin].second - bin_len), 7,
                              static_cast<int>(bin_len)}))) {
               foundNote = true;
-              cSet = colorSetOff;
+              cSet = &colorSetOff;
               hoverType.add(HOVER_NOTE);
               clickOnTmp = true;
               clickTmp = idx;
@@ -846,7 +1110,7 @@ int main(int argc, char* argv[]) {
 
             // pf_calls++;
             drawLineEx(startX, ctr.getHeight() - ctr.fft.bins[bin].second, startX,
-                       ctr.getHeight() - ctr.fft.bins[bin].second - bin_len, 1, cSet[colorID]);
+                       ctr.getHeight() - ctr.fft.bins[bin].second - bin_len, 1, (*cSet)[colorID]);
             ctr.fft.bins[bin].second += bin_len;
           }
         }
@@ -856,6 +1120,7 @@ int main(int argc, char* argv[]) {
     }
 
     // particle handling
+    TRACE_NEXT(stage, "frame: particles");
     if (ctr.option.get(OPTION::PARTICLE)) {
       if (!ctr.run) {
         ctr.particle.end_emission();
@@ -866,33 +1131,38 @@ int main(int argc, char* argv[]) {
       ctr.particle.render();
     }
 
+    TRACE_NEXT(stage, "frame: shadow");
     switch (displayMode) {
       case DISPLAY_VORONOI:
         break;
       default:
         if (ctr.option.get(OPTION::SHADOW)) {
           ctr.endTextureMode();
+          ctr.gpuTime.end(GPU_SHADOW_FILL);
+
+          ctr.gpuTime.begin(GPU_SHADOW_COMPOSITE);
+          const Texture2D& shadow_tex = ctr.shadow.getBuffer().texture;
 
           ctr.beginShaderMode("SH_SHADOW");
           constexpr double shadow_angle = M_PI / 4.0;
           float shadow_off_x = -ctr.option.get(OPTION::SHADOW_DISTANCE) * cos(shadow_angle);
           float shadow_off_y = ctr.option.get(OPTION::SHADOW_DISTANCE) * sin(shadow_angle);
-          DrawTextureRec(ctr.shadow.buffer.texture,
-                         {0, 0, float(ctr.shadow.buffer.texture.width), float(-ctr.shadow.buffer.texture.height)},
+          DrawTextureRec(shadow_tex, {0, 0, float(shadow_tex.width), float(-shadow_tex.height)},
                          {shadow_off_x, shadow_off_y}, WHITE);
           ctr.endShaderMode();
 
-          DrawTextureRec(ctr.shadow.buffer.texture,
-                         {0, 0, float(ctr.shadow.buffer.texture.width), float(-ctr.shadow.buffer.texture.height)},
-                         {0, 0}, WHITE);
+          DrawTextureRec(shadow_tex, {0, 0, float(shadow_tex.width), float(-shadow_tex.height)}, {0, 0}, WHITE);
+          ctr.gpuTime.end(GPU_SHADOW_COMPOSITE);
         }
     }
 
     // menu bar rendering
+    TRACE_NEXT(stage, "frame: sheet");
     drawRectangle(0, 0, ctr.getWidth(), ctr.menuHeight, ctr.bgMenu);
 
     // sheet music layout
     if (sheetMusicDisplay) {
+      ctr.gpuTime.begin(GPU_SHEET);
       // bg
       drawRectangle(0, ctr.menuHeight, ctr.getWidth(), ctr.barHeight, ctr.bgSheet);
       if (pointInBox(getMousePosition(), {0, ctr.menuHeight, ctr.getWidth(), ctr.barHeight}) &&
@@ -922,7 +1192,7 @@ int main(int argc, char* argv[]) {
                  ctr.bgSheetNote);
 
       if (stream.measureMap.size() != 0) {
-        stream.sheetData.drawSheetPage();
+        ctr.sheetData.drawSheetPage();
       }
 
       if (isKeyPressed(KEY_F)) {
@@ -931,9 +1201,11 @@ int main(int argc, char* argv[]) {
       // logQ("cloc", ctr.getCurrentMeasure(timeOffset));
       // logQ("cloc",
       // formatPair(stream.sheetData.findSheetPageLimit(ctr.getCurrentMeasure(timeOffset))));
+      ctr.gpuTime.end(GPU_SHEET);
     }
 
     // option actions
+    TRACE_NEXT(stage, "frame: overlay");
 
     string songTimeContent = "";
 
@@ -965,7 +1237,7 @@ int main(int argc, char* argv[]) {
 
       drawNoteLabel(ksl, cKSOffset, songTimePosition.y, 14, 74, ctr.bgColor2);
 
-      tl_offset += measureTextEx(ctr.getKeySigLabel(timeOffset)).x;
+      tl_offset += measureTextEx(ksl).x;
     }
 
     if (showTempo && !ctr.getLiveState()) {
@@ -1001,16 +1273,34 @@ int main(int argc, char* argv[]) {
     drawTextEx(zoomText, rtOffset, 4, ctr.bgDark);
 
     if (!ctr.getLiveState() && ctr.getFilePath() != "") {
-      string fileText = ctr.getFilePath() + " |";
+      // reuses the buffer of the last frame
+      fileText.assign(ctr.getFilePath());
+      fileText += " |";
       rtOffset -= 1 + measureTextEx(fileText).x;
       drawTextEx(fileText, rtOffset, 4, ctr.bgDark);
     }
 
+    // progress of a file loading in the background
+    if (ctr.loading()) {
+      drawRectangle(0, ctr.menuHeight - 2, ctr.getWidth() * ctr.getLoadProgress(), 2, ctr.bgIcon);
+    }
+
+    ctr.gpuTime.render();
+
+    ctr.gpuTime.begin(GPU_MENU);
     ctr.menu.render();
     ctr.dialog.render();
+    ctr.gpuTime.end(GPU_MENU);
     ctr.warning.render();  // warning about windows stability
 
+    TRACE_NEXT(stage, "frame: present");
     EndDrawing();
+    TRACE_NEXT(stage, "frame: actions");
+
+    if (firstFrame) {
+      firstFrame = false;
+      debug_time(startupPhase, "startup: first frame");
+    }
 
     // key actions
     action = ctr.process(action);
@@ -1035,6 +1325,10 @@ int main(int argc, char* argv[]) {
       }
       switch (selectType) {
         case SELECT_NOTE:
+          // the selected note may have been evicted from live history since
+          if (clickNote == -1) {
+            break;
+          }
           if (clickOn) {
             ctr.setTrackOn[notes[clickNote].track] = colorSelect.getColor();
           }
@@ -1130,6 +1424,15 @@ int main(int argc, char* argv[]) {
       case ACTION::FILE_INFO:
         ctr.dialog.clear_invert_status(DIALOG::FILE);
         break;
+      case ACTION::DUMP_MEMORY:
+        ctr.logMemoryUsage();
+        break;
+      case ACTION::DUMP_TRACE:
+        traceDump(TRACE_FILE);
+        break;
+      case ACTION::TOGGLE_GPU_TIMER:
+        ctr.gpuTime.setEnabled(!ctr.gpuTime.isEnabled());
+        break;
       case ACTION::LIVEPLAY:
         if (midiMenu.isContentLabel("MIDI_MENU_ENABLE_LIVE_PLAY", MIDI_MENU_LIVE_PLAY)) {
           zoomLevel *= 3;
@@ -1707,7 +2010,9 @@ int main(int argc, char* argv[]) {
               }
               break;
             case 2:
-              tonicOffset = (notes[clickNote].y - MIN_NOTE_IDX + tonicOffset) % 12;
+              if (clickNote != -1) {
+                tonicOffset = (notes[clickNote].y - MIN_NOTE_IDX + tonicOffset) % 12;
+              }
               break;
           }
           break;
@@ -1869,6 +2174,7 @@ int main(int argc, char* argv[]) {
       hoverType.add(HOVER_MENU);
     }
 
+    TRACE_NEXT(stage, "frame: update");
     ctr.update(timeOffset, zoomLevel, nowLineX);
   }
 
@@ -1,15 +1,9 @@
 #include "measure.h"
 
 #include <algorithm>
-#include <iterator>
 
-#include "build_target.h"
 #include "data.h"
-#include "define.h"
 #include "log.h"
-#include "wrap.h"
-
-using std::make_move_iterator;
 
 void measureController::clear() {
   // NOTE: not used
@@ -20,22 +14,22 @@ void measureController::clear() {
   // currentKey = keySig();
 }
 
-void measureController::buildTickMap() {
-  // invariant of absolute value of lowest tick resolution
-  int minTick = ctr.getMinTickLen();
+void measureController::buildTickMap(int minTick) {
+  // minTick is the lowest tick resolution of the owning song, passed in so
+  // that measures can be built for a song other than the one on screen
+  if (minTick <= 0) {
+    return;
+  }
   int numPos = tickLength / minTick;
 
   // logQ(number, ":", currentTime.getTop(), currentTime.getBottom(), "#pos",
   // numPos);
 
-  vector<int> tmpPos(numPos, tick);
-  for (unsigned int i = 0; i < tmpPos.size(); ++i) {
-    tmpPos[i] += i * minTick;
+  // positions are ascending, so every hinted insert lands at the end
+  tickMap.clear();
+  for (int i = 0; i < numPos; ++i) {
+    tickMap.insert(tickMap.end(), tick + i * minTick);
   }
-
-  // logQ(formatVector(tmpPos));
-
-  tickMap = set<int>(make_move_iterator(tmpPos.begin()), make_move_iterator(tmpPos.end()));
 }
 
 void measureController::addNote(note& note) {
@@ -57,3 +51,8 @@ void measureController::addNote(note& note) {
     displayNotes.push_back({note.tick, -1, STAVE_NONE, true, true, &note});
   }
 }
+
+size_t measureController::getMemory() const {
+  return heapSize(tickMap) + heapSize(notes) + heapSize(timeSignatures) + heapSize(keySignatures) +
+         heapSize(displayNotes);
+}
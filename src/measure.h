@@ -1,47 +1,55 @@
 #pragma once
 
+#include <memory_resource>
 #include <set>
 #include <vector>
 
 #include "log.h"
+#include "mem_usage.h"
 #include "note.h"
 #include "sheetnote.h"
 #include "timekey.h"
 
 using std::set;
 using std::vector;
+using std::pmr::memory_resource;
 
 class measureController {
  public:
-  measureController() {
+  // containers draw from the owning song's arena, see midi::clear
+  measureController(memory_resource* mem = std::pmr::get_default_resource())
+      : tickMap(mem), notes(mem), timeSignatures(mem), keySignatures(mem), displayNotes(mem) {
     location = -1;
     number = -1;
     tick = -1;
     tickLength = 0;
-    tickMap = {};
-    notes = {};
-    timeSignatures = {};
-    keySignatures = {};
     currentTime = timeSig();
     currentKey = keySig();
+    localKey = keySig();
 
-    buildTickMap();
+    buildTickMap(0);
   }
-  measureController(int num, double loc, int tk, int tkl, const timeSig& cTime, const keySig& cKey) {
+  measureController(memory_resource* mem, int num, double loc, int tk, int tkl, const timeSig& cTime,
+                    const keySig& cKey, int minTick)
+      : tickMap(mem), notes(mem), timeSignatures(mem), keySignatures(mem), displayNotes(mem) {
     location = loc;
     number = num;
     tick = tk;
     tickLength = tkl;
-    tickMap = {};
-    notes = {};
-    timeSignatures = {};
-    keySignatures = {};
     currentTime = cTime;
     currentKey = cKey;
+    localKey = cKey;
 
-    buildTickMap();
+    buildTickMap(minTick);
   }
 
+  // vector growth must move rather than copy, a copy would land in the default
+  // resource instead of the arena
+  measureController(const measureController& other) = default;
+  measureController(measureController&& other) noexcept = default;
+  measureController& operator=(const measureController& other) = default;
+  measureController& operator=(measureController&& other) = default;
+
   void clear();
 
   double getLocation() const { return location; }
@@ -51,23 +59,29 @@ class measureController {
 
   void addNote(note& note);
 
+  size_t getMemory() const;
+
   // basic structural properties
-  set<int> tickMap;
+  std::pmr::set<int> tickMap;
 
   // persistent qualities to render
-  vector<note*> notes;
-  vector<timeSig> timeSignatures;
-  vector<keySig> keySignatures;
+  std::pmr::vector<note*> notes;
+  std::pmr::vector<timeSig> timeSignatures;
+  std::pmr::vector<keySig> keySignatures;
 
   // adjustments for sheet rendering
-  vector<sheetNote> displayNotes;
+  std::pmr::vector<sheetNote> displayNotes;
 
   // transient qualities not present in measure itself
   timeSig currentTime;
   keySig currentKey;
 
+  // key for labels; the detected key of the nearby measures if the file has
+  // no key signatures, else the same as currentKey
+  keySig localKey;
+
  private:
-  void buildTickMap();
+  void buildTickMap(int minTick);
 
   double location;
   int number;
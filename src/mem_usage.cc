@@ -0,0 +1,18 @@
+#include "mem_usage.h"
+
+#include <cstdio>
+
+string formatBytes(size_t bytes) {
+  constexpr const char* units[] = {"B", "KiB", "MiB", "GiB"};
+
+  double value = bytes;
+  int unit = 0;
+  while (value >= 1024 && unit < 3) {
+    value /= 1024;
+    unit++;
+  }
+
+  char buf[32];
+  snprintf(buf, sizeof(buf), unit ? "%.1f %s" : "%.0f %s", value, units[unit]);
+  return buf;
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstddef>
+#include <map>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+using std::map;
+using std::multiset;
+using std::pair;
+using std::set;
+using std::size_t;
+using std::string;
+using std::vector;
+
+// bytes held per subsystem, keyed by label string id
+using memoryReport = vector<pair<string, size_t>>;
+
+// estimates of the heap footprint of a container; tree nodes carry three
+// pointers and a color word besides the value
+constexpr size_t treeNodeOverhead = 4 * sizeof(void*);
+
+// allocator-generic so std::pmr containers are counted too
+template <class T, class A>
+size_t heapSize(const vector<T, A>& v) {
+  return v.capacity() * sizeof(T);
+}
+
+template <class T, class C, class A>
+size_t heapSize(const set<T, C, A>& s) {
+  return s.size() * (sizeof(T) + treeNodeOverhead);
+}
+
+template <class T, class C, class A>
+size_t heapSize(const multiset<T, C, A>& s) {
+  return s.size() * (sizeof(T) + treeNodeOverhead);
+}
+
+template <class K, class V, class C, class A>
+size_t heapSize(const map<K, V, C, A>& m) {
+  return m.size() * (sizeof(pair<const K, V>) + treeNodeOverhead);
+}
+
+string formatBytes(size_t bytes);
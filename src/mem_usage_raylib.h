@@ -0,0 +1,21 @@
+#pragma once
+
+#include "build_target.h"
+#include "mem_usage.h"
+
+// sizes of raylib resources, kept out of mem_usage.h so the analysis core
+// builds without raylib
+
+// GPU-side size of a texture, 0 if it was never created
+inline size_t textureSize(const Texture& t) {
+  return t.id && t.width > 0 && t.height > 0 ? GetPixelDataSize(t.width, t.height, t.format) : 0;
+}
+
+inline size_t imageSize(const Image& i) {
+  return i.data && i.width > 0 && i.height > 0 ? GetPixelDataSize(i.width, i.height, i.format) : 0;
+}
+
+// render targets own a color texture and a depth renderbuffer
+inline size_t renderTextureSize(const RenderTexture& r) {
+  return r.id ? textureSize(r.texture) + static_cast<size_t>(r.texture.width) * r.texture.height * 4 : 0;
+}
@@ -6,6 +6,7 @@
 #include <vector>
 
 #include "box.h"
+#include "color_raylib.h"
 #include "data.h"
 #include "define.h"
 #include "draw.h"
@@ -83,15 +84,6 @@ menu::menu(point XY, menuContentType contentType, int menuType, int menuX, int m
     mainSize = 8 + 1 + measureTextEx(itemNames[0]).x;
   }
   if (type == TYPE_COLOR) {
-    // load square texture
-    Image i = GenImageColor(squareDim, squareDim, WHITE);
-    squareTex = LoadTextureFromImage(i);
-    UnloadImage(i);
-
-    i = GenImageColor(COLOR_WIDTH, COLOR_HEIGHT, WHITE);
-    ringTex = LoadTextureFromImage(i);
-    UnloadImage(i);
-
     ctr.setShaderValue("SH_RING", "ring_len", circleRatio);
     ctr.setShaderValue("SH_RING", "ring_width", circleWidth);
   }
@@ -99,6 +91,22 @@ menu::menu(point XY, menuContentType contentType, int menuType, int menuX, int m
   ctr.menu.registerMenu(*this);
 }
 
+void menu::loadTextures() {
+  if (texLoaded) {
+    return;
+  }
+  texLoaded = true;
+
+  // load square texture
+  Image i = GenImageColor(squareDim, squareDim, WHITE);
+  squareTex = LoadTextureFromImage(i);
+  UnloadImage(i);
+
+  i = GenImageColor(COLOR_WIDTH, COLOR_HEIGHT, WHITE);
+  ringTex = LoadTextureFromImage(i);
+  UnloadImage(i);
+}
+
 int menu::getItemX(int idx) const {
   if (idx >= itemCount || idx < 0) {
     logW(LL_WARN, "attempted to get menu itemX at nonexistent menu index ", idx);
@@ -235,8 +243,9 @@ void menu::update(const vector<string>& itemNames) {
 }
 
 void menu::unloadData() {
-  if (type == TYPE_COLOR) {
+  if (texLoaded) {
     UnloadTexture(squareTex);
+    UnloadTexture(ringTex);
   }
 }
 
@@ -443,6 +452,8 @@ void menu::draw() {
 
       drawRectangle(x, y, COLOR_WIDTH, COLOR_HEIGHT, ctr.bgMenu);
 
+      loadTextures();
+
       ctr.beginShaderMode("SH_RING");
       drawTextureEx(ringTex, {static_cast<float>(x), static_cast<float>(y)});
       ctr.endShaderMode();
@@ -452,11 +463,11 @@ void menu::draw() {
       ctr.endShaderMode();
 
       drawRing({float(circleX - squareDim / 2.0 + pX), float(circleY - squareDim / 2.0 + pY)}, 0.0f, 5.0f,
-               ColorFromHSV(float(fmod(angle, 360.0)), 0.3f, 1.0f));
+               toColorRGB(ColorFromHSV(float(fmod(angle, 360.0)), 0.3f, 1.0f)));
 
       drawRing({float(circleX + (circleRatio - circleWidth / 2.0) * COLOR_WIDTH * cos(angle * M_PI / 180.0)),
                 float(circleY - (circleRatio - circleWidth / 2.0) * COLOR_HEIGHT * sin(angle * M_PI / 180.0))},
-               0.0f, 5.0f, ColorFromHSV(float(fmod(angle, 360.0)), 0.3f, 1.0f));
+               0.0f, 5.0f, toColorRGB(ColorFromHSV(float(fmod(angle, 360.0)), 0.3f, 1.0f)));
 
       drawRectangle(x + COLOR_WIDTH - 36, y + COLOR_HEIGHT - 36, 36, 36, getColor());
 
@@ -6,6 +6,7 @@
 #include "build_target.h"
 #include "data.h"
 #include "enum.h"
+#include "mem_usage_raylib.h"
 #include "misc.h"
 
 using std::string;
@@ -76,6 +77,8 @@ class menu {
   void update(const vector<string>& itemNames);
   void unloadData();
 
+  size_t getMemory() const { return texLoaded ? textureSize(squareTex) + textureSize(ringTex) : 0; }
+
   void addChildMenu(menu* child);
   void hideChildMenu();
   bool childOpen() const;
@@ -111,9 +114,12 @@ class menu {
   vector<menuItem> items;
   vector<menu*> childMenu;
 
-  Texture2D squareTex;
-  Texture2D ringTex;
+  // color picker textures, created the first time the picker is shown
+  Texture2D squareTex = {};
+  Texture2D ringTex = {};
+  bool texLoaded = false;
 
+  void loadTextures();
   void setRingColor();
 
   static constexpr float circleRatio = 0.425;
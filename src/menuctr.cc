@@ -47,6 +47,14 @@ void menuController::updateRenderStatus() {
   }
 }
 
+size_t menuController::getMemory() const {
+  size_t bytes = 0;
+  for (const auto& i : menuSet) {
+    bytes += i->getMemory();
+  }
+  return bytes;
+}
+
 void menuController::unloadData() {
   for (const auto& i : menuSet) {
     if (i->type == TYPE_COLOR) {
@@ -22,6 +22,8 @@ class menuController {
 
   void unloadData();
 
+  size_t getMemory() const;
+
   bool mouseOnMenu();
 
   void updateMouse();
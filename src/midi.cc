@@ -1,21 +1,21 @@
 #include "midi.h"
 
 #include <algorithm>
+#include <functional>
 #include <queue>
 #include <set>
-#include <thread>
 #include <utility>
 
 #include "data.h"
-#include "define.h"
 #include "enum.h"
-#include "misc.h"
-#include "sheetctr.h"
+#include "key_detect.h"
+#include "task.h"
 #include "track.h"
 #include "track_split.h"
 
+using std::max;
+using std::min;
 using std::priority_queue;
-using std::thread;
 
 int midi::getTempo(int offset) const {
   if (tempoMap.size() != 0 && offset == 0) {
@@ -32,41 +32,156 @@ int midi::getTempo(int offset) const {
   return 120;
 }
 
-void midi::buildLineMap() {
-  lines.clear();
+namespace {
+
+using lineRun = pair<const lineData*, const lineData*>;
 
-  auto track_comp = [](const auto& a, const auto& b) { return a.x_l >= b.x_l; };
+// heap-based k-way merge of runs sorted by x_l; ties keep run order. stops
+// early once cancel is set, the output is then incomplete
+void mergeLines(const vector<lineRun>& runs, lineData* out, const atomic<bool>* cancel = nullptr) {
+  // (x_l, run) of the head of each run, smallest on top
+  using head = pair<double, unsigned int>;
+  priority_queue<head, vector<head>, std::greater<head>> heap;
+  vector<const lineData*> pos(runs.size());
 
-  if (ctr.getLiveState()) {
-    lines.insert(lines.begin(), tracks[0].lines.begin(), tracks[0].lines.end());
-    lines.insert(lines.begin(), tracks[1].lines.begin(), tracks[1].lines.end());
-    sort(lines.begin(), lines.end(), track_comp);
+  for (unsigned int r = 0; r < runs.size(); ++r) {
+    pos[r] = runs[r].first;
+    if (pos[r] != runs[r].second) {
+      heap.push({pos[r]->x_l, r});
+    }
   }
-  else if (tracks.size() > 1) {
-    unsigned int n_line = 0;
-    for (unsigned int t = 0; t < tracks.size(); ++t) {
-      n_line += tracks[t].lines.size();
+
+  for (unsigned int count = 0; !heap.empty(); ++count) {
+    if (cancel && count % 4096 == 0 && *cancel) {
+      return;
     }
-    // logQ("there are", n_line, "lines to merge");
+    unsigned int r = heap.top().second;
+    heap.pop();
 
-    lines.reserve(n_line);
-    priority_queue<lineData, vector<lineData>, decltype(track_comp)> tt;
-    unsigned int idx = 0;
+    *out++ = *pos[r]++;
+    if (pos[r] != runs[r].second) {
+      heap.push({pos[r]->x_l, r});
+    }
+  }
+}
 
-    do {
-      for (unsigned int i = 0; i < tracks.size(); i++) {
-        if (idx < tracks[i].lines.size()) {
-          tt.push(tracks[i].lines[idx]);
-        }
+// splits the output into equal-sized segments at sampled x_l values, cuts
+// every run at the same values (merge path style) and merges the segments
+// independently
+void mergeLinesParallel(const vector<lineRun>& runs, lineData* out, unsigned int total, const atomic<bool>* cancel) {
+  const int segments = taskPool().getThreadCount();
+
+  vector<double> sample;
+  const unsigned int stride = std::max(1u, total / (64 * segments));
+  for (const auto& run : runs) {
+    for (const lineData* l = run.first; l < run.second; l += stride) {
+      sample.push_back(l->x_l);
+      if (static_cast<unsigned int>(run.second - l) <= stride) {
+        break;
       }
-      lines.push_back(tt.top());
-      tt.pop();
-      idx++;
-    } while (!tt.empty());
+    }
   }
-  else if (tracks.size() == 1) {
-    lines = tracks[0].lines;
+  sort(sample.begin(), sample.end());
+
+  // cut[s][r]: first line of run r in segment s; x_l ties all land in the
+  // later segment, so the order across segments is preserved
+  vector<vector<const lineData*>> cut(segments + 1, vector<const lineData*>(runs.size()));
+  for (unsigned int r = 0; r < runs.size(); ++r) {
+    cut[0][r] = runs[r].first;
+    cut[segments][r] = runs[r].second;
+  }
+  for (int s = 1; s < segments; ++s) {
+    double split = sample[sample.size() * s / segments];
+    for (unsigned int r = 0; r < runs.size(); ++r) {
+      cut[s][r] = std::lower_bound(runs[r].first, runs[r].second, split,
+                                   [](const lineData& l, double x) { return l.x_l < x; });
+      cut[s][r] = std::max(cut[s][r], cut[s - 1][r]);
+    }
+  }
+
+  vector<unsigned int> offset(segments + 1, 0);
+  for (int s = 0; s < segments; ++s) {
+    offset[s + 1] = offset[s];
+    for (unsigned int r = 0; r < runs.size(); ++r) {
+      offset[s + 1] += cut[s + 1][r] - cut[s][r];
+    }
   }
+
+  parallelFor(0, segments, 1, [&](int lo, int hi) {
+    vector<lineRun> part(runs.size());
+    for (int s = lo; s < hi; ++s) {
+      for (unsigned int r = 0; r < runs.size(); ++r) {
+        part[r] = {cut[s][r], cut[s + 1][r]};
+      }
+      mergeLines(part, out + offset[s], cancel);
+    }
+  });
+}
+
+}  // namespace
+
+void midi::buildLineMap(bool live, loadProgress* status) {
+  // each track's lines are already sorted by x_l, merge them into one array
+  // sorted by x_l that the renderer can binary search
+  const atomic<bool>* cancel = status ? &status->cancel : nullptr;
+  vector<lineRun> runs;
+  unsigned int total = 0;
+  for (const auto& t : tracks) {
+    if (!t.lines.empty()) {
+      runs.push_back({t.lines.data(), t.lines.data() + t.lines.size()});
+      total += t.lines.size();
+    }
+  }
+
+  lines.resize(total);
+
+  if (runs.size() == 1) {
+    std::copy(runs[0].first, runs[0].second, lines.begin());
+  }
+  else if (!live && total >= LINE_PARALLEL_MIN && taskPool().getThreadCount() > 1) {
+    mergeLinesParallel(runs, lines.data(), total, cancel);
+  }
+  else if (runs.size() > 1) {
+    mergeLines(runs, lines.data(), cancel);
+  }
+
+  maxLineWidth = 0;
+  for (const auto& l : lines) {
+    maxLineWidth = max(maxLineWidth, l.x_r - l.x_l);
+  }
+}
+
+void midi::reportMemory(memoryReport& report) const {
+  size_t lineBytes = heapSize(lines);
+  size_t chordBytes = 0;
+  for (const auto& t : tracks) {
+    lineBytes += t.getLineMemory();
+    chordBytes += t.getChordMemory();
+  }
+
+  size_t messageBytes = heapSize(message);
+  for (const auto& m : message) {
+    messageBytes += m.second.capacity();
+  }
+
+  size_t measureBytes = heapSize(measureMap);
+  for (const auto& m : measureMap) {
+    measureBytes += m.getMemory();
+  }
+
+  report.push_back({"MEM_NOTES", heapSize(notes)});
+  report.push_back({"MEM_LINES", lineBytes});
+  report.push_back({"MEM_CHORDS", chordBytes});
+  report.push_back({"MEM_MESSAGES", messageBytes});
+  report.push_back({"MEM_MEASURES", measureBytes});
+  report.push_back({"MEM_LOD", lod.getMemory()});
+}
+
+unsigned int midi::findFirstLine(double x) const {
+  // no line starting before x - maxLineWidth can reach x
+  auto it = std::lower_bound(lines.begin(), lines.end(), x - maxLineWidth,
+                             [](const lineData& l, double v) { return l.x_l < v; });
+  return it - lines.begin();
 }
 
 void midi::buildTickSet() {
@@ -83,11 +198,14 @@ void midi::buildTickSet() {
   }
 }
 
-void midi::buildMessageMap(const MidiFile& mf) {
+void midi::buildMessageMap(const MidiFile& mf, const atomic<bool>* cancel) {
   // int num_zero = 0;
   vector<pair<double, vector<unsigned char>>> message_vec;
   message_vec.reserve(mf.getEventCount(0));
   for (int i = 0; i < mf.getEventCount(0); i++) {
+    if (cancel && i % 4096 == 0 && *cancel) {
+      return;
+    }
     if (i && mf[0][i].seconds < mf[0][i - 1].seconds) {
       logW(LL_WARN, "MIDI has nonlinear events");
     }
@@ -191,36 +309,42 @@ keySig midi::eventToKeySignature(int keySigType, bool isMinor, int tick) {
   return keySig(keyType, isMinor, tick);
 }
 
-int midi::findKeySig() {
-  vector<pair<int, keySig>> match(KEYSIG_NONE - 2);
+int midi::findKeySig() const { return buildHistogram(notes).findKey(); }
+
+bool midi::findLocalKeys(loadProgress* status) {
+  // sliding window over the measures on either side: each measure's notes
+  // enter the histogram once and leave it once
+  pitchHistogram window;
+  const int measureCount = measureMap.size();
 
-  for (int ch = 0; auto& m : match) {
-    // exclude 7flat/sharp
-    int k_t = KEYSIG_C + ch;
-    if (any_of(k_t, KEYSIG_CSHARP, KEYSIG_CFLAT)) {
-      ch++;
-      k_t++;
+  auto addMeasure = [&](int m) {
+    for (const auto* n : measureMap[m].notes) {
+      window.add(n->y);
     }
+  };
 
-    m = make_pair(0, keySig(k_t, 0, 0));
-    ch++;
+  for (int m = 0; m < min(KEY_WINDOW_MEASURES, measureCount); ++m) {
+    addMeasure(m);
   }
 
-  for (auto& m : match) {
-    for (const auto& n : notes) {
-      int y_norm = n.y + 12 * 12;
-      int ks_idx = (y_norm + m.second.getIndex()) % 12;
+  for (int m = 0; m < measureCount; ++m) {
+    if (m % 256 == 0 && !poll(status, 0.85 + 0.05 * m / measureCount)) {
+      return false;
+    }
+    if (m + KEY_WINDOW_MEASURES < measureCount) {
+      addMeasure(m + KEY_WINDOW_MEASURES);
+    }
+    if (m - KEY_WINDOW_MEASURES - 1 >= 0) {
+      for (const auto* n : measureMap[m - KEY_WINDOW_MEASURES - 1].notes) {
+        window.remove(n->y);
+      }
+    }
 
-      bool on_key = any_of(ks_idx, 0, 2, 4, 5, 7, 9, 11);
-      on_key ? m.first++ : m.first--;
+    if (window.getTotal() != 0) {
+      measureMap[m].localKey = keySig(window.findKey(), 0, measureMap[m].getTick());
     }
   }
-
-  // for (const auto& m : match) { logQ(m.first, "-", m.second.getLabel()); }
-  auto max_it =
-      std::max_element(match.begin(), match.end(), [&](const auto& a, const auto& b) { return a.first < b.first; });
-  return max_it->second.getKey();
-  // return KEYSIG_C;
+  return true;
 }
 
 timeSig midi::getTimeSignature(double offset) {
@@ -262,40 +386,82 @@ void midi::clear() {
   tempoMap.clear();
   tracks.clear();
   trackHeightMap.clear();
-  measureMap.clear();
   timeSignatureMap.clear();
   keySignatureMap.clear();
 
+  // freeing into the arena is a no-op, the release hands back every block at once
+  measureMap.clear();
+  arena->release();
+
   tickSet.clear();
   itemStartSet.clear();
-
-  sheetData.reset();
+  lod.clear();
 
   velocityBounds = make_pair(127, 0);
 
   noteCount = 0;
   trackCount = 0;
+  trackSplit = false;
   tpq = 0;
 
   lastTime = 0;
   lastTick = 0;
+  maxLineWidth = 0;
+}
+
+void midi::swap(midi& other) {
+  std::swap(*this, other);
+
+  // tracks point back into the note vector of their owner
+  for (auto& t : tracks) {
+    t.setNoteVector(&notes);
+  }
+  for (auto& t : other.tracks) {
+    t.setNoteVector(&other.notes);
+  }
+}
+
+bool midi::poll(loadProgress* status, float value) {
+  if (!status) {
+    return true;
+  }
+  status->value = value;
+  return !status->cancel;
+}
+
+bool midi::step(loadProgress* status, float value, const char* phase) {
+  if (!status) {
+    return true;
+  }
+  auto now = traceClock::now();
+  status->phases.push_back({phase, std::chrono::duration<double>(now - status->mark).count()});
+  TRACE_SPAN(phase, status->mark, now);
+  status->mark = now;
+
+  return poll(status, value);
 }
 
-void midi::load(string file, stringstream& buf) {
+bool midi::load(string file, stringstream& buf, const analysisContext& context, loadProgress* status) {
   buf.str("");
   buf.clear();
   ifstream midiData(file, std::ios_base::in | std::ios_base::binary);
   buf << midiData.rdbuf();
   midiData.close();
 
-  load(buf);
+  if (!step(status, 0.05, "read")) {
+    return false;
+  }
+
+  return load(buf, context, {}, status);
 }
 
-void midi::load(stringstream& buf) {
+bool midi::load(stringstream& buf, const analysisContext& context, const vector<int>& trackHint,
+                loadProgress* status) {
+  TRACE_ZONE("midi::load");
   MidiFile midifile(buf);
   if (!midifile.status()) {
     logW(LL_WARN, "invalid MIDI file");
-    return;
+    return false;
   }
 
   clear();
@@ -315,6 +481,10 @@ void midi::load(stringstream& buf) {
 
   buildTickSet();
 
+  if (!step(status, 0.2, "parse")) {
+    return false;
+  }
+
   vector<pair<double, int>> trackInfo;
 
   for (int i = 0; i < trackCount; i++) {
@@ -332,7 +502,7 @@ void midi::load(stringstream& buf) {
 
   if (noteCount == 0) {
     logW(LL_WARN, "zero length MIDI file");
-    return;
+    return false;
   }
 
   // sort(trackInfo.begin(), trackInfo.end());
@@ -364,7 +534,11 @@ void midi::load(stringstream& buf) {
 
   tracks.erase(remove_if(tracks.begin(), tracks.end(), [&](auto& tr) { return !tr.getNoteCount(); }), tracks.end());
 
-  if (ctr.option.get(OPTION::TRACK_DIVISION_MIDI) && trackCount == 1) {
+  if (!step(status, 0.4, "notes")) {
+    return false;
+  }
+
+  if (context.trackDivision && trackCount == 1) {
     logW(LL_INFO, "MIDI track division enabled - performing division");
 
     trackCount = 2;
@@ -375,20 +549,37 @@ void midi::load(stringstream& buf) {
       t.reset();
     }
 
-    for (int idx = 0; auto& n : notes) {
-      n.track = findTrack(n, *this, false, idx);
-      // logQ(n.track);
-      // logQ(tracks.at(n.track).getNoteCount());
-      tracks.at(n.track).insert(idx);
-      idx++;
+    // track assignment saved with the file skips the splitter
+    bool useHint = trackHint.size() == notes.size();
+    trackSplit = true;
+
+    if (useHint) {
+      for (int idx = 0; auto& n : notes) {
+        n.track = std::clamp(trackHint[idx++], 0, 1);
+      }
+    }
+    else if (!splitTracks(notes, context, status)) {
+      return false;
+    }
+
+    for (int idx = 0; idx < noteCount; ++idx) {
+      // logQ(notes[idx].track);
+      tracks.at(notes[idx].track).insert(idx);
     }
   }
 
+  if (!step(status, 0.6, "split")) {
+    return false;
+  }
+
   midifile.joinTracks();
   midifile.sortTracks();
 
-  thread message_thread = thread(&midi::buildMessageMap, this, std::ref(midifile));
-  // buildMessageMap(midifile);
+  // the message map is independent of the rest of the load; the group waits
+  // on destruction, so an early return cannot leave it running
+  auto buildMessages = [&] { buildMessageMap(midifile, status ? &status->cancel : nullptr); };
+  taskGroup messageTask;
+  messageTask.run(buildMessages);
 
   for (int i = 0; i < midifile.getEventCount(0); i++) {
     if (midifile[0][i].isTempo()) {
@@ -414,29 +605,16 @@ void midi::load(stringstream& buf) {
     trackHeightMap.push_back(make_pair(i, tracks[i].getAverageY()));
   }
 
-  vector<thread> track_thread;
-  vector<int> st_track_idx;
-
-  for (unsigned int i = 0; i < tracks.size(); i++) {
-    // build track chord map (and implicitly, line map as well)
-    if (tracks[i].getNoteCount() > 1000) {
-      track_thread.emplace_back([&](trackController& f) { f.buildChordMap(); }, std::ref(tracks[i]));
-      // logQ("#, S: {", i, tracks[i].getNoteCount(), "}");
-    }
-    else {
-      // tracks[i].buildChordMap();
-      st_track_idx.push_back(i);
+  // build track chord maps (and implicitly, line maps as well), one task per
+  // track; small tracks cost little more than running them inline
+  parallelFor(0, tracks.size(), 1, [&](int lo, int hi) {
+    for (int i = lo; i < hi; ++i) {
+      tracks[i].buildChordMap();
     }
-    // logQ("THREAD ID:", track_thread[i].get_id());
-    // tracks[i].buildChordMap();
-  }
-
-  for (auto& i : st_track_idx) {
-    tracks[i].buildChordMap();
-  }
+  });
 
-  for (auto& t : track_thread) {
-    t.join();
+  if (!step(status, 0.8, "chords")) {
+    return false;
   }
 
   sort(trackHeightMap.begin(), trackHeightMap.end(),
@@ -447,7 +625,8 @@ void midi::load(stringstream& buf) {
     logW(LL_INFO, "no time signatures detected, adding default time signature");
     timeSignatureMap.push_back(make_pair(0, timeSig(4, 4, 0)));
   }
-  if (keySignatureMap.size() == 0) {
+  bool keyGuessed = keySignatureMap.size() == 0;
+  if (keyGuessed) {
     int detect_ks_t = findKeySig();
     keySig detect_ks = keySig(detect_ks_t, 0, 0);
 
@@ -466,8 +645,12 @@ void midi::load(stringstream& buf) {
   int measureNum = 1;
 
   measureMap.reserve(4 * lastTick / (cTimeSig.getQPM() * tpq));
-  measureMap.push_back(measureController(measureNum++, 0, 0, cTimeSig.getQPM() * tpq, cTimeSig, cKeySig));
+  measureMap.push_back(measureController(arena.get(), measureNum++, 0, 0, cTimeSig.getQPM() * tpq, cTimeSig, cKeySig,
+                                         getMinTickLen()));
   while (cTick < lastTick) {
+    if (measureNum % 1024 == 0 && !poll(status, 0.8)) {
+      return false;
+    }
     cTick += cTimeSig.getQPM() * tpq;
 
     if (idxK + 1 < static_cast<int>(keySignatureMap.size())) {
@@ -482,8 +665,8 @@ void midi::load(stringstream& buf) {
       }
     }
     // logQ(measureNum, "to",cKeySig.getAcc());
-    measureMap.push_back(measureController(measureNum++, midifile.getTimeInSeconds(cTick) * UNK_CST, cTick,
-                                           cTimeSig.getQPM() * tpq, cTimeSig, cKeySig));
+    measureMap.push_back(measureController(arena.get(), measureNum++, midifile.getTimeInSeconds(cTick) * UNK_CST,
+                                           cTick, cTimeSig.getQPM() * tpq, cTimeSig, cKeySig, getMinTickLen()));
   }
   measureMap.pop_back();
   measureMap.shrink_to_fit();
@@ -497,7 +680,10 @@ void midi::load(stringstream& buf) {
     // measure.clear();
   }
 
-  for (auto& note : notes) {
+  for (unsigned int n = 0; auto& note : notes) {
+    if (n++ % 4096 == 0 && !poll(status, 0.8 + 0.05 * n / notes.size())) {
+      return false;
+    }
     auto mIt = itemStartSet.lower_bound(make_pair(note.tick, 0));
     // measures have 0-based index, but 1-based for rendering
     int noteMeasure = (mIt != itemStartSet.begin() ? (--mIt)->second : 0);
@@ -530,8 +716,16 @@ void midi::load(stringstream& buf) {
     measureMap[ksMeasure].keySignatures.push_back(ks.second);
   }
 
+  if (keyGuessed && !findLocalKeys(status)) {
+    return false;
+  }
+
   // create sheet music position data
-  for (/*int z = 0;*/ auto& measure : measureMap) {
+  for (unsigned int m = 0; auto& measure : measureMap) {
+    if (m++ % 256 == 0 && !poll(status, 0.9 + 0.05 * m / measureMap.size())) {
+      return false;
+    }
+
     // logQ("measure",z+1,"at tick",measure.getTick());
     // if (measure.keySignatures.size() > 0) {
     // logQ("measure",z+1,"has INSIDE",measure.keySignatures[0].getAcc(),
@@ -547,16 +741,22 @@ void midi::load(stringstream& buf) {
       // map note position to key (only if on/off signature)
       note->findKeyPos(measure.currentKey);
     }
-    sheetData.disectMeasure(measure);
   }
 
-  sheetData.findSheetPages();
   // for (int m = 0; auto& measure : measureMap) {
   // logQ(measure.notes.size(), "notes in measure", 1+m++);
   //}
 
   // build line vertex map
-  buildLineMap();
+  buildLineMap(false, status);
+  if (!poll(status, 0.95)) {
+    return false;
+  }
+
+  // summary for zoomed-out views
+  if (!lod.build(notes, status ? &status->cancel : nullptr)) {
+    return false;
+  }
 
   // lastTime = notes[getNoteCount() - 1].x + notes[getNoteCount() -
   // 1].duration; logII(LL_CRIT, (midifile.getFileDurationInTicks()) / (tpq * 4)
@@ -564,5 +764,7 @@ void midi::load(stringstream& buf) {
 
   // logQ("total ks", keySignatureMap.size());
 
-  message_thread.join();
+  messageTask.wait();
+
+  return step(status, 1.0, "measures");
 }
@@ -1,28 +1,39 @@
 #pragma once
 
 #include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <cstdint>
 #include <functional>
+#include <memory>
+#include <memory_resource>
 #include <string>
 #include <vector>
 
 #include "../dpd/midifile/MidiFile.h"
 #include "color.h"
+#include "context.h"
+#include "data.h"
 #include "line.h"
 #include "log.h"
 #include "measure.h"
+#include "mem_usage.h"
 #include "note.h"
-#include "sheetctr.h"
+#include "note_lod.h"
 #include "timekey.h"
+#include "trace.h"
 #include "track.h"
 
 using namespace smf;
 
+using std::atomic;
 using std::ifstream;
 using std::multiset;
+using std::make_pair;
 using std::pair;
 using std::string;
 using std::stringstream;
+using std::unique_ptr;
 using std::vector;
 
 // using std::function was disastrous
@@ -34,9 +45,24 @@ struct itemStartCmp {
   bool operator()(const pair<int, int>& a, const pair<int, int>& b) const { return a.first <= b.first; }
 };
 
+// shared with the thread driving a load; progress runs from 0 to 1
+struct loadProgress {
+  atomic<float> value = 0;
+  atomic<bool> cancel = false;
+
+  // seconds spent in each load phase, timed from construction; only valid
+  // once the load has finished
+  vector<pair<string, double>> phases;
+  traceClock::time_point mark = traceClock::now();
+};
+
 class midi {
+  // song-lifetime storage for the per-measure containers; declared first so it
+  // outlives them, and held by pointer so its address survives swap()
+  unique_ptr<std::pmr::monotonic_buffer_resource> arena;
+
  public:
-  midi() {
+  midi() : arena(std::make_unique<std::pmr::monotonic_buffer_resource>(SONG_ARENA_BLOCK)) {
     notes = {};
     message = {};
     lines = {};
@@ -54,22 +80,37 @@ class midi {
     velocityBounds = make_pair(127, 0);
 
     trackCount = 0;
+    trackSplit = false;
     noteCount = 0;
     lastTime = 0;
     lastTick = 0;
+    maxLineWidth = 0;
 
     tpq = 0;
   }
 
   void clear();
-  void load(string file, stringstream& buf);
-  void load(stringstream& buf);
+  void swap(midi& other);
+  bool load(string file, stringstream& buf, const analysisContext& context, loadProgress* status = nullptr);
+  bool load(stringstream& buf, const analysisContext& context, const vector<int>& trackHint = {},
+            loadProgress* status = nullptr);
+
+  // publishes progress, false once the load is cancelled; true without status
+  static bool poll(loadProgress* status, float value);
 
   const vector<lineData>& getLines() { return lines; }
+  unsigned int findFirstLine(double x) const;
+
+  // empty for live input, which keeps growing
+  const noteLOD& getLOD() const { return lod; }
+
+  void reportMemory(memoryReport& report) const;
   int findMeasure(int offset) const;
+  int findKeySig() const;
 
   int getMinTickLen() const { return tickNoteTransform[tickNoteTransformLen - 1] * tpq; }
   int getTrackCount() const { return trackCount; }
+  bool isTrackSplit() const { return trackSplit; }
   int getNoteCount() const { return noteCount; }
   int getLastTick() const { return lastTick; }
   int getLastTime() const { return lastTime; }
@@ -83,7 +124,6 @@ class midi {
   multiset<pair<double, vector<unsigned char>>> message;
 
   vector<lineData> lines;
-  sheetController sheetData;
   vector<measureController> measureMap;
 
   vector<pair<int, double>> trackHeightMap;
@@ -104,6 +144,8 @@ class midi {
   set<pair<int, int>, tickCmp> tickSet;
   set<pair<int, int>, itemStartCmp> itemStartSet;
 
+  noteLOD lod;
+
   void addTimeSignature(double position, const timeSig& timeSignature);
   timeSig getTimeSignature(double offset);
 
@@ -111,17 +153,25 @@ class midi {
   void linkKeySignatures();
   keySig getKeySignature(double offset);
   keySig eventToKeySignature(int keySigType, bool isMinor, int tick);
-  int findKeySig();
 
-  void buildLineMap();
+  static bool step(loadProgress* status, float value, const char* phase);
+
+  // the load-time builders below check status (or cancel) in their loops and
+  // stop early once the load is cancelled
+  bool findLocalKeys(loadProgress* status = nullptr);
+  void buildLineMap(bool live = false, loadProgress* status = nullptr);
   void buildTickSet();
-  void buildMessageMap(const MidiFile& mf);
+  void buildMessageMap(const MidiFile& mf, const atomic<bool>* cancel = nullptr);
 
   int trackCount;
+  bool trackSplit;
   int noteCount;
 
   double lastTime;
   int lastTick;
+
+  // widest x_r - x_l in lines, bounds the search in findFirstLine()
+  double maxLineWidth;
   int tpq;
 
   static constexpr double tickNoteTransform[13] = {
@@ -8,6 +8,7 @@
 
 #include "data.h"
 #include "define.h"
+#include "deltae.h"
 #include "log.h"
 #include "wrap.h"
 
@@ -244,19 +245,22 @@ string toHex(int dec) {
 colorRGB maximizeDeltaE(const colorRGB& ref) {
   // resticted to grayscale only
   // v \in [0,255]
-  colorLAB r1(ref);
-  unsigned int maxDE = 0;
-  unsigned char optV = 0;
-  for (unsigned int v = 0; v <= 255; ++v) {
-    colorLAB r2(colorRGB(v, v, v));
-    double dE = deltaE(r1, r2);
-    if (dE > maxDE) {
-      maxDE = dE;
-      optV = v;
-      // logQ(v,":", dE);
-    }
-  }
-  // logQ(optV,":", maxDE);
+  // against a gray only the lightness difference changes along the axis, and
+  // every deltaE variant grows with it (the CIEDE2000 S_L weight changes too
+  // slowly to undo that), so the farthest gray is black or white
+  static const labSet ends = [] {
+    labSet s;
+    s.resize(2);
+    s.set(0, colorLAB(colorRGB(0, 0, 0)));
+    s.set(1, colorLAB(colorRGB(255, 255, 255)));
+    return s;
+  }();
+
+  float dE[2];
+  deltaEBatch(colorLAB(ref), ends, dE);
+
+  unsigned char optV = dE[0] >= dE[1] ? 0 : 255;
+  // logQ(optV,":", max(dE[0], dE[1]));
   return colorRGB(optV, optV, optV);
   // return ctr.bgLight;
 }
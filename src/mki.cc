@@ -0,0 +1,113 @@
+#include "mki.h"
+
+#include <algorithm>
+
+#include "build_target.h"
+#include "log.h"
+
+bool isMKIv2(const vector<char>& data) {
+  // v1 files never set bit 0 of the first byte, which 'M' does
+  return data.size() >= 8 && memcmp(data.data(), MKI_V2_MAGIC, 4) == 0;
+}
+
+bool readMKIHeader(mkiReader& in) {
+  const char* magic = in.view(4);
+  uint32_t version = 0;
+  in.read(version);
+
+  if (!in.good() || memcmp(magic, MKI_V2_MAGIC, 4) != 0) {
+    return false;
+  }
+  if (version > MKI_V2_VERSION) {
+    logW(LL_WARN, "MKI version", version, "is newer than supported version", MKI_V2_VERSION);
+  }
+  return true;
+}
+
+bool readMKIChunk(mkiReader& in, mkiChunk& chunk) {
+  if (in.remaining() == 0) {
+    return false;
+  }
+
+  const char* tag = in.view(4);
+  in.read(chunk.flags);
+  in.read(chunk.size);
+  in.read(chunk.rawSize);
+  chunk.data = in.view(chunk.size);
+  in.align(MKI_ALIGN);
+
+  if (!in.good()) {
+    logW(LL_WARN, "truncated MKI chunk");
+    return false;
+  }
+
+  chunk.tag.assign(tag, 4);
+  return true;
+}
+
+bool getChunkPayload(const mkiChunk& chunk, vector<char>& storage, const char*& data, size_t& size) {
+  if (!(chunk.flags & MKI_CHUNK_DEFLATE)) {
+    data = chunk.data;
+    size = chunk.size;
+    return true;
+  }
+
+  // written by an older build that deflated past the limit, it cannot be
+  // inflated whole
+  if (chunk.rawSize > MKI_DEFLATE_LIMIT || chunk.size > MKI_DEFLATE_LIMIT) {
+    logW(LL_WARN, "MKI chunk", chunk.tag, "is too large to decompress:", chunk.rawSize, "bytes");
+    return false;
+  }
+
+  int rawSize = 0;
+  unsigned char* raw =
+      DecompressData(reinterpret_cast<const unsigned char*>(chunk.data), static_cast<int>(chunk.size), &rawSize);
+  if (raw == nullptr || static_cast<uint64_t>(rawSize) != chunk.rawSize) {
+    logW(LL_WARN, "unable to decompress MKI chunk", chunk.tag);
+    MemFree(raw);
+    return false;
+  }
+
+  storage.assign(raw, raw + rawSize);
+  MemFree(raw);
+
+  data = storage.data();
+  size = storage.size();
+  return true;
+}
+
+void writeMKIHeader(ostream& out) {
+  uint32_t version = MKI_V2_VERSION;
+  out.write(MKI_V2_MAGIC, 4);
+  out.write(reinterpret_cast<const char*>(&version), sizeof(version));
+}
+
+void writeMKIChunk(ostream& out, const char* tag, const char* data, size_t size, bool compress) {
+  uint32_t flags = 0;
+  uint64_t rawSize = size;
+  uint64_t storedSize = size;
+
+  unsigned char* packed = nullptr;
+  if (compress && size && size <= MKI_DEFLATE_LIMIT) {
+    int packedSize = 0;
+    packed = CompressData(reinterpret_cast<const unsigned char*>(data), static_cast<int>(size), &packedSize);
+
+    // only keep the compressed form if it is actually smaller
+    if (packed != nullptr && static_cast<size_t>(packedSize) < size) {
+      flags |= MKI_CHUNK_DEFLATE;
+      data = reinterpret_cast<const char*>(packed);
+      storedSize = packedSize;
+    }
+  }
+
+  out.write(tag, 4);
+  out.write(reinterpret_cast<const char*>(&flags), sizeof(flags));
+  out.write(reinterpret_cast<const char*>(&storedSize), sizeof(storedSize));
+  out.write(reinterpret_cast<const char*>(&rawSize), sizeof(rawSize));
+  out.write(data, storedSize);
+
+  constexpr char padding[MKI_ALIGN] = {0};
+  out.write(padding, (MKI_ALIGN - storedSize % MKI_ALIGN) % MKI_ALIGN);
+
+  MemFree(packed);
+}
@@ -0,0 +1,156 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <ostream>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "color.h"
+
+using std::ostream;
+using std::string;
+using std::vector;
+
+// MKI v2 layout
+// 0x00-0x03 - magic ("MKI2")
+// 0x04-0x07 - format version
+// followed by 8-byte aligned chunks:
+//   0x00-0x03 - tag
+//   0x04-0x07 - flags (MKI_CHUNK_*)
+//   0x08-0x0F - stored payload size
+//   0x10-0x17 - payload size after decompression
+//   0x18-     - payload, zero padded to a multiple of 8
+// unknown chunks are skipped, so readers stay compatible with newer writers
+
+#define MKI_V2_MAGIC "MKI2"
+#define MKI_V2_VERSION 2
+#define MKI_ALIGN 8
+
+// raylib's DecompressData() stops at 64 MB of output, larger chunks are always
+// stored raw so that they load back whole
+#define MKI_DEFLATE_LIMIT (64 << 20)
+
+enum mkiChunkFlag { MKI_CHUNK_DEFLATE = 1 << 0 };
+
+// settings stored alongside the song data
+struct mkiSettings {
+  bool nowLine = false;
+  bool showFPS = false;
+  bool showImage = false;
+  bool sheetMusicDisplay = false;
+  bool measureLine = false;
+  bool measureNumber = false;
+
+  int colorMode = 0;
+  int displayMode = 0;
+  int songTimeType = 0;
+  int tonicOffset = 0;
+
+  double zoomLevel = 0;
+};
+
+// color sets stored alongside the song data
+struct mkiColors {
+  vector<colorRGB> tonicOn;
+  vector<colorRGB> tonicOff;
+  vector<colorRGB> velocityOn;
+  vector<colorRGB> velocityOff;
+  vector<colorRGB> trackOn;
+  vector<colorRGB> trackOff;
+  colorRGB background;
+};
+
+// placement of an embedded background image
+struct mkiImageInfo {
+  int16_t x = 0;
+  int16_t y = 0;
+  float scale = 0;
+  float defaultScale = 0;
+  float meanV = 0;
+  int32_t numColors = 0;
+  int32_t format = 0;
+};
+
+// bounds-checked cursor over an in-memory file; values are copied out with
+// memcpy, so unaligned fields are safe to read
+class mkiReader {
+ public:
+  mkiReader(const char* data, size_t size) : data(data), size(size), pos(0), valid(true) {}
+
+  template <class T>
+  bool read(T& value) {
+    static_assert(std::is_trivially_copyable<T>::value, "mkiReader can only read trivially copyable types");
+    if (!has(sizeof(T))) {
+      return false;
+    }
+    memcpy(&value, data + pos, sizeof(T));
+    pos += sizeof(T);
+    return true;
+  }
+
+  // returns a pointer into the buffer and advances past n bytes
+  const char* view(size_t n) {
+    if (!has(n)) {
+      return nullptr;
+    }
+    const char* ptr = data + pos;
+    pos += n;
+    return ptr;
+  }
+
+  bool skip(size_t n) { return view(n) != nullptr || n == 0; }
+  void align(size_t a) { skip(std::min((a - pos % a) % a, size - pos)); }
+
+  bool good() const { return valid; }
+  size_t remaining() const { return size - pos; }
+
+ private:
+  bool has(size_t n) {
+    if (n > size - pos) {
+      valid = false;
+    }
+    return valid;
+  }
+
+  const char* data;
+  size_t size;
+  size_t pos;
+  bool valid;
+};
+
+class mkiWriter {
+ public:
+  template <class T>
+  void write(const T& value) {
+    static_assert(std::is_trivially_copyable<T>::value, "mkiWriter can only write trivially copyable types");
+    write(reinterpret_cast<const char*>(&value), sizeof(T));
+  }
+  void write(const char* src, size_t n) { buf.insert(buf.end(), src, src + n); }
+
+  const vector<char>& data() const { return buf; }
+  void clear() { buf.clear(); }
+
+ private:
+  vector<char> buf;
+};
+
+struct mkiChunk {
+  string tag;
+  uint32_t flags = 0;
+  const char* data = nullptr;
+  uint64_t size = 0;
+  uint64_t rawSize = 0;
+};
+
+bool isMKIv2(const vector<char>& data);
+bool readMKIHeader(mkiReader& in);
+bool readMKIChunk(mkiReader& in, mkiChunk& chunk);
+
+// resolves the payload of a chunk, inflating into storage if compressed
+bool getChunkPayload(const mkiChunk& chunk, vector<char>& storage, const char*& data, size_t& size);
+
+void writeMKIHeader(ostream& out);
+void writeMKIChunk(ostream& out, const char* tag, const char* data, size_t size, bool compress = false);
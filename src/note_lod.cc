@@ -0,0 +1,122 @@
+#include "note_lod.h"
+
+#include <cmath>
+#include <numeric>
+#include <tuple>
+
+#include "mem_usage.h"
+#include "trace.h"
+
+using std::max;
+using std::min;
+
+namespace {
+
+// sorts by (bucket, y, track) and folds cells with the same key into one,
+// keeping the velocity of the largest part
+void combine(vector<lodCell>& cells, float scale) {
+  std::sort(cells.begin(), cells.end(), [](const lodCell& a, const lodCell& b) {
+    return std::tie(a.bucket, a.y, a.track) < std::tie(b.bucket, b.y, b.track);
+  });
+
+  size_t out = 0;
+  for (size_t i = 0, j = 0; i < cells.size(); i = j) {
+    lodCell c = cells[i];
+    float total = 0;
+    float largest = 0;
+    for (j = i; j < cells.size() && cells[j].bucket == c.bucket && cells[j].y == c.y && cells[j].track == c.track;
+         ++j) {
+      total += cells[j].coverage;
+      if (cells[j].coverage > largest) {
+        largest = cells[j].coverage;
+        c.velocity = cells[j].velocity;
+      }
+    }
+    // overlapping notes on one pitch do not cover more than the bucket
+    c.coverage = min(total * scale, 1.0f);
+    cells[out++] = c;
+  }
+  cells.resize(out);
+  cells.shrink_to_fit();
+}
+
+}  // namespace
+
+void noteLOD::clear() {
+  levels.clear();
+  order.clear();
+  maxDuration = 0;
+}
+
+bool noteLOD::build(const vector<note>& notes, const atomic<bool>* cancel) {
+  TRACE_ZONE("lod: build");
+  clear();
+  if (notes.empty()) {
+    return true;
+  }
+  auto cancelled = [&] { return cancel && *cancel; };
+
+  order.resize(notes.size());
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(order.begin(), order.end(), [&](int a, int b) { return notes[a].x < notes[b].x; });
+  for (const auto& n : notes) {
+    maxDuration = max(maxDuration, n.duration);
+  }
+
+  vector<lodCell> cells;
+  cells.reserve(notes.size());
+  for (unsigned int idx = 0; const auto& n : notes) {
+    if (idx++ % 4096 == 0 && cancelled()) {
+      clear();
+      return false;
+    }
+    const double end = n.x + max(n.duration, 0.0);
+    const int first = std::floor(n.x / LOD_BUCKET_UNITS);
+    const int last = max(first, static_cast<int>(std::ceil(end / LOD_BUCKET_UNITS)) - 1);
+    for (int b = first; b <= last; ++b) {
+      double overlap = min(end, (b + 1.0) * LOD_BUCKET_UNITS) - max(n.x, b * double(LOD_BUCKET_UNITS));
+      cells.push_back({b, static_cast<unsigned short>(n.track), static_cast<unsigned char>(n.y),
+                       static_cast<unsigned char>(n.velocity), static_cast<float>(max(overlap, 0.0) / LOD_BUCKET_UNITS)});
+    }
+  }
+  combine(cells, 1.0f);
+  levels.push_back(std::move(cells));
+
+  // each level merges bucket pairs of the one below until one bucket is left
+  while (levels.size() < LOD_MAX_LEVELS && levels.back().back().bucket > 0) {
+    if (cancelled()) {
+      clear();
+      return false;
+    }
+    vector<lodCell> next = levels.back();
+    for (auto& c : next) {
+      c.bucket >>= 1;
+    }
+    combine(next, 0.5f);
+    levels.push_back(std::move(next));
+  }
+  return true;
+}
+
+int noteLOD::findLevel(double unitsPerPixel) const {
+  int level = std::lround(std::log2(unitsPerPixel / LOD_BUCKET_UNITS));
+  return std::clamp(level, 0, getLevelCount() - 1);
+}
+
+pair<const lodCell*, const lodCell*> noteLOD::getCells(int level, double begin, double end) const {
+  const vector<lodCell>& cells = levels[level];
+  const double width = getBucketWidth(level);
+  auto bucketLess = [](const lodCell& c, double b) { return c.bucket < b; };
+
+  auto first = std::lower_bound(cells.begin(), cells.end(), std::floor(begin / width), bucketLess);
+  auto last = std::lower_bound(first, cells.end(), std::ceil(end / width), bucketLess);
+  return {cells.data() + (first - cells.begin()), cells.data() + (last - cells.begin())};
+}
+
+size_t noteLOD::getMemory() const {
+  size_t bytes = heapSize(levels) + heapSize(order);
+  for (const auto& l : levels) {
+    bytes += heapSize(l);
+  }
+  return bytes;
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <utility>
+#include <vector>
+
+#include "data.h"
+#include "note.h"
+
+using std::atomic;
+using std::pair;
+using std::vector;
+
+// one pitch of one track over one time bucket; coverage is the share of the
+// bucket the track holds the pitch down, velocity that of the longest part
+struct lodCell {
+  int bucket;
+  unsigned short track;
+  unsigned char y;
+  unsigned char velocity;
+  float coverage;
+};
+
+// multi-resolution summary of the note field for zoomed-out views. level 0
+// cuts song time into buckets of LOD_BUCKET_UNITS, every further level halves
+// the bucket count, so drawing one level at pixel scale costs at most
+// screen width * pitch range cells, whatever the note count
+class noteLOD {
+ public:
+  // false if cancel was set before the summary was complete, which is then
+  // left empty
+  bool build(const vector<note>& notes, const atomic<bool>* cancel = nullptr);
+  void clear();
+
+  bool isBuilt() const { return !levels.empty(); }
+  int getLevelCount() const { return levels.size(); }
+
+  // level whose bucket width is closest to the given span; only valid once built
+  int findLevel(double unitsPerPixel) const;
+  double getBucketWidth(int level) const { return LOD_BUCKET_UNITS * double(1 << level); }
+
+  // cells of a level sorted by (bucket, y, track), for buckets that overlap
+  // [begin, end)
+  pair<const lodCell*, const lodCell*> getCells(int level, double begin, double end) const;
+
+  // note indices overlapping [begin, end], sorted by start; for the few
+  // notes that are still drawn exactly on top of a summary
+  template <class F>
+  void findNotes(const vector<note>& notes, double begin, double end, F&& visit) const;
+
+  size_t getMemory() const;
+
+ private:
+  vector<vector<lodCell>> levels;
+
+  // note indices by start, longest duration bounds the search like
+  // midi::findFirstLine()
+  vector<int> order;
+  double maxDuration = 0;
+};
+
+template <class F>
+void noteLOD::findNotes(const vector<note>& notes, double begin, double end, F&& visit) const {
+  auto it = std::lower_bound(order.begin(), order.end(), begin - maxDuration,
+                             [&](int idx, double v) { return notes[idx].x < v; });
+  for (; it != order.end() && notes[*it].x <= end; ++it) {
+    if (notes[*it].x + notes[*it].duration >= begin) {
+      visit(*it);
+    }
+  }
+}
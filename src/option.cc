@@ -20,6 +20,8 @@ optionController::optionController() {
   opts[static_cast<int>(OPTION::SCALE_VELOCITY)] = false;
   opts[static_cast<int>(OPTION::SHADOW)] = false;
   opts[static_cast<int>(OPTION::SHADOW_DISTANCE)] = 8;
+  opts[static_cast<int>(OPTION::SET_LIVE_RETENTION)] = true;
+  opts[static_cast<int>(OPTION::LIVE_RETENTION)] = LIVE_RETENTION_SEC;
 }
 
 void optionController::invert(OPTION opt) {
@@ -50,6 +52,8 @@ void optionController::invert(OPTION opt) {
       break;
     case OPTION::SHADOW:
       break;
+    case OPTION::SET_LIVE_RETENTION:
+      break;
     default:
       logW(LL_WARN, "cannot invert option of type", static_cast<int>(opt));
       return;
@@ -88,6 +92,8 @@ void optionController::set(OPTION opt, int value) {
     case OPTION::CIE_FUNCTION:
       [[fallthrough]];
     case OPTION::SHADOW_DISTANCE:
+      [[fallthrough]];
+    case OPTION::LIVE_RETENTION:
       break;
     default:
       logW(LL_WARN, "cannot modify option of type", static_cast<int>(opt));
@@ -18,6 +18,7 @@ void midiOutput::openPort(int port) {
     return;
   }
 
+  std::lock_guard<mutex> lock(portLock);
   midiOut->closePort();
 
   midiOut->openPort(port, midiOut->getPortName(port));
@@ -39,7 +40,16 @@ vector<string> midiOutput::getPorts() {
 }
 
 void midiOutput::sendMessage(vector<unsigned char>* msgQueue) {
+  std::lock_guard<mutex> lock(portLock);
   if (curPort != -1 && midiOut->isPortOpen()) {
     midiOut->sendMessage(msgQueue);
   }
 }
+
+void midiOutput::sendMessage(const unsigned char* msg, size_t size) {
+  // allocation-free variant, called from the midi input callback thread
+  std::lock_guard<mutex> lock(portLock);
+  if (curPort != -1 && midiOut->isPortOpen()) {
+    midiOut->sendMessage(msg, size);
+  }
+}
@@ -2,6 +2,7 @@
 
 #include <algorithm>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <vector>
 
@@ -10,6 +11,7 @@
 #include "midi.h"
 #include "note.h"
 
+using std::mutex;
 using std::string;
 using std::unique_ptr;
 using std::vector;
@@ -22,6 +24,7 @@ class midiOutput {
   void openPort(int port);
   void update();
   void sendMessage(vector<unsigned char>* msgQueue);
+  void sendMessage(const unsigned char* msg, size_t size);
 
   vector<string> getPorts();
 
@@ -30,4 +33,7 @@ class midiOutput {
   vector<unsigned char> msgQueue;
   int numPort;
   int curPort;
+
+  // serializes the render, playback and midi thru threads on the port
+  mutex portLock;
 };
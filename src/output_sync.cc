@@ -3,6 +3,8 @@
 #include <algorithm>
 #include <chrono>
 
+#include "trace.h"
+
 using std::distance;
 using std::make_pair;
 
@@ -96,6 +98,7 @@ void outputInstance::terminate() {
 }
 
 void outputInstance::process() {
+  TRACE_THREAD("output");
   while (true) {
     if (end) {
       break;
@@ -119,6 +122,7 @@ void outputInstance::process() {
       int up = 0;
 
       if (index_last < index || (it != message.end() && it->first < max_offset)) {
+        TRACE_ZONE("output: send");
         // while (it != it_end) {
 
         vector<unsigned char>& msg = const_cast<vector<unsigned char>&>(it->second);
@@ -2,6 +2,7 @@
 
 #include "build_target.h"
 #include "define.h"
+#include "frame_alloc.h"
 #include "log.h"
 
 using std::make_pair;
@@ -27,8 +28,8 @@ void particleController::end_emission() {
 }
 
 void particleController::process() {
-  vector<pair<int, particleInfo>> begin_emit(current_emit.size());
-  vector<pair<int, particleInfo>> end_emit(current_emit_last.size());
+  std::pmr::vector<pair<int, particleInfo>> begin_emit(current_emit.size(), &frameMemory());
+  std::pmr::vector<pair<int, particleInfo>> end_emit(current_emit_last.size(), &frameMemory());
 
   set_difference(current_emit.begin(), current_emit.end(), current_emit_last.begin(), current_emit_last.end(),
                  begin_emit.begin(), set_comp());
@@ -79,3 +80,11 @@ void particleController::render() {
   }
   // ctr.endBlendMode();
 }
+
+size_t particleController::getMemory() const {
+  size_t bytes = heapSize(current_emit) + heapSize(current_emit_last) + heapSize(emitter_idx) + heapSize(emitter_map);
+  for (const auto& e : emitter_map) {
+    bytes += e.second.getMemory();
+  }
+  return bytes;
+}
@@ -21,7 +21,11 @@ class particleController {
   void process();
   void render();
 
+  size_t getMemory() const;
+
  private:
+  // both survive into the next update(), so they keep their own capacity
+  // rather than using the frame arena
   vector<pair<int, particleInfo>> current_emit;
   vector<pair<int, particleInfo>> current_emit_last;
 
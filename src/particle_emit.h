@@ -2,6 +2,7 @@
 
 #include <vector>
 
+#include "mem_usage.h"
 #include "particle_info.h"
 #include "particle_inst.h"
 
@@ -15,6 +16,8 @@ class emitter {
   void update_data(const particleInfo& p_info);
   void render();
 
+  size_t getMemory() const { return heapSize(part_vec); }
+
   bool active = false;
 
  private:
@@ -0,0 +1,50 @@
+#include "reaper.h"
+
+#include <thread>
+
+#include "trace.h"
+
+using std::thread;
+using std::unique_lock;
+
+jobReaper::jobReaper() { thread(&jobReaper::reaperLoop, this).detach(); }
+
+void jobReaper::push(const retiree& r) {
+  {
+    unique_lock<mutex> lk(lock);
+    queue.push_back(r);
+  }
+  wake.notify_one();
+}
+
+void jobReaper::drain() {
+  unique_lock<mutex> lk(lock);
+  idle.wait(lk, [this] { return queue.empty() && !busy; });
+}
+
+void jobReaper::reaperLoop() {
+  TRACE_THREAD("reaper");
+  vector<retiree> batch;
+  unique_lock<mutex> lk(lock);
+  while (true) {
+    wake.wait(lk, [this] { return !queue.empty(); });
+    batch.swap(queue);
+    busy = true;
+
+    lk.unlock();
+    for (const auto& r : batch) {
+      r.destroy(r.ptr);
+    }
+    batch.clear();
+    lk.lock();
+
+    busy = false;
+    idle.notify_all();
+  }
+}
+
+jobReaper& reaper() {
+  // never destroyed, jobs retired while statics are torn down still get joined
+  static jobReaper* r = new jobReaper();
+  return *r;
+}
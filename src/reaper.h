@@ -0,0 +1,50 @@
+#pragma once
+
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+using std::condition_variable;
+using std::mutex;
+using std::unique_ptr;
+using std::vector;
+
+// destroys objects on a background thread. loader jobs cancel and join their
+// worker on destruction, so the render thread hands them here instead of
+// waiting for a decode or parse to wind down
+class jobReaper {
+ public:
+  jobReaper();
+
+  jobReaper(const jobReaper&) = delete;
+  jobReaper& operator=(const jobReaper&) = delete;
+
+  template <class T>
+  void retire(unique_ptr<T> p) {
+    if (p) {
+      push({p.release(), [](void* q) { delete static_cast<T*>(q); }});
+    }
+  }
+
+  // blocks until everything retired so far is destroyed; for shutdown
+  void drain();
+
+ private:
+  struct retiree {
+    void* ptr;
+    void (*destroy)(void*);
+  };
+
+  void push(const retiree& r);
+  void reaperLoop();
+
+  mutex lock;
+  condition_variable wake;
+  condition_variable idle;
+  vector<retiree> queue;
+  bool busy = false;
+};
+
+// the shared reaper, started on first use
+jobReaper& reaper();
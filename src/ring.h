@@ -0,0 +1,109 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+using std::atomic;
+using std::size_t;
+
+// fixed-capacity single producer/single consumer queue
+// push() and pop() never allocate or block; N must be a power of two
+template <class T, size_t N>
+class ringBuffer {
+  static_assert(N > 1 && (N & (N - 1)) == 0, "ring capacity must be a power of two");
+
+ public:
+  bool push(const T& item) {
+    size_t w = head.load(std::memory_order_relaxed);
+    if (w - tail.load(std::memory_order_acquire) >= N) {
+      return false;
+    }
+    data[w & (N - 1)] = item;
+    head.store(w + 1, std::memory_order_release);
+    return true;
+  }
+
+  bool pop(T& item) {
+    size_t r = tail.load(std::memory_order_relaxed);
+    if (r == head.load(std::memory_order_acquire)) {
+      return false;
+    }
+    item = data[r & (N - 1)];
+    tail.store(r + 1, std::memory_order_release);
+    return true;
+  }
+
+  // consumer side only
+  void clear() { tail.store(head.load(std::memory_order_acquire), std::memory_order_release); }
+
+  bool empty() const { return head.load(std::memory_order_acquire) == tail.load(std::memory_order_acquire); }
+
+ private:
+  // keep producer and consumer indices on separate cache lines
+  alignas(64) atomic<size_t> head = 0;
+  alignas(64) atomic<size_t> tail = 0;
+  T data[N];
+};
+
+// fixed-capacity multiple producer/single consumer queue; every slot carries a
+// sequence number telling producers and the consumer whose turn it is.
+// producers never block or allocate, push() fails once the queue is full
+template <class T, size_t N>
+class mpscRing {
+  static_assert(N > 1 && (N & (N - 1)) == 0, "ring capacity must be a power of two");
+
+ public:
+  mpscRing() {
+    for (size_t i = 0; i < N; ++i) {
+      slots[i].seq.store(i, std::memory_order_relaxed);
+    }
+  }
+
+  // fill(T&) writes the item in place once a slot is claimed
+  template <class F>
+  bool push(F&& fill) {
+    size_t pos = head.load(std::memory_order_relaxed);
+    while (true) {
+      slot& s = slots[pos & (N - 1)];
+      std::intptr_t diff =
+          static_cast<std::intptr_t>(s.seq.load(std::memory_order_acquire)) - static_cast<std::intptr_t>(pos);
+      if (diff == 0) {
+        if (head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+          fill(s.item);
+          s.seq.store(pos + 1, std::memory_order_release);
+          return true;
+        }
+      }
+      else if (diff < 0) {
+        return false;
+      }
+      else {
+        pos = head.load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+  // consumer side only; use(const T&) runs before the slot is handed back
+  template <class F>
+  bool pop(F&& use) {
+    slot& s = slots[tail & (N - 1)];
+    if (s.seq.load(std::memory_order_acquire) != tail + 1) {
+      return false;
+    }
+    use(static_cast<const T&>(s.item));
+    s.seq.store(tail + N, std::memory_order_release);
+    tail++;
+    return true;
+  }
+
+ private:
+  struct slot {
+    atomic<size_t> seq;
+    T item;
+  };
+
+  alignas(64) atomic<size_t> head = 0;
+  alignas(64) size_t tail = 0;
+  slot slots[N];
+};
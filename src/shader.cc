@@ -1,48 +1,311 @@
 #include "shader.h"
 
 #include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
 #include <type_traits>
 
+#include "data.h"
 #include "enum.h"
+#include "gl_compat.h"
+#include "file_util.h"
 #include "log.h"
 
 using std::make_pair;
+using std::ofstream;
+using std::stringstream;
 
-shaderData::shaderData(const asset& item) {
+namespace {
+
+// program binary entry points, resolved the first time a shader is compiled
+// (a GL context exists by then)
+struct programBinaryApi {
+  programBinaryApi() {
+    getString = reinterpret_cast<cglGetString>(glfwGetProcAddress("glGetString"));
+    getIntegerv = reinterpret_cast<cglGetIntegerv>(glfwGetProcAddress("glGetIntegerv"));
+    createProgram = reinterpret_cast<cglCreateProgram>(glfwGetProcAddress("glCreateProgram"));
+    deleteProgram = reinterpret_cast<cglDeleteProgram>(glfwGetProcAddress("glDeleteProgram"));
+    getProgramiv = reinterpret_cast<cglGetProgramiv>(glfwGetProcAddress("glGetProgramiv"));
+    getProgramBinary = reinterpret_cast<cglGetProgramBinary>(glfwGetProcAddress("glGetProgramBinary"));
+    programBinary = reinterpret_cast<cglProgramBinary>(glfwGetProcAddress("glProgramBinary"));
+    programParameteri = reinterpret_cast<cglProgramParameteri>(glfwGetProcAddress("glProgramParameteri"));
+    attachShader = reinterpret_cast<cglAttachShader>(glfwGetProcAddress("glAttachShader"));
+    detachShader = reinterpret_cast<cglDetachShader>(glfwGetProcAddress("glDetachShader"));
+    deleteShader = reinterpret_cast<cglDeleteShader>(glfwGetProcAddress("glDeleteShader"));
+    bindAttribLocation = reinterpret_cast<cglBindAttribLocation>(glfwGetProcAddress("glBindAttribLocation"));
+    linkProgram = reinterpret_cast<cglLinkProgram>(glfwGetProcAddress("glLinkProgram"));
+
+    if (!getString || !getIntegerv || !createProgram || !deleteProgram || !getProgramiv || !getProgramBinary ||
+        !programBinary || !programParameteri || !attachShader || !detachShader || !deleteShader ||
+        !bindAttribLocation || !linkProgram) {
+      return;
+    }
+
+    int formats = 0;
+    getIntegerv(CGL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+    if (formats <= 0) {
+      return;
+    }
+
+    // binaries are only valid for the driver that produced them
+    for (auto query : {CGL_VENDOR, CGL_RENDERER, CGL_VERSION}) {
+      const unsigned char* str = getString(query);
+      driver += str ? reinterpret_cast<const char*>(str) : "";
+      driver += '\n';
+    }
+
+    valid = true;
+  }
+
+  bool valid = false;
+  string driver;
+
+  cglGetString getString = nullptr;
+  cglGetIntegerv getIntegerv = nullptr;
+  cglCreateProgram createProgram = nullptr;
+  cglDeleteProgram deleteProgram = nullptr;
+  cglGetProgramiv getProgramiv = nullptr;
+  cglGetProgramBinary getProgramBinary = nullptr;
+  cglProgramBinary programBinary = nullptr;
+  cglProgramParameteri programParameteri = nullptr;
+  cglAttachShader attachShader = nullptr;
+  cglDetachShader detachShader = nullptr;
+  cglDeleteShader deleteShader = nullptr;
+  cglBindAttribLocation bindAttribLocation = nullptr;
+  cglLinkProgram linkProgram = nullptr;
+};
+
+const programBinaryApi& getBinaryApi() {
+  static const programBinaryApi api;
+  return api;
+}
+
+uint64_t fnv1a(const char* data, uint64_t hash = 14695981039346656037ULL) {
+  for (; *data; ++data) {
+    hash = (hash ^ static_cast<unsigned char>(*data)) * 1099511628211ULL;
+  }
+  return hash;
+}
+
+// cache entries are keyed by shader source and driver, so editing a shader or
+// updating the driver falls back to compiling from source
+string getCachePath(const string& name, const char* vs, const char* fs) {
+  const programBinaryApi& api = getBinaryApi();
+  if (!api.valid) {
+    return "";
+  }
+
+  stringstream key;
+  key << std::hex << fnv1a(fs, fnv1a(vs, fnv1a(api.driver.c_str())));
+
+  return string(GetApplicationDirectory()) + SHADER_CACHE_DIR + name + "-" + key.str() + ".bin";
+}
+
+// raylib's default attribute locations, bound before linking so programs work
+// with its batch buffers
+#ifndef RL_DEFAULT_SHADER_ATTRIB_LOCATION_POSITION
+  #define RL_DEFAULT_SHADER_ATTRIB_LOCATION_POSITION 0
+  #define RL_DEFAULT_SHADER_ATTRIB_LOCATION_TEXCOORD 1
+  #define RL_DEFAULT_SHADER_ATTRIB_LOCATION_NORMAL 2
+  #define RL_DEFAULT_SHADER_ATTRIB_LOCATION_COLOR 3
+  #define RL_DEFAULT_SHADER_ATTRIB_LOCATION_TANGENT 4
+  #define RL_DEFAULT_SHADER_ATTRIB_LOCATION_TEXCOORD2 5
+#endif
+
+// mirrors rlLoadShaderProgram(), but sets the retrievable hint before linking
+// so the driver keeps a binary to cache; raylib links without it. returns 0
+// if either stage fails, the caller then falls back to raylib for its error
+// handling
+unsigned int linkRetrievable(const char* vs, const char* fs) {
+  const programBinaryApi& api = getBinaryApi();
+  unsigned int vsId = rlCompileShader(vs, RL_VERTEX_SHADER);
+  unsigned int fsId = rlCompileShader(fs, RL_FRAGMENT_SHADER);
+
+  unsigned int id = 0;
+  if (vsId && fsId) {
+    id = api.createProgram();
+    api.attachShader(id, vsId);
+    api.attachShader(id, fsId);
+
+    api.bindAttribLocation(id, RL_DEFAULT_SHADER_ATTRIB_LOCATION_POSITION, RL_DEFAULT_SHADER_ATTRIB_NAME_POSITION);
+    api.bindAttribLocation(id, RL_DEFAULT_SHADER_ATTRIB_LOCATION_TEXCOORD, RL_DEFAULT_SHADER_ATTRIB_NAME_TEXCOORD);
+    api.bindAttribLocation(id, RL_DEFAULT_SHADER_ATTRIB_LOCATION_NORMAL, RL_DEFAULT_SHADER_ATTRIB_NAME_NORMAL);
+    api.bindAttribLocation(id, RL_DEFAULT_SHADER_ATTRIB_LOCATION_COLOR, RL_DEFAULT_SHADER_ATTRIB_NAME_COLOR);
+    api.bindAttribLocation(id, RL_DEFAULT_SHADER_ATTRIB_LOCATION_TANGENT, RL_DEFAULT_SHADER_ATTRIB_NAME_TANGENT);
+    api.bindAttribLocation(id, RL_DEFAULT_SHADER_ATTRIB_LOCATION_TEXCOORD2, RL_DEFAULT_SHADER_ATTRIB_NAME_TEXCOORD2);
+
+    api.programParameteri(id, CGL_PROGRAM_BINARY_RETRIEVABLE_HINT, 1);
+    api.linkProgram(id);
+
+    int status = 0;
+    api.getProgramiv(id, CGL_LINK_STATUS, &status);
+    api.detachShader(id, vsId);
+    api.detachShader(id, fsId);
+    if (!status) {
+      api.deleteProgram(id);
+      id = 0;
+    }
+  }
+
+  if (vsId) {
+    api.deleteShader(vsId);
+  }
+  if (fsId) {
+    api.deleteShader(fsId);
+  }
+  return id;
+}
+
+// mirrors the location setup raylib performs after linking a program
+Shader getProgramShader(unsigned int id) {
+  Shader result = {id, static_cast<int*>(MemAlloc(RL_MAX_SHADER_LOCATIONS * sizeof(int)))};
+  for (int i = 0; i < RL_MAX_SHADER_LOCATIONS; ++i) {
+    result.locs[i] = -1;
+  }
+
+  result.locs[SHADER_LOC_VERTEX_POSITION] = rlGetLocationAttrib(id, RL_DEFAULT_SHADER_ATTRIB_NAME_POSITION);
+  result.locs[SHADER_LOC_VERTEX_TEXCOORD01] = rlGetLocationAttrib(id, RL_DEFAULT_SHADER_ATTRIB_NAME_TEXCOORD);
+  result.locs[SHADER_LOC_VERTEX_TEXCOORD02] = rlGetLocationAttrib(id, RL_DEFAULT_SHADER_ATTRIB_NAME_TEXCOORD2);
+  result.locs[SHADER_LOC_VERTEX_NORMAL] = rlGetLocationAttrib(id, RL_DEFAULT_SHADER_ATTRIB_NAME_NORMAL);
+  result.locs[SHADER_LOC_VERTEX_TANGENT] = rlGetLocationAttrib(id, RL_DEFAULT_SHADER_ATTRIB_NAME_TANGENT);
+  result.locs[SHADER_LOC_VERTEX_COLOR] = rlGetLocationAttrib(id, RL_DEFAULT_SHADER_ATTRIB_NAME_COLOR);
+
+  result.locs[SHADER_LOC_MATRIX_MVP] = rlGetLocationUniform(id, RL_DEFAULT_SHADER_UNIFORM_NAME_MVP);
+  result.locs[SHADER_LOC_MATRIX_VIEW] = rlGetLocationUniform(id, RL_DEFAULT_SHADER_UNIFORM_NAME_VIEW);
+  result.locs[SHADER_LOC_MATRIX_PROJECTION] = rlGetLocationUniform(id, RL_DEFAULT_SHADER_UNIFORM_NAME_PROJECTION);
+  result.locs[SHADER_LOC_MATRIX_MODEL] = rlGetLocationUniform(id, RL_DEFAULT_SHADER_UNIFORM_NAME_MODEL);
+  result.locs[SHADER_LOC_MATRIX_NORMAL] = rlGetLocationUniform(id, RL_DEFAULT_SHADER_UNIFORM_NAME_NORMAL);
+
+  result.locs[SHADER_LOC_COLOR_DIFFUSE] = rlGetLocationUniform(id, RL_DEFAULT_SHADER_UNIFORM_NAME_COLOR);
+  result.locs[SHADER_LOC_MAP_DIFFUSE] = rlGetLocationUniform(id, RL_DEFAULT_SHADER_SAMPLER2D_NAME_TEXTURE0);
+  result.locs[SHADER_LOC_MAP_SPECULAR] = rlGetLocationUniform(id, RL_DEFAULT_SHADER_SAMPLER2D_NAME_TEXTURE1);
+  result.locs[SHADER_LOC_MAP_NORMAL] = rlGetLocationUniform(id, RL_DEFAULT_SHADER_SAMPLER2D_NAME_TEXTURE2);
+
+  return result;
+}
+
+}  // namespace
+
+shaderData::shaderData(const asset& item) : source(item) {
   if (item.assetType != ASSET::SHADER) {
     logW(LL_WARN, "attempt to load non-shader of type:", item.assetType);
     return;
   }
 
+  for (const auto& i : item.shaderUniforms) {
+    typeMap.insert(make_pair(i.name, i.type));
+  }
+
+  name = item.assetName;
+}
+
+void shaderData::load() {
+  if (isLoaded || source.assetType != ASSET::SHADER) {
+    return;
+  }
+  isLoaded = true;
+
+  const char* vsData = reinterpret_cast<const char*>(source.dataVS);
+  const char* fsData = reinterpret_cast<const char*>(source.dataFS);
+
   // strcmp != 0 -> not equal
-  bool vs = strcmp(reinterpret_cast<char*>(item.dataVS), "") != 0;
-  bool fs = strcmp(reinterpret_cast<char*>(item.dataFS), "") != 0;
+  bool vs = strcmp(vsData, "") != 0;
+  bool fs = strcmp(fsData, "") != 0;
 
-  if (vs && fs) {
-    shader = LoadShaderFromMemory(reinterpret_cast<char*>(const_cast<unsigned char*>(item.dataVS)),
-                                  reinterpret_cast<char*>(const_cast<unsigned char*>(item.dataFS)));
+  if (!vs && !fs) {
+    logW(LL_WARN, "attempt to load shader without valid shader data:", name);
+    return;
   }
-  else if (vs) {
-    shader = LoadShaderFromMemory(reinterpret_cast<char*>(const_cast<unsigned char*>(item.dataVS)), nullptr);
+
+  string cachePath = getCachePath(name, vsData, fsData);
+
+  if (!loadBinary(cachePath)) {
+    // a cache path implies the binary api resolved; programs with a default
+    // stage are left to raylib, which owns the default stage objects
+    unsigned int id = !cachePath.empty() && vs && fs ? linkRetrievable(vsData, fsData) : 0;
+    if (id) {
+      shader = getProgramShader(id);
+      saveBinary(cachePath);
+    }
+    else {
+      shader = LoadShaderFromMemory(vs ? vsData : nullptr, fs ? fsData : nullptr);
+
+      // hacky test for graceful shader compilation failure
+      if (shader.locs[5] == 3 && shader.locs[12] == 2) {
+        logW(LL_WARN, "shader", name, "(id:" + to_string(shader.id) + ")", "failed to compile");
+      }
+      else if (shader.id != rlGetShaderIdDefault()) {
+        saveBinary(cachePath);
+      }
+    }
   }
-  else if (fs) {
-    shader = LoadShaderFromMemory(nullptr, reinterpret_cast<char*>(const_cast<unsigned char*>(item.dataFS)));
+
+  for (auto& uf : pending) {
+    uf.second(*this);
   }
-  else {
-    logW(LL_WARN, "attempt to load shader without valid shader data:", item.assetName);
-    return;
+  pending.clear();
+}
+
+bool shaderData::loadBinary(const string& path) {
+  vector<char> data;
+  if (path.empty() || !readFileData(path, data) || data.size() <= sizeof(uint32_t)) {
+    return false;
   }
 
-  // hacky test for graceful shader compilation failure
-  if (shader.locs[5] == 3 && shader.locs[12] == 2) {
-    logW(LL_WARN, "shader", item.assetName, "(id:" + to_string(shader.id) + ")", "failed to compile");
+  // 0x00-0x03 - driver binary format, followed by the binary
+  uint32_t format = 0;
+  memcpy(&format, data.data(), sizeof(uint32_t));
+
+  const programBinaryApi& api = getBinaryApi();
+  unsigned int id = api.createProgram();
+  api.programBinary(id, format, data.data() + sizeof(uint32_t), data.size() - sizeof(uint32_t));
+
+  int status = 0;
+  api.getProgramiv(id, CGL_LINK_STATUS, &status);
+  if (!status) {
+    // driver rejected the binary, it is rewritten after compiling from source
+    logW(LL_INFO, "stale shader cache for", name);
+    api.deleteProgram(id);
+    return false;
   }
 
-  for (const auto& i : item.shaderUniforms) {
-    typeMap.insert(make_pair(i.name, i.type));
+  shader = getProgramShader(id);
+  return true;
+}
+
+void shaderData::saveBinary(const string& path) {
+  if (path.empty()) {
+    return;
   }
 
-  name = item.assetName;
+  // programs raylib linked lack the retrievable hint, and some drivers then
+  // report a zero length; nothing is written for those
+  const programBinaryApi& api = getBinaryApi();
+  int length = 0;
+  api.getProgramiv(shader.id, CGL_PROGRAM_BINARY_LENGTH, &length);
+  if (length <= 0) {
+    return;
+  }
+
+  vector<char> data(sizeof(uint32_t) + length);
+  uint32_t format = 0;
+  api.getProgramBinary(shader.id, length, &length, &format, data.data() + sizeof(uint32_t));
+  memcpy(data.data(), &format, sizeof(uint32_t));
+
+  std::error_code ec;
+  std::filesystem::create_directories(std::filesystem::path(path).parent_path(), ec);
+
+  ofstream output(path, std::ios::out | std::ios::trunc | std::ios::binary);
+  if (!output) {
+    logW(LL_INFO, "unable to write shader cache", path);
+    return;
+  }
+  output.write(data.data(), sizeof(uint32_t) + length);
 }
 
-void shaderData::unloadData() { UnloadShader(shader); }
+void shaderData::unloadData() {
+  if (isLoaded && shader.locs) {
+    UnloadShader(shader);
+  }
+}
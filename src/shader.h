@@ -1,15 +1,19 @@
 #pragma once
 
 #include <algorithm>
+#include <functional>
 #include <map>
+#include <memory_resource>
 #include <string>
 #include <vector>
 
 #include "asset.h"
 #include "build_target.h"
 #include "color.h"
+#include "frame_alloc.h"
 #include "uniform.h"
 
+using std::function;
 using std::is_same;
 using std::map;
 using std::min;
@@ -17,37 +21,49 @@ using std::string;
 using std::to_string;
 using std::vector;
 
+// element type of a uniform value, unwrapping arrays of any allocator
+template <class T>
+struct uniformElement {
+  using type = T;
+  static constexpr bool array = false;
+};
+template <class T, class A>
+struct uniformElement<vector<T, A>> {
+  using type = T;
+  static constexpr bool array = true;
+};
+
 class shaderData {
  public:
   shaderData(const asset& item);
 
-  Shader& getShader() { return shader; }
+  // compiled on first use
+  void load();
+  bool loaded() const { return isLoaded; }
+
+  Shader& getShader() {
+    load();
+    return shader;
+  }
 
   template <class T>
   void setShaderValue(const string& uf, const T& val, const int num = -1) {
-    // verify types
-    static_assert(is_same<T, Vector2>::value || is_same<T, Vector3>::value || is_same<T, colorRGB>::value ||
-                      is_same<T, float>::value || is_same<T, int>::value || is_same<T, vector<Vector2>>::value ||
-                      is_same<T, vector<Vector3>>::value || is_same<T, vector<colorRGB>>::value ||
-                      is_same<T, vector<float>>::value || is_same<T, vector<int>>::value,
-                  "invalid type passed to uniform");
+    // verify types; arrays may come from any allocator
+    using E = typename uniformElement<T>::type;
+    constexpr bool isVecType = uniformElement<T>::array;
 
-    constexpr int ufType = is_same<T, Vector2>::value || is_same<T, vector<Vector2>>::value   ? SHADER_UNIFORM_VEC2
-                           : is_same<T, Vector3>::value || is_same<T, vector<Vector3>>::value ? SHADER_UNIFORM_VEC3
-                                                                                              :
-                                                                                              // cast to float
-                               is_same<T, colorRGB>::value || is_same<T, vector<colorRGB>>::value ? SHADER_UNIFORM_VEC3
-                           : is_same<T, float>::value || is_same<T, vector<float>>::value         ? SHADER_UNIFORM_FLOAT
-                                                                                                  :
-                                                                                          // 255 - unused value
-                               is_same<T, int>::value || is_same<T, vector<int>>::value ? SHADER_UNIFORM_INT
-                                                                                        : 255;
+    static_assert(is_same<E, Vector2>::value || is_same<E, Vector3>::value || is_same<E, colorRGB>::value ||
+                      is_same<E, float>::value || is_same<E, int>::value,
+                  "invalid type passed to uniform");
 
-    constexpr bool isVecType = is_same<T, vector<Vector2>>::value || is_same<T, vector<Vector3>>::value ||
-                               is_same<T, vector<colorRGB>>::value || is_same<T, vector<float>>::value ||
-                               is_same<T, vector<int>>::value;
+    // colorRGB is sent as floats; 255 - unused value
+    constexpr int ufType = is_same<E, Vector2>::value                                  ? SHADER_UNIFORM_VEC2
+                           : is_same<E, Vector3>::value || is_same<E, colorRGB>::value ? SHADER_UNIFORM_VEC3
+                           : is_same<E, float>::value                                  ? SHADER_UNIFORM_FLOAT
+                           : is_same<E, int>::value                                    ? SHADER_UNIFORM_INT
+                                                                                       : 255;
 
-    constexpr bool isCRGB = is_same<T, colorRGB>::value || is_same<T, vector<colorRGB>>::value;
+    constexpr bool isCRGB = is_same<E, colorRGB>::value;
 
     auto it = typeMap.find(uf);
     if (it == typeMap.end()) {
@@ -72,10 +88,16 @@ class shaderData {
       }
     }
 
+    if (!isLoaded) {
+      // keep the latest value per uniform until the shader is compiled
+      pending[uf] = [uf, val, num](shaderData& sd) { sd.setShaderValue(uf, val, num); };
+      return;
+    }
+
     if constexpr (isCRGB) {
       if constexpr (isVecType) {
         // logQ("call to CRGB V", name, it->second, num);
-        vector<Vector3> vec_col;
+        std::pmr::vector<Vector3> vec_col(&frameMemory());
         unsigned int send_num = min(num, static_cast<int>(val.size()));
         vec_col.resize(send_num);
         for (unsigned int i = 0; i < send_num; ++i) {
@@ -104,9 +126,17 @@ class shaderData {
   void unloadData();
 
  private:
+  bool loadBinary(const string& path);
+  void saveBinary(const string& path);
+
   string name;
+  asset source;
+  bool isLoaded = false;
+
+  Shader shader = {};
 
-  Shader shader;
+  // uniforms set before the shader was compiled
+  map<string, function<void(shaderData&)>> pending;
 
   // map uniform name to input type
   map<string, int> typeMap;
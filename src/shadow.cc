@@ -2,8 +2,19 @@
 
 #include "define.h"
 
-void shadowController::init() { update(); }
+void shadowController::update() { unload(); }
 
-void shadowController::update() { buffer = LoadRenderTexture(ctr.getWidth(), ctr.getHeight() - ctr.menuHeight); }
+void shadowController::unload() {
+  if (loaded) {
+    UnloadRenderTexture(buffer);
+    loaded = false;
+  }
+}
 
-void shadowController::unload() { UnloadRenderTexture(buffer); }
+RenderTexture& shadowController::getBuffer() {
+  if (!loaded) {
+    buffer = LoadRenderTexture(ctr.getWidth(), ctr.getHeight() - ctr.menuHeight);
+    loaded = true;
+  }
+  return buffer;
+}
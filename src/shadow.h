@@ -1,14 +1,19 @@
 #pragma once
 
 #include "build_target.h"
+#include "mem_usage_raylib.h"
 
 class shadowController {
  public:
-  void init();
   void update();
   void unload();
 
-  RenderTexture buffer;
+  // created on first use and after a resize
+  RenderTexture& getBuffer();
+
+  size_t getMemory() const { return loaded ? renderTextureSize(buffer) : 0; }
 
  private:
+  RenderTexture buffer = {};
+  bool loaded = false;
 };
@@ -7,27 +7,25 @@
 #include "sheetctr.h"
 
 using std::min;
+using std::stable_sort;
 
-void sheetMeasure::buildChordMap(vector<sheetNote>& vecNote) {
-  // intermediate representation of chordmap (needs to be tick-sorted)
-  set<pair<int, vector<sheetNote*>>, chordCmp> chordSet;
-
+void sheetMeasure::buildChordMap(std::pmr::vector<sheetNote>& vecNote) {
+  // group by display tick; the stable sort keeps input order inside a chord
+  vector<sheetNote*> order;
+  order.reserve(vecNote.size());
   for (auto& n : vecNote) {
-    auto it = chordSet.find(make_pair(n.displayBegin, vector<sheetNote*>{}));
-    if (it != chordSet.end()) {
-      // add to chordSet
-      auto vec = const_cast<vector<sheetNote*>*>(&(it->second));
-      vec->push_back(&n);
-    }
-    else {
-      pair<int, vector<sheetNote*>> newPos = make_pair(n.displayBegin, vector<sheetNote*>{&n});
-      chordSet.insert(newPos);
+    order.push_back(&n);
+  }
+  stable_sort(order.begin(), order.end(),
+              [](const sheetNote* a, const sheetNote* b) { return a->displayBegin < b->displayBegin; });
+
+  chords.clear();
+  for (auto* n : order) {
+    if (chords.empty() || chords.back().first != n->displayBegin) {
+      chords.emplace_back(n->displayBegin, std::pmr::vector<sheetNote*>{});
     }
+    chords.back().second.push_back(n);
   }
-  chords =
-      vector<pair<int, vector<sheetNote*>>>(make_move_iterator(chordSet.begin()), make_move_iterator(chordSet.end()));
-  // chords = vector<pair<int,vector<sheetNote*>>>(chordSet.begin(),
-  // chordSet.end());
 
   s_chordData.resize(chords.size());
 }
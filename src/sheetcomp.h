@@ -1,6 +1,6 @@
 #pragma once
 
-#include <set>
+#include <memory_resource>
 #include <vector>
 
 #include "enum.h"
@@ -10,17 +10,12 @@
 
 using std::pair;
 using std::vector;
+using std::pmr::memory_resource;
 
 struct noteCmp {
   bool operator()(const sheetNote* a, const sheetNote* b) const { return a->oriNote->y < b->oriNote->y; }
 };
 
-struct chordCmp {
-  bool operator()(const pair<int, vector<sheetNote*>>& a, const pair<int, vector<sheetNote*>>& b) const {
-    return a.first < b.first;
-  }
-};
-
 struct flagData {
   int startY;
   int endY;
@@ -30,10 +25,24 @@ struct flagData {
 };
 
 struct sheetChordData {
-  int leftWidth;
-  int rightWidth;
+  // allocator-aware, so flags land in the same arena as the enclosing vector
+  using allocator_type = std::pmr::polymorphic_allocator<>;
+
+  sheetChordData() = default;
+  explicit sheetChordData(const allocator_type& alloc) : flags(alloc) {}
+  sheetChordData(const sheetChordData& other) = default;
+  sheetChordData(const sheetChordData& other, const allocator_type& alloc)
+      : leftWidth(other.leftWidth), rightWidth(other.rightWidth), flags(other.flags, alloc) {}
+  sheetChordData(sheetChordData&& other) = default;
+  sheetChordData(sheetChordData&& other, const allocator_type& alloc)
+      : leftWidth(other.leftWidth), rightWidth(other.rightWidth), flags(std::move(other.flags), alloc) {}
+  sheetChordData& operator=(const sheetChordData& other) = default;
+  sheetChordData& operator=(sheetChordData&& other) = default;
 
-  vector<flagData> flags;
+  int leftWidth = 0;
+  int rightWidth = 0;
+
+  std::pmr::vector<flagData> flags;
 
   int getStemPosition() const { return leftWidth; }
   int getSize() const { return leftWidth + rightWidth; }
@@ -41,19 +50,23 @@ struct sheetChordData {
 
 class sheetMeasure {
  public:
+  explicit sheetMeasure(memory_resource* mem = std::pmr::get_default_resource()) : s_chordData(mem), chords(mem) {}
+
   bool hasStem(int chordNum) const;
   int hasFlag(int chordNum) const;
   int getFlagType(const int noteType) const;
 
-  void buildChordMap(vector<sheetNote>& vecNote);
+  void buildChordMap(std::pmr::vector<sheetNote>& vecNote);
   void buildFlagMap();
 
   void setParent(measureController& m) { measure = &m; }
 
   int getSpacingCount() const;
 
-  vector<sheetChordData> s_chordData;
-  vector<pair<int, vector<sheetNote*>>> chords;
+  // chord vectors are built through the pair's uses-allocator construction,
+  // so the inner note lists share the measure's resource
+  std::pmr::vector<sheetChordData> s_chordData;
+  std::pmr::vector<pair<int, std::pmr::vector<sheetNote*>>> chords;
   measureController* measure;
 
  private:
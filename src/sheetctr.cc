@@ -4,6 +4,7 @@
 
 #include "define.h"
 #include "enum.h"
+#include "trace.h"
 #include "wrap.h"
 
 int sheetController::getGlyphWidth(int codepoint, int size) {
@@ -250,7 +251,7 @@ void sheetController::disectMeasure(measureController& measure) {
   // logQ("measure", measure.getNumber(), "has timesig",
   // measure.currentTime.getTop(), measure.currentTime.getBottom());
   //  preprocessing
-  sheetMeasure dm;
+  sheetMeasure dm(&arena);
   dm.setParent(measure);
   dm.buildChordMap(measure.displayNotes);
 
@@ -396,7 +397,7 @@ void sheetController::disectMeasure(measureController& measure) {
     // TODO: fill space with rests
   }
 
-  displayMeasure.push_back(dm);
+  displayMeasure.push_back(std::move(dm));
 }
 
 int sheetController::findMeasureWidth(int measureNum, bool includeSig) {
@@ -434,6 +435,7 @@ int sheetController::findMeasureWidth(int measureNum, bool includeSig) {
 }
 
 void sheetController::findSheetPages() {
+  TRACE_ZONE("sheet: pages");
   sheetPageSeparator.clear();
   sheetPageSeparator.push_back(0);
 
@@ -504,6 +506,7 @@ int sheetController::mapSheetY(int sheetY) {
 }
 
 void sheetController::drawSheetPage() {
+  TRACE_ZONE("sheet: draw");
   int offset = ctr.sheetSymbolWidth;
 
   pair<int, int> measureRange = findSheetPageLimit(ctr.getCurrentMeasure());
@@ -818,3 +821,17 @@ int sheetController::getSymbolType(const int noteType) {
 
   return -1;
 }
+
+size_t sheetController::getMemory() const {
+  size_t bytes = heapSize(sheetPageSeparator) + heapSize(displayMeasure);
+  for (const auto& m : displayMeasure) {
+    bytes += heapSize(m.s_chordData) + heapSize(m.chords);
+    for (const auto& c : m.s_chordData) {
+      bytes += heapSize(c.flags);
+    }
+    for (const auto& c : m.chords) {
+      bytes += heapSize(c.second);
+    }
+  }
+  return bytes;
+}
@@ -3,11 +3,14 @@
 #include <stdint.h>
 
 #include <algorithm>
+#include <memory_resource>
 #include <vector>
 
 #include "color.h"
+#include "data.h"
 #include "log.h"
 #include "measure.h"
+#include "mem_usage.h"
 #include "note.h"
 #include "sheetcomp.h"
 #include "timekey.h"
@@ -21,6 +24,7 @@ class sheetController {
   void reset() {
     sheetPageSeparator.clear();
     displayMeasure.clear();
+    arena.release();
   }
 
   int getGlyphWidth(int codepoint, int size = fSize);
@@ -34,10 +38,15 @@ class sheetController {
 
   void drawSheetPage();
 
+  size_t getMemory() const;
+
   friend class midi;
   friend class sheetMeasure;
 
  private:
+  // per-measure chord data lives until the next reset()
+  std::pmr::monotonic_buffer_resource arena{SONG_ARENA_BLOCK};
+
   vector<int> sheetPageSeparator;
   vector<sheetMeasure> displayMeasure;
 
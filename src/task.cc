@@ -0,0 +1,166 @@
+#include "task.h"
+
+#include "log.h"
+#include "trace.h"
+
+using std::lock_guard;
+using std::unique_lock;
+
+namespace {
+
+// index of the worker running on this thread, -1 for any other thread
+thread_local int workerIndex = -1;
+
+}  // namespace
+
+void taskScheduler::taskQueue::pushBack(const task& t) {
+  const unsigned int size = ring.size();
+  if (tail - head == size) {
+    vector<task> grown(size * 2);
+    for (unsigned int i = 0; i < size; ++i) {
+      grown[i] = ring[(head + i) % size];
+    }
+    ring.swap(grown);
+    head = 0;
+    tail = size;
+  }
+  ring[tail++ % ring.size()] = t;
+}
+
+task taskScheduler::taskQueue::popBack() { return ring[--tail % ring.size()]; }
+
+task taskScheduler::taskQueue::popFront() { return ring[head++ % ring.size()]; }
+
+bool taskScheduler::taskQueue::takeGroup(taskGroup* group, task& t) {
+  // newest first, that is where a waiter's own tasks usually are
+  for (unsigned int i = tail; i != head; --i) {
+    task& cur = ring[(i - 1) % ring.size()];
+    if (cur.group == group) {
+      t = cur;
+      cur = ring[--tail % ring.size()];
+      return true;
+    }
+  }
+  return false;
+}
+
+taskScheduler::taskScheduler() {
+  // the render thread and loader threads take part through waits, so one
+  // core is left for them
+  const int count = std::max(1, static_cast<int>(thread::hardware_concurrency()) - 1);
+
+  for (int i = 0; i <= count; ++i) {
+    queues.push_back(std::make_unique<taskQueue>());
+  }
+  for (int i = 0; i < count; ++i) {
+    workers.emplace_back(&taskScheduler::workerLoop, this, i);
+  }
+  logW(LL_INFO, "task scheduler started with", count, "workers");
+}
+
+void taskScheduler::submit(const task& t) {
+  taskQueue& q = workerIndex >= 0 ? *queues[workerIndex] : *queues.back();
+  {
+    lock_guard<mutex> lk(q.lock);
+    q.pushBack(t);
+  }
+  queued.fetch_add(1, std::memory_order_release);
+
+  // taking the lock orders this against a worker about to sleep
+  { lock_guard<mutex> lk(sleepLock); }
+  wake.notify_one();
+}
+
+bool taskScheduler::findTask(int id, task& t) {
+  const int n = queues.size();
+
+  // own work newest first, then the shared queue, then steal oldest first
+  for (int k = 0; k < n; ++k) {
+    int idx = (id + k) % n;
+    taskQueue& q = *queues[idx];
+    lock_guard<mutex> lk(q.lock);
+    if (!q.empty()) {
+      t = k == 0 ? q.popBack() : q.popFront();
+      queued.fetch_sub(1, std::memory_order_relaxed);
+      return true;
+    }
+  }
+  return false;
+}
+
+bool taskScheduler::runOne(taskGroup* group) {
+  const int n = queues.size();
+  const int start = workerIndex >= 0 ? workerIndex : n - 1;
+
+  for (int k = 0; k < n; ++k) {
+    taskQueue& q = *queues[(start + k) % n];
+    task t;
+    bool found;
+    {
+      lock_guard<mutex> lk(q.lock);
+      found = q.takeGroup(group, t);
+    }
+    if (found) {
+      queued.fetch_sub(1, std::memory_order_relaxed);
+      execute(t);
+      return true;
+    }
+  }
+  return false;
+}
+
+void taskScheduler::execute(const task& t) {
+  t.fn(t.ctx, t.lo, t.hi);
+  t.group->finish();
+}
+
+void taskScheduler::workerLoop(int id) {
+  workerIndex = id;
+  TRACE_THREAD("worker");
+  task t;
+  while (true) {
+    if (findTask(id, t)) {
+      execute(t);
+      continue;
+    }
+    unique_lock<mutex> lk(sleepLock);
+    wake.wait(lk, [this] { return queued.load(std::memory_order_acquire) > 0; });
+  }
+}
+
+taskScheduler& taskPool() {
+  // never destroyed, so work submitted while statics are torn down still runs
+  static taskScheduler* pool = new taskScheduler();
+  return *pool;
+}
+
+void taskGroup::run(void (*fn)(void*, int, int), void* ctx, int lo, int hi) {
+  {
+    lock_guard<mutex> lk(lock);
+    pending++;
+  }
+  taskPool().submit({fn, ctx, lo, hi, this});
+}
+
+void taskGroup::finish() {
+  lock_guard<mutex> lk(lock);
+  if (--pending == 0) {
+    idle.notify_all();
+  }
+}
+
+bool taskGroup::done() const {
+  lock_guard<mutex> lk(lock);
+  return pending == 0;
+}
+
+void taskGroup::wait() {
+  while (!done()) {
+    if (taskPool().runOne(this)) {
+      continue;
+    }
+    // the rest is running elsewhere
+    unique_lock<mutex> lk(lock);
+    idle.wait(lk, [this] { return pending == 0; });
+  }
+}
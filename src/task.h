@@ -0,0 +1,168 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using std::atomic;
+using std::condition_variable;
+using std::mutex;
+using std::thread;
+using std::unique_ptr;
+using std::vector;
+
+class taskGroup;
+
+// a unit of work: fn(ctx, lo, hi). nothing is owned, ctx must outlive the
+// group the task belongs to
+struct task {
+  void (*fn)(void*, int, int);
+  void* ctx;
+  int lo;
+  int hi;
+  taskGroup* group;
+};
+
+// process-wide work-stealing scheduler shared by loading, analysis and
+// per-frame jobs. every worker owns a deque: it pushes and pops at the back,
+// idle workers steal from the front of the others. threads that are not
+// workers submit to a shared queue instead
+class taskScheduler {
+ public:
+  taskScheduler();
+
+  taskScheduler(const taskScheduler&) = delete;
+  taskScheduler& operator=(const taskScheduler&) = delete;
+
+  // workers plus the calling thread, which always takes part in a wait
+  int getThreadCount() const { return workers.size() + 1; }
+
+  void submit(const task& t);
+
+  // runs one queued task of the group on the calling thread, false if none is
+  // queued. waiters only help their own group, so a render thread waiting on
+  // a frame job never picks up a long loader task
+  bool runOne(taskGroup* group);
+
+ private:
+  // ring of tasks, grown by doubling under the lock
+  struct taskQueue {
+    mutex lock;
+    vector<task> ring = vector<task>(64);
+    unsigned int head = 0;
+    unsigned int tail = 0;
+
+    bool empty() const { return head == tail; }
+    void pushBack(const task& t);
+    task popBack();
+    task popFront();
+    bool takeGroup(taskGroup* group, task& t);
+  };
+
+  void workerLoop(int id);
+  bool findTask(int id, task& t);
+  void execute(const task& t);
+
+  // one per worker, the last one takes submissions from other threads
+  vector<unique_ptr<taskQueue>> queues;
+  vector<thread> workers;
+
+  mutex sleepLock;
+  condition_variable wake;
+  atomic<int> queued = 0;
+};
+
+// the shared scheduler, sized to the hardware on first use
+taskScheduler& taskPool();
+
+// tasks whose completion is waited on together; wait() helps with the group's
+// own queued tasks before blocking. the destructor waits as well
+class taskGroup {
+ public:
+  taskGroup() = default;
+  ~taskGroup() { wait(); }
+
+  taskGroup(const taskGroup&) = delete;
+  taskGroup& operator=(const taskGroup&) = delete;
+
+  void run(void (*fn)(void*, int, int), void* ctx, int lo = 0, int hi = 0);
+
+  // f is referenced, not copied, and has to outlive wait()
+  template <class F>
+  void run(F& f) {
+    run([](void* ctx, int, int) { (*static_cast<F*>(ctx))(); }, &f);
+  }
+
+  void wait();
+  bool done() const;
+
+ private:
+  friend class taskScheduler;
+  void finish();
+
+  // the last finish() notifies under the lock, so a waiter that sees the
+  // group done cannot destroy it while finish() still touches it
+  mutable mutex lock;
+  condition_variable idle;
+  int pending = 0;
+};
+
+// number of ranges [begin, end) is cut into: at most four per thread, of no
+// fewer than grain items each
+inline int taskRanges(int count, int grain) {
+  return std::max(1, std::min(taskPool().getThreadCount() * 4, (count + grain - 1) / std::max(1, grain)));
+}
+
+// body(lo, hi) over [begin, end) split into taskRanges() pieces; the caller
+// runs the first range itself and returns once all of them are done
+template <class F>
+void parallelFor(int begin, int end, int grain, const F& body) {
+  const int count = end - begin;
+  if (count <= 0) {
+    return;
+  }
+  const int ranges = taskRanges(count, grain);
+  if (ranges == 1) {
+    body(begin, end);
+    return;
+  }
+
+  auto call = [](void* ctx, int lo, int hi) { (*static_cast<const F*>(ctx))(lo, hi); };
+  taskGroup group;
+  for (int r = 1; r < ranges; ++r) {
+    group.run(call, const_cast<F*>(&body), begin + static_cast<long long>(count) * r / ranges,
+              begin + static_cast<long long>(count) * (r + 1) / ranges);
+  }
+  body(begin, begin + count / ranges);
+  group.wait();
+}
+
+// body(lo, hi, acc) accumulates one range into its own copy of identity; the
+// partial results are merged in range order, so the result does not depend on
+// which thread ran what
+template <class T, class F, class M>
+T parallelReduce(int begin, int end, int grain, const T& identity, const F& body, const M& merge) {
+  const int count = end - begin;
+  if (count <= 0) {
+    return identity;
+  }
+  const int ranges = taskRanges(count, grain);
+
+  vector<T> partial(ranges, identity);
+  parallelFor(0, ranges, 1, [&](int lo, int hi) {
+    for (int r = lo; r < hi; ++r) {
+      body(begin + static_cast<long long>(count) * r / ranges, begin + static_cast<long long>(count) * (r + 1) / ranges,
+           partial[r]);
+    }
+  });
+
+  T result = identity;
+  for (const auto& p : partial) {
+    result = merge(result, p);
+  }
+  return result;
+}
@@ -0,0 +1,59 @@
+// nodumi-test: MKI chunk round trips, run by `make test`
+//
+// exits non-zero if any chunk does not read back as written
+
+#include <algorithm>
+#include <cstdio>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "../mki.h"
+
+using std::string;
+using std::stringstream;
+using std::vector;
+
+namespace {
+
+// writes one chunk behind a header and reads it back through the same path
+// as controller::loadMKI()
+bool roundTrip(const char* name, size_t size, bool compress) {
+  // compressible, but not a single repeated byte
+  vector<char> payload(size);
+  for (size_t i = 0; i < size; i++) {
+    payload[i] = static_cast<char>((i / 64) % 251);
+  }
+
+  stringstream out;
+  writeMKIHeader(out);
+  writeMKIChunk(out, "MIDI", payload.data(), payload.size(), compress);
+  const string file = out.str();
+
+  mkiReader in(file.data(), file.size());
+  mkiChunk chunk;
+  vector<char> storage;
+  const char* data = nullptr;
+  size_t dataSize = 0;
+
+  bool ok = readMKIHeader(in) && readMKIChunk(in, chunk) && chunk.tag == "MIDI" &&
+            getChunkPayload(chunk, storage, data, dataSize) && dataSize == size &&
+            std::equal(payload.begin(), payload.end(), data);
+
+  printf("%s %s (%zu bytes, stored %llu%s)\n", ok ? "pass" : "FAIL", name, size,
+         static_cast<unsigned long long>(chunk.size), chunk.flags & MKI_CHUNK_DEFLATE ? " deflated" : "");
+  return ok;
+}
+
+}  // namespace
+
+int main() {
+  bool ok = true;
+  ok &= roundTrip("empty", 0, true);
+  ok &= roundTrip("raw", 4096, false);
+  ok &= roundTrip("deflated", 1 << 20, true);
+  ok &= roundTrip("at deflate limit", MKI_DEFLATE_LIMIT, true);
+  ok &= roundTrip("past deflate limit", MKI_DEFLATE_LIMIT + (8 << 20), true);
+
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,151 @@
+#include "tile.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "define.h"
+#include "mem_usage_raylib.h"
+#include "wrap.h"
+
+using std::max;
+using std::min;
+
+namespace {
+
+bool sameColors(const vector<colorRGB>* a, const vector<colorRGB>& b) {
+  if (!a) {
+    return b.empty();
+  }
+  return std::equal(a->begin(), a->end(), b.begin(), b.end(),
+                    [](const colorRGB& x, const colorRGB& y) { return x.r == y.r && x.g == y.g && x.b == y.b; });
+}
+
+void copyColors(const vector<colorRGB>* src, vector<colorRGB>& dst) {
+  if (src) {
+    dst.assign(src->begin(), src->end());
+  }
+  else {
+    dst.clear();
+  }
+}
+
+}  // namespace
+
+void tileController::update(const tileView& next) {
+  if (next.zoom == view.zoom && next.height == view.height && next.topHeight == view.topHeight &&
+      next.displayMode == view.displayMode && next.colorMode == view.colorMode &&
+      next.tonicOffset == view.tonicOffset && next.scaleVelocity == view.scaleVelocity &&
+      sameColors(next.colorOn, colorOn) && sameColors(next.colorOff, colorOff)) {
+    return;
+  }
+
+  // buffers only need replacing when their size no longer fits
+  if (next.height != view.height) {
+    unload();
+  }
+  else {
+    clear();
+  }
+  view = next;
+
+  // copied only here, when the tiles are dropped and redrawn
+  copyColors(next.colorOn, colorOn);
+  copyColors(next.colorOff, colorOff);
+}
+
+void tileController::clear() {
+  for (auto& t : tiles) {
+    t.layer = -1;
+    t.index = -1;
+  }
+}
+
+void tileController::unload() {
+  for (auto& t : tiles) {
+    UnloadRenderTexture(t.buffer);
+  }
+  tiles.clear();
+}
+
+int tileController::findTile(double time) const { return max(0.0, std::floor(time / getSpan())); }
+
+tileController::tile* tileController::find(int layer, int index) {
+  for (auto& t : tiles) {
+    if (t.layer == layer && t.index == index) {
+      return &t;
+    }
+  }
+  return nullptr;
+}
+
+tileController::tile* tileController::acquire(int layer, int index) {
+  tile* slot = nullptr;
+  for (auto& t : tiles) {
+    if (t.index == -1) {
+      slot = &t;
+      break;
+    }
+    // least recently shown, as long as it is not in view this frame
+    if (t.used != frame && (!slot || t.used < slot->used)) {
+      slot = &t;
+    }
+  }
+
+  if ((!slot || slot->index != -1) && tiles.size() < TILE_CACHE_SIZE) {
+    tiles.push_back({});
+    slot = &tiles.back();
+    slot->buffer = LoadRenderTexture(TILE_WIDTH, view.height);
+  }
+  if (!slot) {
+    return nullptr;
+  }
+
+  slot->layer = layer;
+  slot->index = index;
+  slot->used = frame;
+  return slot;
+}
+
+void tileController::beginTile(tile& t) {
+  if (!drawing) {
+    ctr.gpuTime.begin(GPU_NOTE_TILES);
+    drawing = true;
+  }
+  ctr.beginTextureMode(t.buffer);
+  clearBackground();
+}
+
+void tileController::endTile() { ctr.endTextureMode(); }
+
+void tileController::finish() {
+  if (drawing) {
+    ctr.gpuTime.end(GPU_NOTE_TILES);
+    drawing = false;
+  }
+}
+
+void tileController::render(int layer, double timeOffset, double nowLineX, float clipL, float clipR) const {
+  for (const auto& t : tiles) {
+    if (t.layer != layer) {
+      continue;
+    }
+    // tiles are exactly TILE_WIDTH apart on screen, rounding one start the same
+    // way as all others keeps the seams closed
+    const double x = std::round(nowLineX - timeOffset * view.zoom) + double(t.index) * TILE_WIDTH;
+    const float left = max(x, double(clipL));
+    const float right = min(x + TILE_WIDTH, double(clipR));
+    if (left >= right) {
+      continue;
+    }
+    const float srcX = left - x;
+    DrawTextureRec(t.buffer.texture, {srcX, 0, right - left, -float(t.buffer.texture.height)}, {left, 0}, WHITE);
+  }
+}
+
+size_t tileController::getMemory() const {
+  size_t bytes = heapSize(tiles);
+  for (const auto& t : tiles) {
+    bytes += renderTextureSize(t.buffer);
+  }
+  return bytes;
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <vector>
+
+#include "build_target.h"
+#include "color.h"
+#include "data.h"
+#include "enum.h"
+#include "mem_usage.h"
+
+using std::vector;
+
+// everything the static note field depends on besides song time; tiles are
+// dropped as soon as any of it changes
+struct tileView {
+  double zoom = 0;
+  int height = 0;
+  int topHeight = 0;
+  int displayMode = 0;
+  int colorMode = 0;
+  int tonicOffset = 0;
+  bool scaleVelocity = false;
+
+  // the caller's palettes, only compared against the copies the tiles were
+  // drawn with, so building a view every frame does not allocate
+  const vector<colorRGB>* colorOn = nullptr;
+  const vector<colorRGB>* colorOff = nullptr;
+};
+
+// the note field cut into TILE_WIDTH pixel slices of song time, drawn once per
+// view and blitted every frame. modes that draw passed and upcoming notes apart
+// keep a layer of tiles for each
+class tileController {
+ public:
+  void update(const tileView& view);
+  void clear();
+  void unload();
+
+  // draws the tiles of [viewBegin, viewEnd] that are not cached yet through
+  // draw(layer, begin, end), which renders song span [begin, end) at x = 0.
+  // false if the view needs more tiles than the cache holds
+  template <class F>
+  bool prepare(int layerCount, double viewBegin, double viewEnd, F&& draw);
+
+  // blits one layer clipped to screen x range [clipL, clipR)
+  void render(int layer, double timeOffset, double nowLineX, float clipL, float clipR) const;
+
+  size_t getMemory() const;
+
+ private:
+  struct tile {
+    RenderTexture buffer = {};
+    int layer = -1;
+    int index = -1;
+    unsigned int used = 0;
+  };
+
+  double getSpan() const { return TILE_WIDTH / view.zoom; }
+  int findTile(double time) const;
+  tile* find(int layer, int index);
+
+  tile* acquire(int layer, int index);
+  void beginTile(tile& t);
+  void endTile();
+  void finish();
+
+  tileView view;
+  vector<colorRGB> colorOn;
+  vector<colorRGB> colorOff;
+  vector<tile> tiles;
+  unsigned int frame = 0;
+  bool drawing = false;
+};
+
+template <class F>
+bool tileController::prepare(int layerCount, double viewBegin, double viewEnd, F&& draw) {
+  frame++;
+  const double span = getSpan();
+  for (int layer = 0; layer < layerCount; ++layer) {
+    for (int idx = findTile(viewBegin); idx <= findTile(viewEnd); ++idx) {
+      tile* t = find(layer, idx);
+      if (t) {
+        t->used = frame;
+        continue;
+      }
+      t = acquire(layer, idx);
+      if (!t) {
+        finish();
+        return false;
+      }
+      beginTile(*t);
+      draw(layer, idx * span, (idx + 1) * span);
+      endTile();
+    }
+  }
+  finish();
+  return true;
+}
@@ -3,7 +3,6 @@
 #include <algorithm>
 #include <string>
 
-#include "define.h"
 #include "log.h"
 
 void keySig::findAccidentalsFromKey() {
@@ -151,7 +150,7 @@ int keySig::getStaveOffset() const {
   }
 }
 
-string keySig::getLabel() const {
+string keySig::getLabel(const string& quality) const {
   // NOTE: "#" used as replacement for sharp,
   //     : "b" for flat, replaced with real
   //     : symbol during rendering
@@ -205,5 +204,5 @@ string keySig::getLabel() const {
     default:
       return "undefined";
   }
-  return label += ctr.text.getString("GET_LABEL_MAJOR");
+  return label += quality;
 }
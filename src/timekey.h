@@ -128,7 +128,8 @@ class keySig {
   int getIndex() const { return startingIndex; }
   int getStaveOffset() const;
 
-  string getLabel() const;
+  // quality is the localized "Major" suffix, supplied by the caller
+  string getLabel(const string& quality = "Major") const;
 
   bool isSharp() const { return accidentals >= 0; }
 
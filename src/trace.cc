@@ -0,0 +1,134 @@
+#include "trace.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "data.h"
+#include "log.h"
+
+using std::lock_guard;
+using std::mutex;
+using std::ofstream;
+using std::unique_ptr;
+using std::vector;
+
+#if defined(TRACE_ENABLED)
+
+namespace {
+
+struct traceEvent {
+  const char* name;
+  traceClock::time_point begin;
+  traceClock::time_point end;
+};
+
+// events of one thread, the oldest are overwritten once it is full. the lock
+// is only ever contended while a dump copies the buffer out
+struct traceBuffer {
+  mutex lock;
+  int tid = 0;
+  const char* name = nullptr;
+  vector<traceEvent> events = vector<traceEvent>(TRACE_BUFFER_EVENTS);
+  size_t count = 0;
+};
+
+struct traceRegistry {
+  mutex lock;
+  vector<unique_ptr<traceBuffer>> buffers;
+  traceClock::time_point epoch = traceClock::now();
+};
+
+traceRegistry& registry() {
+  // never destroyed, threads may still record while statics are torn down
+  static traceRegistry* r = new traceRegistry();
+  return *r;
+}
+
+traceBuffer& localBuffer() {
+  // buffers outlive their threads so a dump still shows finished ones
+  thread_local traceBuffer* buffer = [] {
+    traceRegistry& r = registry();
+    lock_guard<mutex> lk(r.lock);
+    r.buffers.push_back(std::make_unique<traceBuffer>());
+    r.buffers.back()->tid = r.buffers.size();
+    return r.buffers.back().get();
+  }();
+  return *buffer;
+}
+
+double toMicroseconds(traceClock::duration d) { return std::chrono::duration<double, std::micro>(d).count(); }
+
+}  // namespace
+
+void traceSpan(const char* name, traceClock::time_point begin, traceClock::time_point end) {
+  traceBuffer& b = localBuffer();
+  lock_guard<mutex> lk(b.lock);
+  b.events[b.count++ % b.events.size()] = {name, begin, end};
+}
+
+void traceThread(const char* name) {
+  traceBuffer& b = localBuffer();
+  lock_guard<mutex> lk(b.lock);
+  b.name = name;
+}
+
+bool traceDump(const string& path) {
+  ofstream out(path);
+  if (!out) {
+    logW(LL_WARN, "unable to write trace to", path);
+    return false;
+  }
+
+  traceRegistry& r = registry();
+  lock_guard<mutex> lk(r.lock);
+
+  out << std::fixed << std::setprecision(3);
+  out << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [";
+
+  size_t written = 0;
+  auto separator = [&] { return written++ ? ",\n" : "\n"; };
+
+  vector<traceEvent> events;
+  for (const auto& b : r.buffers) {
+    const char* name;
+    {
+      lock_guard<mutex> blk(b->lock);
+      size_t kept = std::min(b->count, b->events.size());
+      events.resize(kept);
+      for (size_t i = 0; i < kept; ++i) {
+        events[i] = b->events[(b->count - kept + i) % b->events.size()];
+      }
+      name = b->name;
+    }
+
+    if (name) {
+      out << separator() << "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": " << b->tid
+          << ", \"args\": {\"name\": \"" << name << "\"}}";
+    }
+    for (const auto& e : events) {
+      out << separator() << "{\"name\": \"" << e.name << "\", \"ph\": \"X\", \"pid\": 1, \"tid\": " << b->tid
+          << ", \"ts\": " << toMicroseconds(e.begin - r.epoch) << ", \"dur\": " << toMicroseconds(e.end - e.begin)
+          << "}";
+    }
+  }
+  out << "\n]}\n";
+
+  logW(LL_INFO, "wrote", written, "trace events to", path);
+  return static_cast<bool>(out);
+}
+
+#else
+
+void traceSpan(const char*, traceClock::time_point, traceClock::time_point) {}
+void traceThread(const char*) {}
+
+bool traceDump(const string&) {
+  logW(LL_WARN, "tracing is not enabled in this build, rebuild with `make trace=y`");
+  return false;
+}
+
+#endif
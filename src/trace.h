@@ -0,0 +1,55 @@
+#pragma once
+
+#include <chrono>
+#include <string>
+
+using std::string;
+
+// scoped timing zones for timeline profiling, compiled out unless built with
+// `make trace=y`. every thread records into its own buffer; traceDump() writes
+// all of them as a Chrome trace (chrome://tracing, ui.perfetto.dev)
+#if defined(TRACE_ENABLED)
+  #define TRACE_CONCAT_(a, b) a##b
+  #define TRACE_CONCAT(a, b) TRACE_CONCAT_(a, b)
+  #define TRACE_ZONE(name) traceZone TRACE_CONCAT(traceZone_, __LINE__)(name)
+  #define TRACE_STAGE(var, name) traceZone var(name)
+  #define TRACE_NEXT(var, name) var.next(name)
+  #define TRACE_SPAN(name, begin, end) traceSpan(name, begin, end)
+  #define TRACE_THREAD(name) traceThread(name)
+#else
+  #define TRACE_ZONE(name) ;
+  #define TRACE_STAGE(var, name) ;
+  #define TRACE_NEXT(var, name) ;
+  #define TRACE_SPAN(name, begin, end) ;
+  #define TRACE_THREAD(name) ;
+#endif
+
+using traceClock = std::chrono::steady_clock;
+
+// names must be string literals, only the pointer is kept
+void traceSpan(const char* name, traceClock::time_point begin, traceClock::time_point end);
+void traceThread(const char* name);
+
+// false if the file cannot be written or tracing is compiled out
+bool traceDump(const string& path);
+
+class traceZone {
+ public:
+  explicit traceZone(const char* name) : name(name), begin(traceClock::now()) {}
+  ~traceZone() { traceSpan(name, begin, traceClock::now()); }
+
+  traceZone(const traceZone&) = delete;
+  traceZone& operator=(const traceZone&) = delete;
+
+  // closes the current zone and opens the next one, for straight-line stages
+  void next(const char* nextName) {
+    auto now = traceClock::now();
+    traceSpan(name, begin, now);
+    name = nextName;
+    begin = now;
+  }
+
+ private:
+  const char* name;
+  traceClock::time_point begin;
+};
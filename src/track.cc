@@ -1,9 +1,8 @@
 #include "track.h"
 
+#include <algorithm>
 #include <string>
 
-#include "define.h"
-
 void trackController::reset() {
   note_idx.clear();
   chords.clear();
@@ -14,41 +13,17 @@ void trackController::reset() {
 
 void trackController::insert(unsigned int n) {
   noteCount++;
-  noteSum += n_vec->at(n).y;
+  noteSum += noteAt(*n_vec, n).y;
   note_idx.push_back(n);
 }
 
 void trackController::buildChordMap() {
-  chords.clear();
   // requires notes to be added first already in note_idx
   // logQ("track has", note_idx.size(), "notes");
-  if (note_idx.size() == 0) {
+  chords.build(note_idx, *n_vec);
+  if (chords.size() == 0) {
     return;
   }
-
-  for (unsigned int n = 0; n < note_idx.size(); ++n) {
-    if (n != 0 && n_vec->at(note_idx[n]).x < n_vec->at(note_idx[n] - 1).x) {
-      logQ("MISALIGNED @ idx:", note_idx[n], "but", n);
-    }
-
-    chords.push_back({note_idx[n]});
-    unsigned int c_chord = chords.size() - 1;
-
-    while (n + 1 < note_idx.size()) {
-      if (n_vec->at(note_idx[n]).x == n_vec->at(note_idx[n + 1]).x) {
-        chords[c_chord].add_member(note_idx[n + 1]);
-      }
-      else {
-        break;
-      }
-      n++;
-    }
-  }
-
-  // not guaranteed to be in increasing order of y
-  for (auto& c : chords) {
-    c.sort_asc(n_vec);
-  }
   // for (unsigned int c = 0; c+1 < chords.size(); ++c) {
 
   // if (n_vec->at(chords[c].data()[0]).x > n_vec->at(chords[c+1].data()[0]).x)
@@ -68,6 +43,7 @@ void trackController::buildChordMap() {
 
 void trackController::buildLineMap() {
   lines.clear();
+  lines.reserve(note_idx.size());
   for (unsigned int c_chord = 0; c_chord < chords.size(); ++c_chord) {
     if (c_chord + 1 == chords.size()) {
       buildLine(c_chord, c_chord);
@@ -79,8 +55,9 @@ void trackController::buildLineMap() {
 }
 
 void trackController::buildLine(unsigned int l, unsigned int r) {
-  auto chord_l = chords[l].data();
-  auto chord_r = chords[r].data();
+  auto chord_l = chords[l];
+  auto chord_r = chords[r];
+  const auto& notes = *n_vec;
 
   // if (chord_l.size() > 1) {
   // for (unsigned int idx_l = 0; idx_l < chord_l.size(); ++idx_l) {
@@ -92,26 +69,26 @@ void trackController::buildLine(unsigned int l, unsigned int r) {
   //}
   //}
 
-  double l_start = n_vec->at(chord_l[0]).x;
-  int l_end_note = chords[l].latest_end(n_vec);
-  double l_duration = n_vec->at(l_end_note).duration;
-  double r_start = n_vec->at(chord_r[0]).x;
-  bool in_progress = n_vec->at(chord_l[0]).isOn;
+  double l_start = noteAt(notes, chord_l[0]).x;
+  int l_end_note = chords.latest_end(l, notes);
+  double l_duration = noteAt(notes, l_end_note).duration;
+  double r_start = noteAt(notes, chord_r[0]).x;
+  bool in_progress = noteAt(notes, chord_l[0]).isOn;
 
   // unsigned int n_line = 0;
 
   // only link spatially near notes
   if (l == r || l_start + 2 * l_duration < r_start) {
     for (unsigned int n_l = 0; n_l < chord_l.size(); ++n_l) {
-      const auto& l_note = n_vec->at(chord_l[n_l]);
+      const auto& l_note = noteAt(notes, chord_l[n_l]);
       lines.push_back({chord_l[n_l], l_note.x, l_note.y, l_note.x + l_note.duration, l_note.y, in_progress});
     }
     return;
   }
 
   auto push_verts = [&](unsigned int n_l, unsigned int n_r) {
-    const auto& l_note = n_vec->at(chord_l[n_l]);
-    const auto& r_note = n_vec->at(chord_r[n_r]);
+    const auto& l_note = noteAt(notes, chord_l[n_l]);
+    const auto& r_note = noteAt(notes, chord_r[n_r]);
 
     // if (r_note.x < l_note.x) {
     // logQ("NEGATIVE LINE OFFSET");
@@ -132,8 +109,8 @@ void trackController::buildLine(unsigned int l, unsigned int r) {
                      in_progress});
   };
 
-  auto get_y_l = [&](unsigned int idx) { return n_vec->at(chord_l[idx]).y; };
-  auto get_y_r = [&](unsigned int idx) { return n_vec->at(chord_r[idx]).y; };
+  auto get_y_l = [&](unsigned int idx) { return noteAt(notes, chord_l[idx]).y; };
+  auto get_y_r = [&](unsigned int idx) { return noteAt(notes, chord_r[idx]).y; };
 
   if (chord_l.size() == chord_r.size()) {
     // equal size
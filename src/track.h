@@ -26,6 +26,9 @@ class trackController {
   int getNoteCount() const { return noteCount; }
   double getAverageY() const { return static_cast<double>(noteSum) / noteCount; }
 
+  size_t getChordMemory() const { return heapSize(note_idx) + chords.getMemory(); }
+  size_t getLineMemory() const { return heapSize(lines); }
+
   void buildChordMap();
   void buildLineMap();
 
@@ -37,7 +40,7 @@ class trackController {
   vector<note>* n_vec;
   vector<unsigned int> note_idx;
   vector<lineData> lines;
-  vector<chordData> chords;
+  chordMap chords;
   int noteCount;
   int noteSum;
 };
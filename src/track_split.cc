@@ -1,15 +1,133 @@
 #include "track_split.h"
 
-#include "controller.h"
-#include "define.h"
+#include <algorithm>
+#include <atomic>
+#include <limits>
+#include <set>
+
+#include "data.h"
+#include "task.h"
+
+using std::atomic;
+using std::max;
+using std::min;
+using std::multiset;
+
+namespace {
+
+// notes further apart than seqLimit are split independently; notes started
+// within onLimit of each other determine the hand ranges
+constexpr int seqLimit = 2000;
+constexpr int onLimit = 350;
+
+// report(count) is handed the notes split since its last call, every 4096
+// notes and at the end; the chunk is abandoned once it returns false
+template <class F>
+bool splitChunk(vector<note>& notes, int begin, int end, int handRange, const F& report) {
+  // pitches per hand of the notes started within onLimit of the current one
+  multiset<int> hand[2];
+  int tail = begin;
+  int reported = begin;
+
+  for (int idx = begin; idx < end; ++idx) {
+    if (idx - reported == 4096) {
+      if (!report(idx - reported)) {
+        return false;
+      }
+      reported = idx;
+    }
+
+    note& n = notes[idx];
+
+    for (; tail < idx && notes[tail].x + onLimit <= n.x; ++tail) {
+      auto& h = hand[notes[tail].track];
+      h.erase(h.find(notes[tail].y));
+    }
+
+    // nothing played recently, go by register
+    if (idx == begin) {
+      n.track = n.y >= 60;
+      hand[n.track].insert(n.y);
+      continue;
+    }
+
+    // consider the range of each hand WITH this note
+    auto outOfRange = [&](const multiset<int>& h) {
+      int lo = h.empty() ? n.y : min(*h.begin(), n.y);
+      int hi = h.empty() ? n.y : max(*h.rbegin(), n.y);
+      return hi - lo > handRange;
+    };
+    bool outOfRange0 = outOfRange(hand[0]);
+    bool outOfRange1 = outOfRange(hand[1]);
+
+    // force assign to other hand if adding to this track causes an out of
+    // range, else stay with the previous note
+    if (!outOfRange0 && outOfRange1) {
+      n.track = 0;
+    }
+    else if (outOfRange0 && !outOfRange1) {
+      n.track = 1;
+    }
+    else if (!outOfRange0 && !outOfRange1) {
+      n.track = notes[idx - 1].track;
+    }
+    else {
+      n.track = 0;
+    }
+
+    hand[n.track].insert(n.y);
+  }
+  return report(end - reported);
+}
 
-int findTrack(const note& n, const midi& m_stream, bool live, int numOn) {
+}  // namespace
+
+bool splitTracks(vector<note>& notes, const analysisContext& context, loadProgress* status) {
+  // a gap of seqLimit resets the splitter, so the runs between such gaps are
+  // independent of each other
+  vector<int> chunks;
+  for (unsigned int idx = 0; idx < notes.size(); ++idx) {
+    if (idx == 0 || notes[idx - 1].x + seqLimit <= notes[idx].x) {
+      chunks.push_back(idx);
+    }
+  }
+  chunks.push_back(notes.size());
+
+  const int chunkCount = chunks.size() - 1;
+
+  // notes split so far over all threads; once the load is cancelled every
+  // thread drops its chunk and skips the rest
+  atomic<unsigned int> done = 0;
+  atomic<bool> cancelled = false;
+
+  auto report = [&](int count) {
+    unsigned int total = done += count;
+    if (!midi::poll(status, 0.4 + 0.2 * total / notes.size())) {
+      cancelled = true;
+    }
+    return !cancelled;
+  };
+  auto split = [&](int lo, int hi) {
+    for (int c = lo; c < hi; ++c) {
+      if (!splitChunk(notes, chunks[c], chunks[c + 1], context.handRange, report)) {
+        return;
+      }
+    }
+  };
+  if (notes.size() >= SPLIT_PARALLEL_MIN) {
+    parallelFor(0, chunkCount, 1, split);
+  }
+  else {
+    split(0, chunkCount);
+  }
+  return !cancelled;
+}
+
+int findTrack(const note& n, const midi& m_stream, const analysisContext& context, bool live, int numOn) {
   if (!live) {
     // return n.y % 2;
   }
 
-  constexpr int seqLimit = 2000;
-
   // find latest old note
   int i = 0;
   double minX = std::numeric_limits<double>::max();
@@ -76,8 +194,7 @@ int findTrack(const note& n, const midi& m_stream, bool live, int numOn) {
   int tr1maxY = 0;
 
   // one hand range (approx. a 10th)
-  const int handRange = ctr.option.get(OPTION::HAND_RANGE);
-  constexpr int onLimit = 350;
+  const int handRange = context.handRange;
 
   vector<int> considerN;
   // vector<int> onN;
@@ -1,7 +1,16 @@
 #pragma once
 
-#include "build_target.h"
+#include <vector>
+
+#include "context.h"
 #include "midi.h"
 #include "note.h"
 
-int findTrack(const note& n, const midi& m_stream, bool live = true, int numOn = -1);
+using std::vector;
+
+// live input: hand for the newest note, given the notes played so far
+int findTrack(const note& n, const midi& m_stream, const analysisContext& context, bool live = true, int numOn = -1);
+
+// loaded files: assigns every note of a single time-ordered track to a hand;
+// reports progress from 0.4 to 0.6 and returns false once the load is cancelled
+bool splitTracks(vector<note>& notes, const analysisContext& context, loadProgress* status = nullptr);
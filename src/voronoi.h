@@ -7,13 +7,12 @@
 #include "color.h"
 #include "data.h"
 #include "log.h"
+#include "mem_usage_raylib.h"
 
 using std::vector;
 
 class voronoiController {
  public:
-  void init();
-
   void unloadData() { unload(); }
   void update();
 
@@ -21,13 +20,18 @@ class voronoiController {
 
   void resample(int voro_y);
 
+  size_t getMemory() const { return loaded ? renderTextureSize(voro_buffer) + textureSize(tex) : 0; }
+
+  // filled while notes are drawn and consumed early in the next frame, past
+  // the frame arena reset, so these keep their own capacity instead
   vector<Vector2> vertex;
   vector<colorRGB> color;
 
-  RenderTexture voro_buffer;
-  Texture2D tex;
+  RenderTexture voro_buffer = {};
+  Texture2D tex = {};
 
  private:
+  void load();
   void unload();
 
   void updateBuffer();
@@ -35,4 +39,7 @@ class voronoiController {
 
   vector<Vector2> vertex_last;
   vector<colorRGB> color_last;
+
+  // buffers are created on first render and after a resize
+  bool loaded = false;
 };